@@ -0,0 +1,483 @@
+
+/*
+Base64 and hexadecimal encoding and decoding between spans
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_BASE64_HPP_INCLUDED
+#define TCB_BASE64_HPP_INCLUDED
+
+#include "span_ext.hpp"
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+namespace detail {
+
+// The standard alphabet of RFC 4648, and its inverse, in which characters
+// outside the alphabet have the top bit set
+struct base64_table {
+    char encode[64];
+    unsigned char decode[256];
+
+    base64_table() noexcept
+    {
+        const char alphabet[] =
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::memcpy(encode, alphabet, 64);
+        std::memset(decode, 0x80, sizeof(decode));
+        for (unsigned i = 0; i < 64; i++) {
+            decode[static_cast<unsigned char>(alphabet[i])] =
+                static_cast<unsigned char>(i);
+        }
+    }
+};
+
+inline const base64_table& base64_tables() noexcept
+{
+    static const base64_table table;
+    return table;
+}
+
+// The kernels each process as many whole blocks as the input and output
+// allow, advancing the pointers and counts past them. The decoders also stop
+// at the first block containing anything other than the 64 characters of
+// the alphabet, such as padding, leaving it for the scalar code.
+
+inline void base64_encode_scalar(const unsigned char*& in, std::size_t& n,
+                                 char*& out, std::size_t& m) noexcept
+{
+    const char* alphabet = base64_tables().encode;
+    for (; n >= 3 && m >= 4; in += 3, n -= 3, out += 4, m -= 4) {
+        const std::uint32_t v = static_cast<std::uint32_t>(in[0]) << 16 |
+                                static_cast<std::uint32_t>(in[1]) << 8 | in[2];
+        out[0] = alphabet[v >> 18];
+        out[1] = alphabet[v >> 12 & 0x3f];
+        out[2] = alphabet[v >> 6 & 0x3f];
+        out[3] = alphabet[v & 0x3f];
+    }
+}
+
+inline void base64_decode_scalar(const char*& in, std::size_t& n,
+                                 unsigned char*& out, std::size_t& m) noexcept
+{
+    const unsigned char* decode = base64_tables().decode;
+    for (; n >= 4 && m >= 3; in += 4, n -= 4, out += 3, m -= 3) {
+        const unsigned a = decode[static_cast<unsigned char>(in[0])];
+        const unsigned b = decode[static_cast<unsigned char>(in[1])];
+        const unsigned c = decode[static_cast<unsigned char>(in[2])];
+        const unsigned d = decode[static_cast<unsigned char>(in[3])];
+        if ((a | b | c | d) & 0x80) {
+            return;
+        }
+        const std::uint32_t v = a << 18 | b << 12 | c << 6 | d;
+        out[0] = static_cast<unsigned char>(v >> 16);
+        out[1] = static_cast<unsigned char>(v >> 8);
+        out[2] = static_cast<unsigned char>(v);
+    }
+}
+
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+
+// After Muła and Lemire, "Faster Base64 Encoding and Decoding Using AVX2
+// Instructions". Each lane encodes 12 bytes: they are spread into groups of
+// four, the sextets extracted with multiplies, and the sextets translated
+// to ASCII by adding an offset looked up from the range they fall in.
+TCB_SPAN_TARGET("avx2")
+inline void base64_encode_avx2(const unsigned char*& in, std::size_t& n,
+                               char*& out, std::size_t& m) noexcept
+{
+    const __m256i spread = _mm256_setr_epi8(
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10, 1, 0, 2, 1, 4, 3,
+        5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i offsets = _mm256_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    // Each lane loads 16 bytes to use 12
+    for (; n >= 28 && m >= 32; in += 24, n -= 24, out += 32, m -= 32) {
+        const __m256i v = _mm256_shuffle_epi8(
+            _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(in))),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 12)),
+                1),
+            spread);
+        const __m256i t0 = _mm256_mulhi_epu16(
+            _mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00)),
+            _mm256_set1_epi32(0x04000040));
+        const __m256i t1 = _mm256_mullo_epi16(
+            _mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0)),
+            _mm256_set1_epi32(0x01000010));
+        const __m256i sextets = _mm256_or_si256(t0, t1);
+        // 0-25 map to range 13, 26-51 to 0, and 52-63 to 1-12
+        const __m256i range = _mm256_or_si256(
+            _mm256_subs_epu8(sextets, _mm256_set1_epi8(51)),
+            _mm256_and_si256(
+                _mm256_cmpgt_epi8(_mm256_set1_epi8(26), sextets),
+                _mm256_set1_epi8(13)));
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(out),
+            _mm256_add_epi8(_mm256_shuffle_epi8(offsets, range), sextets));
+    }
+}
+
+// Characters are classified by their high and low nibbles, each looked up
+// in a table of bit flags; a character is outside the alphabet when the two
+// lookups share a flag. The sextet values are found by adding an offset
+// chosen by the high nibble, with '/' (which shares its nibble with '+')
+// adjusted to a different entry. The sextets are then packed with
+// multiply-adds and shuffled together.
+TCB_SPAN_TARGET("avx2")
+inline void base64_decode_avx2(const char*& in, std::size_t& n,
+                               unsigned char*& out, std::size_t& m) noexcept
+{
+    const __m256i lut_lo = _mm256_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a,
+        0x1b, 0x1b, 0x1b, 0x1a, 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m256i lut_hi = _mm256_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lut_roll =
+        _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0,
+                         0, 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0,
+                         0, 0);
+    const __m256i pack = _mm256_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1, 2, 1, 0, 6, 5,
+        4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    // 24 bytes are produced, but 32 stored
+    for (; n >= 32 && m >= 32; in += 32, n -= 32, out += 24, m -= 24) {
+        const __m256i v =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+        const __m256i hi = _mm256_and_si256(_mm256_srli_epi32(v, 4), nibble);
+        const __m256i lo = _mm256_and_si256(v, nibble);
+        if (!_mm256_testz_si256(_mm256_shuffle_epi8(lut_lo, lo),
+                                _mm256_shuffle_epi8(lut_hi, hi))) {
+            return;
+        }
+        const __m256i is_slash = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('/'));
+        const __m256i sextets = _mm256_add_epi8(
+            v, _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(is_slash, hi)));
+        const __m256i pairs = _mm256_maddubs_epi16(
+            sextets, _mm256_set1_epi32(0x01400140));
+        const __m256i words =
+            _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+        const __m256i packed = _mm256_permutevar8x32_epi32(
+            _mm256_shuffle_epi8(words, pack),
+            _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), packed);
+    }
+}
+
+// With VBMI, a single byte permute does each of the spreading, the bit
+// extraction (by multishift), the translation through the alphabet, and the
+// packing of decoded bytes, on 48 bytes or 64 characters at a time.
+TCB_SPAN_TARGET("avx512f,avx512bw,avx512vbmi")
+inline void base64_encode_vbmi(const unsigned char*& in, std::size_t& n,
+                               char*& out, std::size_t& m) noexcept
+{
+    alignas(64) unsigned char spread[64];
+    for (unsigned g = 0; g < 16; g++) {
+        spread[4 * g] = static_cast<unsigned char>(3 * g + 1);
+        spread[4 * g + 1] = static_cast<unsigned char>(3 * g);
+        spread[4 * g + 2] = static_cast<unsigned char>(3 * g + 2);
+        spread[4 * g + 3] = static_cast<unsigned char>(3 * g + 1);
+    }
+    const __m512i spread_idx = _mm512_load_si512(spread);
+    const __m512i shifts = _mm512_set1_epi64(0x3036242a1016040a);
+    const __m512i alphabet = _mm512_loadu_si512(base64_tables().encode);
+    for (; n >= 48 && m >= 64; in += 48, n -= 48, out += 64, m -= 64) {
+        const __m512i v = _mm512_permutexvar_epi8(
+            spread_idx, _mm512_maskz_loadu_epi8(0xffffffffffffu, in));
+        const __m512i sextets = _mm512_multishift_epi64_epi8(shifts, v);
+        _mm512_storeu_si512(out, _mm512_permutexvar_epi8(sextets, alphabet));
+    }
+}
+
+TCB_SPAN_TARGET("avx512f,avx512bw,avx512vbmi")
+inline void base64_decode_vbmi(const char*& in, std::size_t& n,
+                               unsigned char*& out, std::size_t& m) noexcept
+{
+    alignas(64) unsigned char pack[64] = {};
+    for (unsigned g = 0; g < 16; g++) {
+        for (unsigned k = 0; k < 3; k++) {
+            pack[3 * g + k] = static_cast<unsigned char>(4 * g + 2 - k);
+        }
+    }
+    const __m512i pack_idx = _mm512_load_si512(pack);
+    const unsigned char* decode = base64_tables().decode;
+    const __m512i lookup_lo = _mm512_loadu_si512(decode);
+    const __m512i lookup_hi = _mm512_loadu_si512(decode + 64);
+    for (; n >= 64 && m >= 48; in += 64, n -= 64, out += 48, m -= 48) {
+        const __m512i v = _mm512_loadu_si512(in);
+        // Characters of 128 and above have the top bit set themselves
+        const __m512i sextets =
+            _mm512_permutex2var_epi8(lookup_lo, v, lookup_hi);
+        if (_mm512_movepi8_mask(_mm512_or_si512(v, sextets)) != 0) {
+            return;
+        }
+        const __m512i pairs = _mm512_maddubs_epi16(
+            sextets, _mm512_set1_epi32(0x01400140));
+        const __m512i words =
+            _mm512_madd_epi16(pairs, _mm512_set1_epi32(0x00011000));
+        _mm512_mask_storeu_epi8(out, 0xffffffffffffu,
+                                _mm512_permutexvar_epi8(pack_idx, words));
+    }
+}
+
+#endif // TCB_SPAN_HAVE_X86_SIMD
+
+// Hexadecimal
+
+inline unsigned hex_value(char c) noexcept
+{
+    const unsigned u = static_cast<unsigned char>(c);
+    if (u - '0' < 10u) {
+        return u - '0';
+    }
+    if ((u | 0x20) - 'a' < 6u) {
+        return (u | 0x20) - 'a' + 10;
+    }
+    return 16;
+}
+
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+
+// Each byte is widened to 16 bits, its nibbles placed in the two halves,
+// and both looked up in the table of digits at once
+TCB_SPAN_TARGET("avx2")
+inline void hex_encode_avx2(const unsigned char*& in, std::size_t& n,
+                            char*& out, std::size_t& m) noexcept
+{
+    const __m256i digits = _mm256_setr_epi8(
+        '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd',
+        'e', 'f', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b',
+        'c', 'd', 'e', 'f');
+    const __m256i nibble = _mm256_set1_epi16(0x0f);
+    for (; n >= 16 && m >= 32; in += 16, n -= 16, out += 32, m -= 32) {
+        const __m256i v = _mm256_cvtepu8_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in)));
+        const __m256i split = _mm256_or_si256(
+            _mm256_srli_epi16(v, 4),
+            _mm256_slli_epi16(_mm256_and_si256(v, nibble), 8));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out),
+                            _mm256_shuffle_epi8(digits, split));
+    }
+}
+
+// Digits and letters (of either case) are converted separately and the
+// results combined; valid is set where the character was either
+TCB_SPAN_TARGET("avx2")
+inline __m256i hex_nibbles_avx2(__m256i v, __m256i& valid) noexcept
+{
+    const __m256i d = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+    const __m256i is_digit =
+        _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+    const __m256i l = _mm256_sub_epi8(
+        _mm256_or_si256(v, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    const __m256i is_letter =
+        _mm256_cmpeq_epi8(_mm256_min_epu8(l, _mm256_set1_epi8(5)), l);
+    valid = _mm256_or_si256(is_digit, is_letter);
+    return _mm256_or_si256(
+        _mm256_and_si256(is_digit, d),
+        _mm256_and_si256(is_letter,
+                         _mm256_add_epi8(l, _mm256_set1_epi8(10))));
+}
+
+// Stops at a block with any character other than a digit. Pairs of nibbles
+// are joined by a multiply-add.
+TCB_SPAN_TARGET("avx2")
+inline void hex_decode_avx2(const char*& in, std::size_t& n,
+                            unsigned char*& out, std::size_t& m) noexcept
+{
+    for (; n >= 64 && m >= 32; in += 64, n -= 64, out += 32, m -= 32) {
+        __m256i valid0, valid1;
+        const __m256i a = hex_nibbles_avx2(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in)), valid0);
+        const __m256i b = hex_nibbles_avx2(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 32)),
+            valid1);
+        if (_mm256_movemask_epi8(_mm256_and_si256(valid0, valid1)) != -1) {
+            return;
+        }
+        const __m256i weights = _mm256_set1_epi16(0x0110);
+        const __m256i packed =
+            _mm256_packus_epi16(_mm256_maddubs_epi16(a, weights),
+                                _mm256_maddubs_epi16(b, weights));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out),
+                            _mm256_permute4x64_epi64(packed, 0xd8));
+    }
+}
+
+#endif // TCB_SPAN_HAVE_X86_SIMD
+
+} // namespace detail
+
+// The exact sizes of the encodings and decodings of the given input. A
+// decoding's size is found from its length and padding, without checking
+// the characters.
+
+inline std::size_t base64_encoded_size(span<const byte> data) noexcept
+{
+    return (data.size() + 2) / 3 * 4;
+}
+
+inline std::size_t base64_decoded_size(span<const char> text) noexcept
+{
+    const std::size_t n = text.size() / 4 * 4;
+    std::size_t padding = 0;
+    if (n > 0 && text[n - 1] == '=') {
+        padding = text[n - 2] == '=' ? 2 : 1;
+    }
+    return n / 4 * 3 - padding;
+}
+
+inline std::size_t hex_encoded_size(span<const byte> data) noexcept
+{
+    return 2 * data.size();
+}
+
+inline std::size_t hex_decoded_size(span<const char> text) noexcept
+{
+    return text.size() / 2;
+}
+
+// Encodes bytes as base64 with the standard alphabet and padding (RFC 4648),
+// returning the prefixes of the input consumed and the output produced.
+// Encoding stops early if the output is full; the final one or two bytes of
+// the input are encoded with padding, so when encoding a stream in pieces,
+// all but the last piece should be a multiple of three bytes.
+inline codec_result<const byte, char> base64_encode(span<const byte> in,
+                                                    span<char> out) noexcept
+{
+    auto p = reinterpret_cast<const unsigned char*>(in.data());
+    std::size_t n = in.size();
+    char* o = out.data();
+    std::size_t m = out.size();
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+    if (detail::cpu().avx512vbmi && detail::cpu().avx512bw) {
+        detail::base64_encode_vbmi(p, n, o, m);
+    }
+    if (detail::cpu().avx2) {
+        detail::base64_encode_avx2(p, n, o, m);
+    }
+#endif
+    detail::base64_encode_scalar(p, n, o, m);
+    if (n > 0 && n < 3 && m >= 4) {
+        const char* alphabet = detail::base64_tables().encode;
+        const unsigned b1 = n == 2 ? p[1] : 0u;
+        o[0] = alphabet[p[0] >> 2];
+        o[1] = alphabet[(p[0] & 0x03) << 4 | b1 >> 4];
+        o[2] = n == 2 ? alphabet[(b1 & 0x0f) << 2] : '=';
+        o[3] = '=';
+        p += n;
+        o += 4;
+    }
+    return {in.first(static_cast<std::size_t>(
+                p - reinterpret_cast<const unsigned char*>(in.data()))),
+            out.first(static_cast<std::size_t>(o - out.data()))};
+}
+
+// Decodes padded base64 in the standard alphabet. Decoding stops at the
+// first group of four characters which is not valid, at the end of a group
+// with padding, or when the output is full; an incomplete group at the end
+// of the input is left unconsumed. Whitespace is not skipped.
+inline codec_result<const char, byte> base64_decode(span<const char> in,
+                                                    span<byte> out) noexcept
+{
+    const char* p = in.data();
+    std::size_t n = in.size();
+    auto o = reinterpret_cast<unsigned char*>(out.data());
+    std::size_t m = out.size();
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+    if (detail::cpu().avx512vbmi && detail::cpu().avx512bw) {
+        detail::base64_decode_vbmi(p, n, o, m);
+    }
+    if (detail::cpu().avx2) {
+        detail::base64_decode_avx2(p, n, o, m);
+    }
+#endif
+    detail::base64_decode_scalar(p, n, o, m);
+    if (n >= 4 && p[3] == '=') {
+        const unsigned char* decode = detail::base64_tables().decode;
+        const unsigned a = decode[static_cast<unsigned char>(p[0])];
+        const unsigned b = decode[static_cast<unsigned char>(p[1])];
+        const bool one = p[2] == '=';
+        const unsigned c = one ? 0u : decode[static_cast<unsigned char>(p[2])];
+        const std::size_t bytes = one ? 1 : 2;
+        if (((a | b | c) & 0x80) == 0 && m >= bytes) {
+            const std::uint32_t v = a << 18 | b << 12 | c << 6;
+            o[0] = static_cast<unsigned char>(v >> 16);
+            if (!one) {
+                o[1] = static_cast<unsigned char>(v >> 8);
+            }
+            p += 4;
+            o += bytes;
+        }
+    }
+    return {in.first(static_cast<std::size_t>(p - in.data())),
+            out.first(static_cast<std::size_t>(
+                o - reinterpret_cast<unsigned char*>(out.data())))};
+}
+
+// Encodes bytes as pairs of lower-case hexadecimal digits, stopping early
+// if the output is full
+inline codec_result<const byte, char> hex_encode(span<const byte> in,
+                                                 span<char> out) noexcept
+{
+    auto p = reinterpret_cast<const unsigned char*>(in.data());
+    std::size_t n = in.size();
+    char* o = out.data();
+    std::size_t m = out.size();
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+    if (detail::cpu().avx2) {
+        detail::hex_encode_avx2(p, n, o, m);
+    }
+#endif
+    const char digits[] = "0123456789abcdef";
+    for (; n > 0 && m >= 2; p++, n--, o += 2, m -= 2) {
+        o[0] = digits[*p >> 4];
+        o[1] = digits[*p & 0x0f];
+    }
+    return {in.first(static_cast<std::size_t>(
+                p - reinterpret_cast<const unsigned char*>(in.data()))),
+            out.first(static_cast<std::size_t>(o - out.data()))};
+}
+
+// Decodes pairs of hexadecimal digits of either case, stopping at the first
+// pair which is not valid or when the output is full. An odd final digit is
+// left unconsumed.
+inline codec_result<const char, byte> hex_decode(span<const char> in,
+                                                 span<byte> out) noexcept
+{
+    const char* p = in.data();
+    std::size_t n = in.size();
+    auto o = reinterpret_cast<unsigned char*>(out.data());
+    std::size_t m = out.size();
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+    if (detail::cpu().avx2) {
+        detail::hex_decode_avx2(p, n, o, m);
+    }
+#endif
+    for (; n >= 2 && m > 0; p += 2, n -= 2, o++, m--) {
+        const unsigned hi = detail::hex_value(p[0]);
+        const unsigned lo = detail::hex_value(p[1]);
+        if ((hi | lo) & 0x10) {
+            break;
+        }
+        *o = static_cast<unsigned char>(hi << 4 | lo);
+    }
+    return {in.first(static_cast<std::size_t>(p - in.data())),
+            out.first(static_cast<std::size_t>(
+                o - reinterpret_cast<unsigned char*>(out.data())))};
+}
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_BASE64_HPP_INCLUDED
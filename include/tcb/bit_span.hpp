@@ -0,0 +1,534 @@
+
+/*
+A view of a span of 64-bit words as a sequence of bits, with bulk bitwise
+operations and an optional rank/select index
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_BIT_SPAN_HPP_INCLUDED
+#define TCB_BIT_SPAN_HPP_INCLUDED
+
+#include "span_ext.hpp"
+
+#include <algorithm>
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+namespace detail {
+
+// A mask of the bits below position n of a word, for n in [0, 64)
+inline std::uint64_t low_bits(unsigned n) noexcept
+{
+    return (std::uint64_t{1} << n) - 1;
+}
+
+inline std::size_t count_bits_scalar(const std::uint64_t* words,
+                                     std::size_t n) noexcept
+{
+    std::size_t c = 0;
+    for (std::size_t i = 0; i < n; i++) {
+        c += static_cast<std::size_t>(popcount64(words[i]));
+    }
+    return c;
+}
+
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+
+// popcount64() can only use the popcnt instruction if the compiler's target
+// has it, so provide a dispatched version for counting whole spans
+TCB_SPAN_TARGET("popcnt")
+inline std::size_t count_bits_popcnt(const std::uint64_t* words,
+                                     std::size_t n) noexcept
+{
+    // Independent accumulators let several popcnts run at once
+    std::size_t c[4] = {};
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        for (std::size_t j = 0; j < 4; j++) {
+#if defined(__x86_64__) || defined(_M_X64)
+            c[j] += static_cast<std::size_t>(_mm_popcnt_u64(words[i + j]));
+#else
+            c[j] += static_cast<std::size_t>(
+                _mm_popcnt_u32(static_cast<unsigned>(words[i + j])) +
+                _mm_popcnt_u32(static_cast<unsigned>(words[i + j] >> 32)));
+#endif
+        }
+    }
+    return c[0] + c[1] + c[2] + c[3] + count_bits_scalar(words + i, n - i);
+}
+
+#endif // TCB_SPAN_HAVE_X86_SIMD
+
+inline std::size_t count_bits(const std::uint64_t* words, std::size_t n)
+{
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+    if (cpu().popcnt) {
+        return count_bits_popcnt(words, n);
+    }
+#endif
+    return count_bits_scalar(words, n);
+}
+
+enum class bit_op { and_, or_, xor_, andnot };
+
+template <bit_op Op>
+std::uint64_t apply_bit_op(std::uint64_t a, std::uint64_t b) noexcept
+{
+    return Op == bit_op::and_   ? a & b
+           : Op == bit_op::or_  ? a | b
+           : Op == bit_op::xor_ ? a ^ b
+                                : a & ~b;
+}
+
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+
+template <bit_op Op>
+TCB_SPAN_TARGET("avx2")
+std::size_t combine_bits_avx2(const std::uint64_t* a, const std::uint64_t* b,
+                              std::uint64_t* dst, std::size_t n) noexcept
+{
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256i va =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        const __m256i vb =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        const __m256i r = Op == bit_op::and_   ? _mm256_and_si256(va, vb)
+                          : Op == bit_op::or_  ? _mm256_or_si256(va, vb)
+                          : Op == bit_op::xor_ ? _mm256_xor_si256(va, vb)
+                                               : _mm256_andnot_si256(vb, va);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), r);
+    }
+    return i;
+}
+
+#endif // TCB_SPAN_HAVE_X86_SIMD
+
+// Combines the first bits bits of a and b into dst, leaving any bits of dst's
+// last word beyond them unchanged. Each word is read before it is written, so
+// dst may alias a or b.
+template <bit_op Op>
+void combine_bits(const std::uint64_t* a, const std::uint64_t* b,
+                  std::uint64_t* dst, std::size_t bits)
+{
+    const std::size_t full = bits / 64;
+    std::size_t i = 0;
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+    if (cpu().avx2) {
+        i = combine_bits_avx2<Op>(a, b, dst, full);
+    }
+#endif
+    for (; i < full; i++) {
+        dst[i] = apply_bit_op<Op>(a[i], b[i]);
+    }
+    const unsigned tail = static_cast<unsigned>(bits % 64);
+    if (tail > 0) {
+        const std::uint64_t mask = low_bits(tail);
+        dst[full] = (dst[full] & ~mask) |
+                    (apply_bit_op<Op>(a[full], b[full]) & mask);
+    }
+}
+
+// The index of the k-th (from zero) set bit of w, which must have more than
+// k bits set
+inline unsigned select64(std::uint64_t w, unsigned k) noexcept
+{
+    unsigned base = 0;
+    for (;; base += 8, w >>= 8) {
+        const unsigned c = static_cast<unsigned>(popcount64(w & 0xff));
+        if (k < c) {
+            break;
+        }
+        k -= c;
+    }
+    for (; k > 0; k--) {
+        w &= w - 1;
+    }
+    return base + static_cast<unsigned>(ctz64(w));
+}
+
+} // namespace detail
+
+// A view of the first size bits of a span of 64-bit words, where bit i is bit
+// i % 64 of word i / 64. Bits are read and written through test() and set(),
+// or through operator[], which returns a proxy reference when Word is
+// non-const. Whole-view operations work a word at a time.
+//
+// As with span, constness is expressed through the Word parameter: a
+// bit_span<const std::uint64_t> is read-only.
+template <typename Word = std::uint64_t>
+class bit_span {
+    static_assert(std::is_same<typename std::remove_cv<Word>::type,
+                               std::uint64_t>::value,
+                  "bit_span requires 64-bit words");
+
+public:
+    using word_type = Word;
+    using size_type = std::size_t;
+
+    // A proxy for a single bit
+    class reference {
+    public:
+        reference(const reference&) = default;
+
+        reference& operator=(bool value)
+        {
+            const std::uint64_t mask = std::uint64_t{1} << (index_ % 64);
+            Word& w = words_[index_ / 64];
+            w = value ? (w | mask) : (w & ~mask);
+            return *this;
+        }
+
+        reference& operator=(const reference& other)
+        {
+            return *this = static_cast<bool>(other);
+        }
+
+        operator bool() const
+        {
+            return (words_[index_ / 64] >> (index_ % 64)) & 1;
+        }
+
+        bool operator~() const { return !static_cast<bool>(*this); }
+
+        reference& flip()
+        {
+            words_[index_ / 64] ^= std::uint64_t{1} << (index_ % 64);
+            return *this;
+        }
+
+    private:
+        friend class bit_span;
+
+        reference(Word* words, size_type index)
+            : words_(words), index_(index)
+        {}
+
+        Word* words_;
+        size_type index_;
+    };
+
+    // The number of words needed to hold count bits
+    static constexpr size_type words_needed(size_type count) noexcept
+    {
+        return (count + 63) / 64;
+    }
+
+    constexpr bit_span() noexcept = default;
+
+    bit_span(span<Word> words, size_type count) : words_(words), size_(count)
+    {
+        TCB_SPAN_EXPECT(words_needed(count) <= words.size());
+    }
+
+    // Views every bit of words
+    explicit bit_span(span<Word> words)
+        : words_(words), size_(64 * words.size())
+    {}
+
+    template <typename OtherWord,
+              typename std::enable_if<
+                  std::is_convertible<OtherWord (*)[], Word (*)[]>::value,
+                  int>::type = 0>
+    bit_span(const bit_span<OtherWord>& other) noexcept
+        : words_(other.words()), size_(other.size())
+    {}
+
+    // observers
+    span<Word> words() const noexcept { return words_; }
+    size_type size() const noexcept { return size_; }
+    TCB_SPAN_NODISCARD bool empty() const noexcept { return size_ == 0; }
+
+    // The first count bits, sharing the same words
+    bit_span first(size_type count) const
+    {
+        TCB_SPAN_EXPECT(count <= size_);
+        return bit_span(words_, count);
+    }
+
+    // element access
+    bool test(size_type idx) const
+    {
+        TCB_SPAN_EXPECT(idx < size_);
+        return (words_[idx / 64] >> (idx % 64)) & 1;
+    }
+
+    typename std::conditional<std::is_const<Word>::value, bool,
+                              reference>::type
+    operator[](size_type idx) const
+    {
+        TCB_SPAN_EXPECT(idx < size_);
+        return access(idx, std::is_const<Word>{});
+    }
+
+    // modifiers
+    void set(size_type idx, bool value = true) const
+    {
+        static_assert(!std::is_const<Word>::value,
+                      "Cannot modify a bit_span of const words");
+        TCB_SPAN_EXPECT(idx < size_);
+        reference(words_.data(), idx) = value;
+    }
+
+    void reset(size_type idx) const { set(idx, false); }
+
+    void flip(size_type idx) const
+    {
+        static_assert(!std::is_const<Word>::value,
+                      "Cannot modify a bit_span of const words");
+        TCB_SPAN_EXPECT(idx < size_);
+        reference(words_.data(), idx).flip();
+    }
+
+    // Sets every bit to value, leaving any bits of the last word beyond
+    // size() unchanged
+    void fill(bool value) const
+    {
+        static_assert(!std::is_const<Word>::value,
+                      "Cannot modify a bit_span of const words");
+        const std::uint64_t w = value ? ~std::uint64_t{0} : 0;
+        const size_type full = size_ / 64;
+        std::fill(words_.data(), words_.data() + full, w);
+        if (size_ % 64 != 0) {
+            const std::uint64_t mask =
+                detail::low_bits(static_cast<unsigned>(size_ % 64));
+            words_[full] = (words_[full] & ~mask) | (w & mask);
+        }
+    }
+
+    // whole-view queries
+
+    // The number of set bits
+    size_type count() const
+    {
+        const size_type full = size_ / 64;
+        size_type c = detail::count_bits(words_.data(), full);
+        if (size_ % 64 != 0) {
+            c += static_cast<size_type>(detail::popcount64(
+                tail_word(full)));
+        }
+        return c;
+    }
+
+    bool any() const { return find_first() != size_; }
+    bool none() const { return !any(); }
+
+    // The index of the first set bit, or size() if there are none
+    size_type find_first() const { return find_from(0); }
+
+    // The index of the first set bit after pos, or size() if there are none
+    size_type find_next(size_type pos) const
+    {
+        TCB_SPAN_EXPECT(pos < size_);
+        return find_from(pos + 1);
+    }
+
+private:
+    bool access(size_type idx, std::true_type) const
+    {
+        return (words_[idx / 64] >> (idx % 64)) & 1;
+    }
+
+    reference access(size_type idx, std::false_type) const
+    {
+        return reference(words_.data(), idx);
+    }
+
+    // Word w, with any bits at or beyond size() cleared
+    std::uint64_t tail_word(size_type w) const
+    {
+        const size_type end = size_ - 64 * w;
+        return end >= 64 ? words_[w]
+                         : words_[w] & detail::low_bits(
+                                           static_cast<unsigned>(end));
+    }
+
+    size_type find_from(size_type pos) const
+    {
+        if (pos >= size_) {
+            return size_;
+        }
+        size_type w = pos / 64;
+        std::uint64_t bits =
+            tail_word(w) &
+            ~detail::low_bits(static_cast<unsigned>(pos % 64));
+        const size_type num_words = words_needed(size_);
+        while (bits == 0) {
+            if (++w == num_words) {
+                return size_;
+            }
+            bits = tail_word(w);
+        }
+        return 64 * w + static_cast<size_type>(detail::ctz64(bits));
+    }
+
+    span<Word> words_{};
+    size_type size_ = 0;
+};
+
+// Bulk bitwise operations. Each combines two bit_spans of the same size into
+// dst, which must be at least as large and may be the same as either input,
+// and returns the written part of dst. Whole words are processed with AVX2
+// where available.
+
+template <typename W1, typename W2>
+bit_span<> bit_and(bit_span<W1> a, bit_span<W2> b, bit_span<> dst)
+{
+    TCB_SPAN_EXPECT(a.size() == b.size() && a.size() <= dst.size());
+    detail::combine_bits<detail::bit_op::and_>(
+        a.words().data(), b.words().data(), dst.words().data(), a.size());
+    return dst.first(a.size());
+}
+
+template <typename W1, typename W2>
+bit_span<> bit_or(bit_span<W1> a, bit_span<W2> b, bit_span<> dst)
+{
+    TCB_SPAN_EXPECT(a.size() == b.size() && a.size() <= dst.size());
+    detail::combine_bits<detail::bit_op::or_>(
+        a.words().data(), b.words().data(), dst.words().data(), a.size());
+    return dst.first(a.size());
+}
+
+template <typename W1, typename W2>
+bit_span<> bit_xor(bit_span<W1> a, bit_span<W2> b, bit_span<> dst)
+{
+    TCB_SPAN_EXPECT(a.size() == b.size() && a.size() <= dst.size());
+    detail::combine_bits<detail::bit_op::xor_>(
+        a.words().data(), b.words().data(), dst.words().data(), a.size());
+    return dst.first(a.size());
+}
+
+// Sets the bits of dst which are set in a but not in b
+template <typename W1, typename W2>
+bit_span<> bit_andnot(bit_span<W1> a, bit_span<W2> b, bit_span<> dst)
+{
+    TCB_SPAN_EXPECT(a.size() == b.size() && a.size() <= dst.size());
+    detail::combine_bits<detail::bit_op::andnot>(
+        a.words().data(), b.words().data(), dst.words().data(), a.size());
+    return dst.first(a.size());
+}
+
+// A rank/select index over a bit_span, stored in a separate span of words.
+//
+// The bits are divided into blocks of 512 (eight words). For each block the
+// index stores the number of set bits before it, and (in nine bits each) the
+// number set in its first 1, 2, ..., 7 words, so that rank() needs only two
+// index lookups and a popcount. select() binary searches the block counts.
+// The index occupies two words per block, or 1/4 of the size of the bits.
+//
+// The index describes the bits as they were when it was built.
+class bit_rank_index {
+public:
+    using size_type = std::size_t;
+
+    // The number of words of storage needed to index count bits
+    static constexpr size_type storage_size(size_type count) noexcept
+    {
+        return 2 * ((count + 511) / 512);
+    }
+
+    bit_rank_index() noexcept = default;
+
+    bit_rank_index(bit_span<const std::uint64_t> bits,
+                   span<std::uint64_t> storage)
+        : bits_(bits), index_(storage.first(storage_size(bits.size())))
+    {
+        TCB_SPAN_EXPECT(storage_size(bits.size()) <= storage.size());
+
+        const size_type num_words = bit_span<>::words_needed(bits.size());
+        size_type total = 0;
+        for (size_type block = 0; 2 * block < index_.size(); block++) {
+            std::uint64_t sub = 0;
+            size_type in_block = 0;
+            for (unsigned j = 0; j < 8; j++) {
+                if (j > 0) {
+                    sub |= static_cast<std::uint64_t>(in_block)
+                           << (9 * (j - 1));
+                }
+                const size_type w = 8 * block + j;
+                if (w < num_words) {
+                    in_block += static_cast<size_type>(
+                        detail::popcount64(word(w)));
+                }
+            }
+            index_[2 * block] = total;
+            index_[2 * block + 1] = sub;
+            total += in_block;
+        }
+        count_ = total;
+    }
+
+    bit_span<const std::uint64_t> bits() const noexcept { return bits_; }
+
+    // The total number of set bits
+    size_type count() const noexcept { return count_; }
+
+    // The number of set bits before position pos, which may be size()
+    size_type rank(size_type pos) const
+    {
+        TCB_SPAN_EXPECT(pos <= bits_.size());
+        if (pos == bits_.size()) {
+            return count_;
+        }
+        const size_type w = pos / 64;
+        const size_type block = w / 8;
+        const unsigned j = static_cast<unsigned>(w % 8);
+        size_type r = static_cast<size_type>(index_[2 * block]);
+        if (j > 0) {
+            r += static_cast<size_type>(
+                (index_[2 * block + 1] >> (9 * (j - 1))) & 0x1ff);
+        }
+        return r + static_cast<size_type>(detail::popcount64(
+                       bits_.words()[w] &
+                       detail::low_bits(static_cast<unsigned>(pos % 64))));
+    }
+
+    // The position of the set bit with rank k, for k < count()
+    size_type select(size_type k) const
+    {
+        TCB_SPAN_EXPECT(k < count_);
+        // Find the last block starting with at most k set bits before it
+        size_type lo = 0;
+        size_type hi = index_.size() / 2;
+        while (hi - lo > 1) {
+            const size_type mid = lo + (hi - lo) / 2;
+            if (index_[2 * mid] <= k) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+        size_type rest = k - static_cast<size_type>(index_[2 * lo]);
+        const std::uint64_t sub = index_[2 * lo + 1];
+        unsigned j = 0;
+        while (j < 7 && ((sub >> (9 * j)) & 0x1ff) <= rest) {
+            ++j;
+        }
+        if (j > 0) {
+            rest -= static_cast<size_type>((sub >> (9 * (j - 1))) & 0x1ff);
+        }
+        const size_type w = 8 * lo + j;
+        return 64 * w + detail::select64(word(w), static_cast<unsigned>(rest));
+    }
+
+private:
+    // Word w of the bits, ignoring any beyond the end
+    std::uint64_t word(size_type w) const
+    {
+        const size_type end = bits_.size() - 64 * w;
+        return end >= 64 ? bits_.words()[w]
+                         : bits_.words()[w] &
+                               detail::low_bits(static_cast<unsigned>(end));
+    }
+
+    bit_span<const std::uint64_t> bits_{};
+    span<std::uint64_t> index_{};
+    size_type count_ = 0;
+};
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_BIT_SPAN_HPP_INCLUDED
@@ -0,0 +1,287 @@
+
+/*
+Content-defined chunking of byte spans, using FastCDC
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_CDC_HPP_INCLUDED
+#define TCB_CDC_HPP_INCLUDED
+
+#include "span_ext.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+
+// Parameters for content-defined chunking. Chunks are at least min_size
+// bytes and at most max_size bytes (apart from the last, which may be
+// shorter), and are about avg_size bytes on average. Normalization makes
+// boundaries less likely before avg_size bytes and more likely after it,
+// narrowing the distribution of chunk sizes around the average; each level
+// halves or doubles the probability.
+struct cdc_params {
+    std::size_t min_size = 2048;
+    std::size_t avg_size = 8192;
+    std::size_t max_size = 65536;
+    unsigned normalization = 2;
+};
+
+namespace detail {
+
+// The random values of the Gear hash, generated by splitmix64 from a fixed
+// seed. Chunk boundaries depend on these, so they must never change.
+struct cdc_gear_table {
+    std::uint64_t gear[256];
+
+    cdc_gear_table() noexcept
+    {
+        std::uint64_t state = 0;
+        for (std::uint64_t& g : gear) {
+            std::uint64_t z = (state += 0x9e3779b97f4a7c15u);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9u;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebu;
+            g = z ^ (z >> 31);
+        }
+    }
+};
+
+inline const std::uint64_t* cdc_gear() noexcept
+{
+    static const cdc_gear_table table;
+    return table.gear;
+}
+
+// The parameters in the form used while scanning. A boundary is declared
+// after a byte when the bits of the Gear hash selected by the mask are all
+// zero. The hash shifts left a bit per byte, so its high bits depend on the
+// most bytes; masks are taken from the top of the word.
+struct cdc_config {
+    std::size_t min_size = 0;
+    std::size_t avg_size = 0;
+    std::size_t max_size = 0;
+    std::uint64_t mask_small = 0;
+    std::uint64_t mask_large = 0;
+
+    static std::uint64_t top_bits(unsigned n) noexcept
+    {
+        return n == 0 ? 0 : ~std::uint64_t{0} << (64 - n);
+    }
+
+    cdc_config() = default;
+
+    explicit cdc_config(const cdc_params& p)
+        : min_size(p.min_size), avg_size(p.avg_size), max_size(p.max_size)
+    {
+        TCB_SPAN_EXPECT(p.min_size <= p.avg_size &&
+                        p.avg_size <= p.max_size && p.avg_size > 0);
+        unsigned bits = 0;
+        while ((std::size_t{2} << bits) <= p.avg_size) {
+            ++bits;
+        }
+        TCB_SPAN_EXPECT(p.normalization <= bits && bits + p.normalization < 64);
+        mask_small = top_bits(bits + p.normalization);
+        mask_large = top_bits(bits - p.normalization);
+    }
+};
+
+// The position reached within the current chunk, carried between calls
+struct cdc_state {
+    std::size_t pos = 0;
+    std::uint64_t hash = 0;
+};
+
+struct cdc_cut {
+    std::size_t length;
+    bool boundary;
+};
+
+// Scans [p, p + n) for the end of the current chunk. Returns how many bytes
+// belong to it, and whether it ended there.
+inline cdc_cut cdc_scan(const cdc_config& c, cdc_state& s,
+                        const unsigned char* p, std::size_t n) noexcept
+{
+    const std::uint64_t* gear = cdc_gear();
+    std::size_t i = 0;
+    // The first min_size bytes of a chunk can never end it, so are skipped
+    // without hashing
+    if (s.pos < c.min_size) {
+        const std::size_t skip = (std::min)(n, c.min_size - s.pos);
+        i += skip;
+        s.pos += skip;
+    }
+
+    std::uint64_t h = s.hash;
+    const auto cut = [&s](std::size_t length) -> cdc_cut {
+        s = cdc_state{};
+        return cdc_cut{length, true};
+    };
+    if (s.pos < c.avg_size) {
+        const std::size_t end = i + (std::min)(n - i, c.avg_size - s.pos);
+        s.pos += end - i;
+        for (; i < end; i++) {
+            h = (h << 1) + gear[p[i]];
+            if ((h & c.mask_small) == 0) {
+                return cut(i + 1);
+            }
+        }
+    }
+    const std::size_t end = i + (std::min)(n - i, c.max_size - s.pos);
+    s.pos += end - i;
+    for (; i < end; i++) {
+        h = (h << 1) + gear[p[i]];
+        if ((h & c.mask_large) == 0) {
+            return cut(i + 1);
+        }
+    }
+    if (s.pos == c.max_size) {
+        return cut(i);
+    }
+    s.hash = h;
+    return cdc_cut{n, false};
+}
+
+} // namespace detail
+
+// The chunks of a span of bytes, as a lazily evaluated range of subspans.
+// Each chunk is found as the iterator reaches it; nothing is copied.
+class cdc_chunks {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = span<const byte>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const span<const byte>*;
+        using reference = span<const byte>;
+
+        iterator() = default;
+
+        reference operator*() const { return rest_.first(length_); }
+
+        iterator& operator++()
+        {
+            rest_ = rest_.subspan(length_);
+            find_end();
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        friend bool operator==(const iterator& a, const iterator& b)
+        {
+            return a.rest_.data() == b.rest_.data() &&
+                   a.rest_.size() == b.rest_.size();
+        }
+
+        friend bool operator!=(const iterator& a, const iterator& b)
+        {
+            return !(a == b);
+        }
+
+    private:
+        friend class cdc_chunks;
+
+        iterator(const detail::cdc_config& config, span<const byte> rest)
+            : config_(config), rest_(rest)
+        {
+            find_end();
+        }
+
+        void find_end()
+        {
+            detail::cdc_state state;
+            length_ = detail::cdc_scan(
+                          config_, state,
+                          reinterpret_cast<const unsigned char*>(rest_.data()),
+                          rest_.size())
+                          .length;
+        }
+
+        detail::cdc_config config_;
+        span<const byte> rest_{};
+        std::size_t length_ = 0;
+    };
+
+    cdc_chunks(span<const byte> data, const cdc_params& params = {})
+        : data_(data), config_(params)
+    {}
+
+    iterator begin() const { return iterator(config_, data_); }
+    iterator end() const
+    {
+        return iterator(config_, data_.subspan(data_.size()));
+    }
+
+private:
+    span<const byte> data_;
+    detail::cdc_config config_;
+};
+
+// Splits data into content-defined chunks using FastCDC: a Gear rolling hash
+// with cut-point skipping and normalized chunking. Chunk boundaries depend
+// only on nearby content, so an insertion or deletion changes only the
+// chunks around it, and identical regions of different inputs produce
+// identical chunks.
+template <typename B, std::size_t Extent>
+cdc_chunks content_defined_chunks(span<B, Extent> data,
+                                  const cdc_params& params = {})
+{
+    static_assert(std::is_same<typename std::remove_cv<B>::type, byte>::value,
+                  "content_defined_chunks() requires a span of bytes");
+    return cdc_chunks(data, params);
+}
+
+// Finds the same chunk boundaries as content_defined_chunks() in a stream
+// which arrives as a sequence of spans, without buffering it. A chunk may
+// span several inputs.
+//
+// Each call to next_boundary() scans the start of its input for the end of
+// the current chunk. It returns the number of bytes of the input which
+// belong to the chunk, and whether the chunk ends there; the rest of the
+// input should then be passed to the next call. Whatever remains when the
+// stream ends forms the final chunk.
+class cdc_chunker {
+public:
+    struct result {
+        std::size_t length;
+        bool boundary;
+    };
+
+    explicit cdc_chunker(const cdc_params& params = {}) : config_(params) {}
+
+    template <typename B, std::size_t Extent>
+    result next_boundary(span<B, Extent> data)
+    {
+        static_assert(
+            std::is_same<typename std::remove_cv<B>::type, byte>::value,
+            "cdc_chunker requires a span of bytes");
+        const detail::cdc_cut c = detail::cdc_scan(
+            config_, state_,
+            reinterpret_cast<const unsigned char*>(data.data()), data.size());
+        return {c.length, c.boundary};
+    }
+
+    // The number of bytes of the current chunk seen so far
+    std::size_t chunk_size() const noexcept { return state_.pos; }
+
+    // Starts a new chunk, discarding any partial one
+    void reset() noexcept { state_ = detail::cdc_state{}; }
+
+private:
+    detail::cdc_config config_;
+    detail::cdc_state state_;
+};
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_CDC_HPP_INCLUDED
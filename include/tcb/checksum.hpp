@@ -0,0 +1,464 @@
+
+/*
+Checksums of span contents: CRC-32C, Adler-32 and XXH64
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_CHECKSUM_HPP_INCLUDED
+#define TCB_CHECKSUM_HPP_INCLUDED
+
+#include "span_ext.hpp"
+
+#include <algorithm>
+
+// The hardware CRC-32C kernel uses the 64-bit crc32 instruction
+#if defined(TCB_SPAN_HAVE_X86_SIMD) && (defined(__x86_64__) || defined(_M_X64))
+#define TCB_SPAN_HAVE_HW_CRC32C
+#endif
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+namespace detail {
+
+// CRC-32C
+//
+// The CRC is computed on bit-reflected polynomials over GF(2), reduced modulo
+// the Castagnoli polynomial. Internally the state is kept without the
+// initial and final inversions, which makes the update linear: the state
+// after a message AB is the state after A multiplied by x^(8 |B|), plus the
+// state after B alone. That is what allows separately computed CRCs to be
+// combined.
+
+constexpr std::uint32_t crc32c_poly = 0x82f63b78u;
+
+// a * b mod P
+inline std::uint32_t crc32c_multmodp(std::uint32_t a, std::uint32_t b) noexcept
+{
+    std::uint32_t m = std::uint32_t{1} << 31;
+    std::uint32_t p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) {
+                break;
+            }
+        }
+        m >>= 1;
+        b = b & 1 ? (b >> 1) ^ crc32c_poly : b >> 1;
+    }
+    return p;
+}
+
+struct crc32c_tables {
+    // Tables for the slicing-by-8 software implementation
+    std::uint32_t slice[8][256];
+    // x^(2^k) mod P
+    std::uint32_t x2n[67];
+
+    crc32c_tables() noexcept
+    {
+        for (std::uint32_t i = 0; i < 256; i++) {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = c & 1 ? (c >> 1) ^ crc32c_poly : c >> 1;
+            }
+            slice[0][i] = c;
+        }
+        for (std::uint32_t i = 0; i < 256; i++) {
+            for (int t = 1; t < 8; t++) {
+                const std::uint32_t c = slice[t - 1][i];
+                slice[t][i] = (c >> 8) ^ slice[0][c & 0xff];
+            }
+        }
+        x2n[0] = std::uint32_t{1} << 30; // x^1
+        for (int k = 1; k < 67; k++) {
+            x2n[k] = crc32c_multmodp(x2n[k - 1], x2n[k - 1]);
+        }
+    }
+};
+
+inline const crc32c_tables& crc32c_table() noexcept
+{
+    static const crc32c_tables tables;
+    return tables;
+}
+
+// x^(n * 2^k) mod P, for k <= 3
+inline std::uint32_t crc32c_xpow(std::uint64_t n, unsigned k) noexcept
+{
+    const std::uint32_t* x2n = crc32c_table().x2n;
+    std::uint32_t p = std::uint32_t{1} << 31; // x^0
+    for (; n != 0; n >>= 1, k++) {
+        if (n & 1) {
+            p = crc32c_multmodp(x2n[k], p);
+        }
+    }
+    return p;
+}
+
+inline std::uint32_t crc32c_sw(std::uint32_t crc, const unsigned char* p,
+                               std::size_t n) noexcept
+{
+    const auto& t = crc32c_table().slice;
+    for (; n >= 8; p += 8, n -= 8) {
+        const std::uint32_t lo = load_le32(p) ^ crc;
+        const std::uint32_t hi = load_le32(p + 4);
+        crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^
+              t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^
+              t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+    }
+    for (; n > 0; p++, n--) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xff];
+    }
+    return crc;
+}
+
+#if defined(TCB_SPAN_HAVE_HW_CRC32C)
+
+// Multiplies crc by x^(8 * len) mod P, given k = x^(8 * len - 33) mod P. The
+// carry-less product has degree below 64, and crc32 of it from a zero state
+// multiplies by a further x^32 and reduces; the remaining factor of x comes
+// from the bit reflection of the product.
+TCB_SPAN_TARGET("sse4.2,pclmul")
+inline std::uint32_t crc32c_shift_clmul(std::uint32_t crc,
+                                        std::uint32_t k) noexcept
+{
+    const __m128i prod =
+        _mm_clmulepi64_si128(_mm_cvtsi32_si128(static_cast<int>(crc)),
+                             _mm_cvtsi32_si128(static_cast<int>(k)), 0);
+    return static_cast<std::uint32_t>(_mm_crc32_u64(
+        0, static_cast<std::uint64_t>(_mm_cvtsi128_si64(prod))));
+}
+
+// The crc32 instruction has a latency of three cycles but a throughput of
+// one, so blocks of 3 * Len bytes are processed as three independent streams
+// and their CRCs combined afterwards
+template <std::size_t Len>
+TCB_SPAN_TARGET("sse4.2,pclmul")
+std::uint32_t crc32c_3way(std::uint32_t crc, const unsigned char*& p,
+                          std::size_t& n, std::uint32_t k1,
+                          std::uint32_t k2) noexcept
+{
+    for (; n >= 3 * Len; p += 3 * Len, n -= 3 * Len) {
+        std::uint64_t c0 = crc;
+        std::uint64_t c1 = 0;
+        std::uint64_t c2 = 0;
+        for (std::size_t i = 0; i < Len; i += 8) {
+            c0 = _mm_crc32_u64(c0, load_le64(p + i));
+            c1 = _mm_crc32_u64(c1, load_le64(p + Len + i));
+            c2 = _mm_crc32_u64(c2, load_le64(p + 2 * Len + i));
+        }
+        crc = crc32c_shift_clmul(static_cast<std::uint32_t>(c0), k2) ^
+              crc32c_shift_clmul(static_cast<std::uint32_t>(c1), k1) ^
+              static_cast<std::uint32_t>(c2);
+    }
+    return crc;
+}
+
+struct crc32c_shift_constants {
+    std::uint32_t long1, long2, short1, short2;
+
+    crc32c_shift_constants() noexcept
+        : long1(crc32c_xpow(8 * 8192 - 33, 0)),
+          long2(crc32c_xpow(8 * 16384 - 33, 0)),
+          short1(crc32c_xpow(8 * 256 - 33, 0)),
+          short2(crc32c_xpow(8 * 512 - 33, 0))
+    {}
+};
+
+TCB_SPAN_TARGET("sse4.2,pclmul")
+inline std::uint32_t crc32c_hw(std::uint32_t crc, const unsigned char* p,
+                               std::size_t n) noexcept
+{
+    static const crc32c_shift_constants k;
+    for (; n > 0 && reinterpret_cast<std::uintptr_t>(p) % 8 != 0; p++, n--) {
+        crc = _mm_crc32_u8(crc, *p);
+    }
+    crc = crc32c_3way<8192>(crc, p, n, k.long1, k.long2);
+    crc = crc32c_3way<256>(crc, p, n, k.short1, k.short2);
+    std::uint64_t c = crc;
+    for (; n >= 8; p += 8, n -= 8) {
+        c = _mm_crc32_u64(c, load_le64(p));
+    }
+    crc = static_cast<std::uint32_t>(c);
+    for (; n > 0; p++, n--) {
+        crc = _mm_crc32_u8(crc, *p);
+    }
+    return crc;
+}
+
+#endif // TCB_SPAN_HAVE_HW_CRC32C
+
+inline std::uint32_t crc32c_bytes(const unsigned char* p, std::size_t n,
+                                  std::uint32_t crc)
+{
+    crc = ~crc;
+#if defined(TCB_SPAN_HAVE_HW_CRC32C)
+    if (cpu().sse42 && cpu().pclmul) {
+        return ~crc32c_hw(crc, p, n);
+    }
+#endif
+    return ~crc32c_sw(crc, p, n);
+}
+
+// The fewest bytes per thread. The hardware CRC already runs at memory
+// speeds, so a thread only helps once its chunk takes well over the cost of
+// starting it; joining the results is cheap by comparison.
+constexpr std::size_t crc32c_parallel_chunk = std::size_t{1} << 20;
+
+// Adler-32
+
+constexpr std::uint32_t adler_base = 65521;
+// The most bytes which can be summed before s2 might overflow 32 bits
+constexpr std::size_t adler_nmax = 5552;
+
+inline void adler32_scalar(std::uint32_t& s1, std::uint32_t& s2,
+                           const unsigned char* p, std::size_t n) noexcept
+{
+    while (n > 0) {
+        std::size_t len = (std::min)(n, adler_nmax);
+        n -= len;
+        for (; len > 0; len--) {
+            s1 += *p++;
+            s2 += s1;
+        }
+        s1 %= adler_base;
+        s2 %= adler_base;
+    }
+}
+
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+
+// Sums blocks of 32 bytes: psadbw adds up the bytes for s1, and pmaddubsw
+// weights each byte by its distance from the end of the block for s2. The
+// contribution of earlier blocks' s1 to s2 is accumulated separately, and
+// multiplied by the block size at the end.
+TCB_SPAN_TARGET("ssse3")
+inline void adler32_ssse3(std::uint32_t& s1, std::uint32_t& s2,
+                          const unsigned char*& p, std::size_t& n) noexcept
+{
+    const __m128i tap1 = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24,
+                                       23, 22, 21, 20, 19, 18, 17);
+    const __m128i tap2 =
+        _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+
+    std::size_t blocks = n / 32;
+    n -= blocks * 32;
+    while (blocks > 0) {
+        std::size_t count = (std::min)(blocks, adler_nmax / 32);
+        blocks -= count;
+
+        __m128i v_ps = _mm_set_epi32(0, 0, 0, static_cast<int>(s1 * count));
+        __m128i v_s2 = _mm_set_epi32(0, 0, 0, static_cast<int>(s2));
+        __m128i v_s1 = zero;
+        for (; count > 0; count--, p += 32) {
+            const __m128i b1 =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            const __m128i b2 =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+            v_ps = _mm_add_epi32(v_ps, v_s1);
+            v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(b1, zero));
+            v_s2 = _mm_add_epi32(
+                v_s2, _mm_madd_epi16(_mm_maddubs_epi16(b1, tap1), ones));
+            v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(b2, zero));
+            v_s2 = _mm_add_epi32(
+                v_s2, _mm_madd_epi16(_mm_maddubs_epi16(b2, tap2), ones));
+        }
+        v_s2 = _mm_add_epi32(v_s2, _mm_slli_epi32(v_ps, 5));
+
+        v_s1 = _mm_add_epi32(v_s1, _mm_shuffle_epi32(v_s1, 0xb1));
+        v_s1 = _mm_add_epi32(v_s1, _mm_shuffle_epi32(v_s1, 0x4e));
+        s1 += static_cast<std::uint32_t>(_mm_cvtsi128_si32(v_s1));
+        v_s2 = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, 0xb1));
+        v_s2 = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, 0x4e));
+        s2 = static_cast<std::uint32_t>(_mm_cvtsi128_si32(v_s2));
+
+        s1 %= adler_base;
+        s2 %= adler_base;
+    }
+}
+
+#endif // TCB_SPAN_HAVE_X86_SIMD
+
+inline std::uint32_t adler32_bytes(const unsigned char* p, std::size_t n,
+                                   std::uint32_t adler)
+{
+    std::uint32_t s1 = adler & 0xffff;
+    std::uint32_t s2 = adler >> 16;
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+    if (cpu().ssse3) {
+        adler32_ssse3(s1, s2, p, n);
+    }
+#endif
+    adler32_scalar(s1, s2, p, n);
+    return s2 << 16 | s1;
+}
+
+// XXH64
+
+constexpr std::uint64_t xxh64_prime1 = 0x9e3779b185ebca87u;
+constexpr std::uint64_t xxh64_prime2 = 0xc2b2ae3d27d4eb4fu;
+constexpr std::uint64_t xxh64_prime3 = 0x165667b19e3779f9u;
+constexpr std::uint64_t xxh64_prime4 = 0x85ebca77c2b2ae63u;
+constexpr std::uint64_t xxh64_prime5 = 0x27d4eb2f165667c5u;
+
+inline std::uint64_t rotl64(std::uint64_t x, unsigned r) noexcept
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+inline std::uint64_t xxh64_round(std::uint64_t acc, std::uint64_t input)
+{
+    acc += input * xxh64_prime2;
+    return rotl64(acc, 31) * xxh64_prime1;
+}
+
+inline std::uint64_t xxh64_merge(std::uint64_t acc, std::uint64_t v)
+{
+    acc ^= xxh64_round(0, v);
+    return acc * xxh64_prime1 + xxh64_prime4;
+}
+
+inline std::uint64_t xxh64_bytes(const unsigned char* p, std::size_t n,
+                                 std::uint64_t seed) noexcept
+{
+    const unsigned char* const end = p + n;
+    std::uint64_t h;
+    if (n >= 32) {
+        std::uint64_t v1 = seed + xxh64_prime1 + xxh64_prime2;
+        std::uint64_t v2 = seed + xxh64_prime2;
+        std::uint64_t v3 = seed;
+        std::uint64_t v4 = seed - xxh64_prime1;
+        for (; end - p >= 32; p += 32) {
+            v1 = xxh64_round(v1, load_le64(p));
+            v2 = xxh64_round(v2, load_le64(p + 8));
+            v3 = xxh64_round(v3, load_le64(p + 16));
+            v4 = xxh64_round(v4, load_le64(p + 24));
+        }
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = xxh64_merge(h, v1);
+        h = xxh64_merge(h, v2);
+        h = xxh64_merge(h, v3);
+        h = xxh64_merge(h, v4);
+    } else {
+        h = seed + xxh64_prime5;
+    }
+    h += static_cast<std::uint64_t>(n);
+
+    for (; end - p >= 8; p += 8) {
+        h ^= xxh64_round(0, load_le64(p));
+        h = rotl64(h, 27) * xxh64_prime1 + xxh64_prime4;
+    }
+    if (end - p >= 4) {
+        h ^= static_cast<std::uint64_t>(load_le32(p)) * xxh64_prime1;
+        h = rotl64(h, 23) * xxh64_prime2 + xxh64_prime3;
+        p += 4;
+    }
+    for (; p != end; p++) {
+        h ^= *p * xxh64_prime5;
+        h = rotl64(h, 11) * xxh64_prime1;
+    }
+
+    h ^= h >> 33;
+    h *= xxh64_prime2;
+    h ^= h >> 29;
+    h *= xxh64_prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+template <typename T, std::size_t Extent>
+const unsigned char* checksum_bytes(span<T, Extent> data) noexcept
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Checksums require a trivially copyable element type");
+    return reinterpret_cast<const unsigned char*>(data.data());
+}
+
+} // namespace detail
+
+// Checksums of the bytes of a span. crc32c() and adler32() take the checksum
+// of any preceding data as their second argument, so that a stream can be
+// checksummed in parts.
+
+// The CRC-32C (Castagnoli) of data, as used by iSCSI, ext4 and many storage
+// formats. This uses the SSE4.2 crc32 instruction on three interleaved
+// streams where available, combining them with carry-less multiplication,
+// and a slicing-by-8 table otherwise.
+template <typename T, std::size_t Extent>
+std::uint32_t crc32c(span<T, Extent> data, std::uint32_t crc = 0)
+{
+    return detail::crc32c_bytes(detail::checksum_bytes(data),
+                                data.size_bytes(), crc);
+}
+
+// Given the CRC-32Cs of two blocks of data, the second of len2 bytes, returns
+// the CRC-32C of their concatenation
+inline std::uint32_t crc32c_combine(std::uint32_t crc1, std::uint32_t crc2,
+                                    std::uint64_t len2)
+{
+    return detail::crc32c_multmodp(detail::crc32c_xpow(len2, 3), crc1) ^ crc2;
+}
+
+// As crc32c(), but checksums chunks of large inputs on up to the given
+// number of threads, and combines the results
+template <typename T, std::size_t Extent>
+std::uint32_t
+crc32c_parallel(span<T, Extent> data, std::uint32_t crc = 0,
+                unsigned threads = std::thread::hardware_concurrency())
+{
+    const unsigned char* p = detail::checksum_bytes(data);
+    const std::size_t n = data.size_bytes();
+    const std::size_t max_threads = n / detail::crc32c_parallel_chunk;
+    if (threads > max_threads) {
+        threads = static_cast<unsigned>(max_threads);
+    }
+    if (threads <= 1) {
+        return detail::crc32c_bytes(p, n, crc);
+    }
+
+    const auto chunk_begin = [n, threads](unsigned c) {
+        return static_cast<std::size_t>(
+            static_cast<unsigned long long>(n) * c / threads);
+    };
+    std::vector<std::uint32_t> crcs(threads);
+    detail::run_concurrently(threads, [&](unsigned c) {
+        const std::size_t first = chunk_begin(c);
+        crcs[c] = detail::crc32c_bytes(p + first, chunk_begin(c + 1) - first,
+                                       c == 0 ? crc : 0);
+    });
+    std::uint32_t result = crcs[0];
+    for (unsigned c = 1; c < threads; c++) {
+        result = crc32c_combine(result, crcs[c],
+                                chunk_begin(c + 1) - chunk_begin(c));
+    }
+    return result;
+}
+
+// The Adler-32 checksum of data, as used by zlib. Blocks of 32 bytes are
+// summed with SSSE3 where available.
+template <typename T, std::size_t Extent>
+std::uint32_t adler32(span<T, Extent> data, std::uint32_t adler = 1)
+{
+    return detail::adler32_bytes(detail::checksum_bytes(data),
+                                 data.size_bytes(), adler);
+}
+
+// The 64-bit xxHash (XXH64) of data with the given seed. Unlike the others,
+// this cannot be continued from a previous result.
+template <typename T, std::size_t Extent>
+std::uint64_t xxh64(span<T, Extent> data, std::uint64_t seed = 0)
+{
+    return detail::xxh64_bytes(detail::checksum_bytes(data),
+                               data.size_bytes(), seed);
+}
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_CHECKSUM_HPP_INCLUDED
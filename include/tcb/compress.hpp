@@ -0,0 +1,247 @@
+
+/*
+Branch-free stream compaction (filtering) from one span into another
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_COMPRESS_HPP_INCLUDED
+#define TCB_COMPRESS_HPP_INCLUDED
+
+#include "span_ext.hpp"
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+namespace detail {
+
+// Evaluates pred on Width consecutive elements, returning a bitmask of the
+// results. This is written so as not to branch on the predicate.
+template <std::size_t Width, typename T, typename Pred>
+unsigned predicate_mask(const T* in, Pred& pred)
+{
+    unsigned mask = 0;
+    for (std::size_t j = 0; j < Width; j++) {
+        mask |= static_cast<unsigned>(static_cast<bool>(pred(in[j]))) << j;
+    }
+    return mask;
+}
+
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+
+// For each 8-bit mask, the indices of the set bits packed into nibbles: the
+// lane permutation which moves the selected 32-bit elements to the front
+struct compress_permutation_table {
+    std::uint32_t perm[256];
+
+    compress_permutation_table() noexcept
+    {
+        for (unsigned m = 0; m < 256; m++) {
+            std::uint32_t packed = 0;
+            unsigned k = 0;
+            for (unsigned j = 0; j < 8; j++) {
+                if ((m >> j) & 1) {
+                    packed |= j << (4 * k++);
+                }
+            }
+            perm[m] = packed;
+        }
+    }
+};
+
+inline const std::uint32_t* compress_permutations() noexcept
+{
+    static const compress_permutation_table table;
+    return table.perm;
+}
+
+// The kernels below compact whole blocks of in while at least a block of
+// output space remains, advancing the input and output positions i and n.
+// Only the selected elements of each block are meaningful in the output, but
+// a whole block is stored.
+
+template <typename Pred>
+TCB_SPAN_TARGET("avx512f,popcnt")
+void compress_avx512(const std::uint32_t* in, std::size_t in_size,
+                     std::uint32_t* out, std::size_t out_size, std::size_t& i,
+                     std::size_t& n, Pred& pred)
+{
+    for (; i + 16 <= in_size && out_size - n >= 16; i += 16) {
+        const unsigned mask = predicate_mask<16>(in + i, pred);
+        const __m512i v = _mm512_loadu_si512(in + i);
+        _mm512_storeu_si512(out + n, _mm512_maskz_compress_epi32(
+                                         static_cast<__mmask16>(mask), v));
+        n += static_cast<std::size_t>(_mm_popcnt_u32(mask));
+    }
+}
+
+template <typename Pred>
+TCB_SPAN_TARGET("avx512f,popcnt")
+void compress_avx512(const std::uint64_t* in, std::size_t in_size,
+                     std::uint64_t* out, std::size_t out_size, std::size_t& i,
+                     std::size_t& n, Pred& pred)
+{
+    for (; i + 8 <= in_size && out_size - n >= 8; i += 8) {
+        const unsigned mask = predicate_mask<8>(in + i, pred);
+        const __m512i v = _mm512_loadu_si512(in + i);
+        _mm512_storeu_si512(out + n, _mm512_maskz_compress_epi64(
+                                         static_cast<__mmask8>(mask), v));
+        n += static_cast<std::size_t>(_mm_popcnt_u32(mask));
+    }
+}
+
+template <typename Pred>
+TCB_SPAN_TARGET("avx2,popcnt")
+void compress_avx2(const std::uint32_t* in, std::size_t in_size,
+                   std::uint32_t* out, std::size_t out_size, std::size_t& i,
+                   std::size_t& n, Pred& pred)
+{
+    const std::uint32_t* table = compress_permutations();
+    const __m256i shifts = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+    for (; i + 8 <= in_size && out_size - n >= 8; i += 8) {
+        const unsigned mask = predicate_mask<8>(in + i, pred);
+        const __m256i v =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        // permutevar8x32 only looks at the low three bits of each index
+        const __m256i perm = _mm256_srlv_epi32(
+            _mm256_set1_epi32(static_cast<int>(table[mask])), shifts);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + n),
+                            _mm256_permutevar8x32_epi32(v, perm));
+        n += static_cast<std::size_t>(_mm_popcnt_u32(mask));
+    }
+}
+
+template <typename Pred>
+TCB_SPAN_TARGET("avx2,popcnt")
+void compress_avx2(const std::uint64_t* in, std::size_t in_size,
+                   std::uint64_t* out, std::size_t out_size, std::size_t& i,
+                   std::size_t& n, Pred& pred)
+{
+    const std::uint32_t* table = compress_permutations();
+    const __m256i shifts = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+    for (; i + 4 <= in_size && out_size - n >= 4; i += 4) {
+        const unsigned mask = predicate_mask<4>(in + i, pred);
+        // Select both 32-bit halves of each chosen 64-bit element
+        const unsigned mask32 = (mask & 1) * 3 | (mask & 2) * 6 |
+                                (mask & 4) * 12 | (mask & 8) * 24;
+        const __m256i v =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        const __m256i perm = _mm256_srlv_epi32(
+            _mm256_set1_epi32(static_cast<int>(table[mask32])), shifts);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + n),
+                            _mm256_permutevar8x32_epi32(v, perm));
+        n += static_cast<std::size_t>(_mm_popcnt_u32(mask));
+    }
+}
+
+// Adapts a predicate on T to the integer type used by the kernels
+template <typename T, typename Word, typename Pred>
+struct word_predicate {
+    Pred& pred;
+
+    bool operator()(Word w) const
+    {
+        T t;
+        std::memcpy(&t, &w, sizeof(T));
+        return static_cast<bool>(pred(static_cast<const T&>(t)));
+    }
+};
+
+template <typename T, typename Pred>
+void compress_simd(const T* in, std::size_t in_size, T* out,
+                   std::size_t out_size, std::size_t& i, std::size_t& n,
+                   Pred& pred, std::true_type)
+{
+    using word = typename std::conditional<sizeof(T) == 4, std::uint32_t,
+                                           std::uint64_t>::type;
+    word_predicate<T, word, Pred> wpred{pred};
+    const word* win = reinterpret_cast<const word*>(in);
+    word* wout = reinterpret_cast<word*>(out);
+
+    const cpu_features& features = cpu();
+    if (features.avx512f && features.popcnt) {
+        compress_avx512(win, in_size, wout, out_size, i, n, wpred);
+    } else if (features.avx2 && features.popcnt) {
+        compress_avx2(win, in_size, wout, out_size, i, n, wpred);
+    }
+}
+
+#endif // TCB_SPAN_HAVE_X86_SIMD
+
+template <typename T, typename Pred>
+void compress_simd(const T*, std::size_t, T*, std::size_t, std::size_t&,
+                   std::size_t&, Pred&, std::false_type)
+{}
+
+template <typename T>
+struct is_simd_compressible {
+    static constexpr bool value = std::is_arithmetic<T>::value &&
+                                  (sizeof(T) == 4 || sizeof(T) == 8);
+};
+
+// Branch-free compaction for trivially copyable types: every element is
+// written, but the output position only advances past selected ones
+template <typename T, typename Pred>
+std::size_t compress_if_impl(const T* in, std::size_t in_size, T* out,
+                             std::size_t out_size, Pred& pred, std::true_type)
+{
+    std::size_t i = 0;
+    std::size_t n = 0;
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+    using use_simd =
+        std::integral_constant<bool, is_simd_compressible<T>::value>;
+    compress_simd(in, in_size, out, out_size, i, n, pred, use_simd{});
+#endif
+    for (; i < in_size && n < out_size; i++) {
+        out[n] = in[i];
+        n += static_cast<bool>(pred(in[i])) ? 1 : 0;
+    }
+    // The output is full: nothing else may be selected
+    for (; i < in_size; i++) {
+        TCB_SPAN_EXPECT(!pred(in[i]));
+    }
+    return n;
+}
+
+template <typename T, typename Pred>
+std::size_t compress_if_impl(const T* in, std::size_t in_size, T* out,
+                             std::size_t out_size, Pred& pred, std::false_type)
+{
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < in_size; i++) {
+        if (pred(in[i])) {
+            TCB_SPAN_EXPECT(n < out_size);
+            out[n++] = in[i];
+        }
+    }
+    (void) out_size;
+    return n;
+}
+
+} // namespace detail
+
+// Copies the elements of in for which pred returns true to the start of out,
+// preserving their order, and returns the filled prefix of out. out must be
+// large enough to hold every selected element; making it at least as large as
+// in always suffices.
+//
+// For trivially copyable types this is done without branching on the result
+// of pred, so elements of out beyond the returned prefix may be overwritten.
+// Blocks of 32- and 64-bit arithmetic types are compacted with AVX-512 or
+// AVX2 permutations where available.
+template <typename T, std::size_t InExtent, typename U, std::size_t OutExtent,
+          typename Pred>
+span<U> compress_if(span<T, InExtent> in, span<U, OutExtent> out, Pred pred)
+{
+    static_assert(std::is_same<typename std::remove_cv<T>::type, U>::value,
+                  "compress_if() requires matching input and output types");
+    const std::size_t n = detail::compress_if_impl(
+        in.data(), in.size(), out.data(), out.size(), pred,
+        std::integral_constant<bool, std::is_trivially_copyable<U>::value>{});
+    return out.first(n);
+}
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_COMPRESS_HPP_INCLUDED
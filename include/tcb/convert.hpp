@@ -0,0 +1,583 @@
+
+/*
+Element-wise numeric conversion between spans, with saturating integer
+narrowing and conversion to and from half-precision floating point
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_CONVERT_HPP_INCLUDED
+#define TCB_CONVERT_HPP_INCLUDED
+
+#include "span_ext.hpp"
+
+#include <limits>
+#include <type_traits>
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+
+// 16-bit floating-point values, held as their bit patterns: IEEE 754
+// binary16, and the "brain" format with the exponent range of float. These
+// are storage types only, converted to and from float with convert().
+
+struct float16 {
+    std::uint16_t bits;
+};
+
+struct bfloat16 {
+    std::uint16_t bits;
+};
+
+namespace detail {
+
+template <typename From, typename To>
+struct is_convertible_element
+    : std::integral_constant<bool, std::is_arithmetic<From>::value &&
+                                       std::is_arithmetic<To>::value> {};
+
+template <>
+struct is_convertible_element<float, float16> : std::true_type {};
+
+template <>
+struct is_convertible_element<float16, float> : std::true_type {};
+
+template <>
+struct is_convertible_element<float, bfloat16> : std::true_type {};
+
+template <>
+struct is_convertible_element<bfloat16, float> : std::true_type {};
+
+inline std::uint32_t float_bits(float f) noexcept
+{
+    std::uint32_t u;
+    std::memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+inline float bits_float(std::uint32_t u) noexcept
+{
+    float f;
+    std::memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+// Scalar conversions of a single value
+
+// Integer to integer, clamping to the range of To
+template <typename To, typename From>
+To saturate_integer(From x, std::true_type /* signed */) noexcept
+{
+    using limits = std::numeric_limits<To>;
+    if (static_cast<std::intmax_t>(x) <
+        static_cast<std::intmax_t>(limits::min())) {
+        return limits::min();
+    }
+    if (x > 0 && static_cast<std::uintmax_t>(x) >
+                     static_cast<std::uintmax_t>(limits::max())) {
+        return limits::max();
+    }
+    return static_cast<To>(x);
+}
+
+template <typename To, typename From>
+To saturate_integer(From x, std::false_type /* signed */) noexcept
+{
+    using limits = std::numeric_limits<To>;
+    if (static_cast<std::uintmax_t>(x) >
+        static_cast<std::uintmax_t>(limits::max())) {
+        return limits::max();
+    }
+    return static_cast<To>(x);
+}
+
+// Floating point to integer, truncating towards zero and clamping to the
+// range of To. NaN converts to zero.
+template <typename To, typename From>
+To saturate_floating(From x) noexcept
+{
+    using limits = std::numeric_limits<To>;
+    if (x != x) {
+        return To(0);
+    }
+    if (x <= static_cast<From>(limits::min())) {
+        return limits::min();
+    }
+    if (x >= static_cast<From>(limits::max())) {
+        return limits::max();
+    }
+    return static_cast<To>(x);
+}
+
+template <typename To, typename From, bool FromInt>
+To convert_arithmetic(From x, std::integral_constant<bool, FromInt>,
+                      std::false_type /* to integral */) noexcept
+{
+    return static_cast<To>(x);
+}
+
+template <typename To, typename From>
+To convert_arithmetic(From x, std::true_type /* from integral */,
+                      std::true_type /* to integral */) noexcept
+{
+    return saturate_integer<To>(x, std::is_signed<From>{});
+}
+
+template <typename To, typename From>
+To convert_arithmetic(From x, std::false_type /* from integral */,
+                      std::true_type /* to integral */) noexcept
+{
+    return saturate_floating<To>(x);
+}
+
+template <typename From, typename To>
+void convert_one(From x, To& out) noexcept
+{
+    out = convert_arithmetic<To>(x, std::is_integral<From>{},
+                                 std::is_integral<To>{});
+}
+
+// Rounds to nearest even, as the F16C instructions do. After Giesen,
+// "float->half variants".
+inline void convert_one(float x, float16& out) noexcept
+{
+    const std::uint32_t bits = float_bits(x);
+    const std::uint32_t sign = bits >> 16 & 0x8000;
+    std::uint32_t u = bits & 0x7fffffff;
+    std::uint32_t h;
+    if (u > 0x7f800000) {
+        // NaN, made quiet and keeping the top of its payload
+        h = 0x7e00 | (u >> 13 & 0x3ff);
+    } else if (u >= 0x47800000) {
+        h = 0x7c00;
+    } else if (u < 0x38800000) {
+        // Subnormal or zero: adding this aligns the mantissa so that the
+        // hardware's rounding gives the result
+        const std::uint32_t magic = 126u << 23;
+        h = float_bits(bits_float(u) + bits_float(magic)) - magic;
+    } else {
+        const std::uint32_t odd = u >> 13 & 1;
+        u += 0xc8000fffu + odd; // rebias the exponent and round
+        h = u >> 13;
+    }
+    out.bits = static_cast<std::uint16_t>(sign | h);
+}
+
+inline void convert_one(float16 x, float& out) noexcept
+{
+    const std::uint32_t sign = static_cast<std::uint32_t>(x.bits & 0x8000)
+                               << 16;
+    const std::uint32_t exponent = x.bits >> 10 & 0x1f;
+    const std::uint32_t mantissa = x.bits & 0x3ffu;
+    std::uint32_t bits;
+    if (exponent == 0x1f) {
+        // Infinity, or NaN made quiet
+        bits = 0x7f800000 | mantissa << 13 | (mantissa != 0 ? 0x400000 : 0);
+    } else if (exponent != 0) {
+        bits = (exponent + 112) << 23 | mantissa << 13;
+    } else {
+        // Zero or subnormal, scaled by 2^-24
+        bits = float_bits(static_cast<float>(mantissa) * 5.9604645e-8f);
+    }
+    out = bits_float(sign | bits);
+}
+
+// Rounds to nearest even
+inline void convert_one(float x, bfloat16& out) noexcept
+{
+    const std::uint32_t bits = float_bits(x);
+    if ((bits & 0x7fffffff) > 0x7f800000) {
+        out.bits = static_cast<std::uint16_t>(bits >> 16 | 0x40);
+    } else {
+        out.bits = static_cast<std::uint16_t>(
+            (bits + 0x7fff + (bits >> 16 & 1)) >> 16);
+    }
+}
+
+inline void convert_one(bfloat16 x, float& out) noexcept
+{
+    out = bits_float(static_cast<std::uint32_t>(x.bits) << 16);
+}
+
+// SIMD kernels convert a prefix of the input, returning its length
+
+template <typename From, typename To>
+std::size_t convert_simd(const From*, To*, std::size_t) noexcept
+{
+    return 0;
+}
+
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+
+// Loads eight integers, sign- or zero-extended to 32 bits
+TCB_SPAN_TARGET("avx2")
+inline __m256i load_epi32_avx2(const std::int8_t* p) noexcept
+{
+    return _mm256_cvtepi8_epi32(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+}
+
+TCB_SPAN_TARGET("avx2")
+inline __m256i load_epi32_avx2(const std::uint8_t* p) noexcept
+{
+    return _mm256_cvtepu8_epi32(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+}
+
+TCB_SPAN_TARGET("avx2")
+inline __m256i load_epi32_avx2(const std::int16_t* p) noexcept
+{
+    return _mm256_cvtepi16_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+
+TCB_SPAN_TARGET("avx2")
+inline __m256i load_epi32_avx2(const std::uint16_t* p) noexcept
+{
+    return _mm256_cvtepu16_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+
+TCB_SPAN_TARGET("avx2")
+inline __m256i load_epi32_avx2(const std::int32_t* p) noexcept
+{
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+template <typename From>
+TCB_SPAN_TARGET("avx2")
+std::size_t int_to_float_avx2(const From* in, float* out,
+                              std::size_t n) noexcept
+{
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m256i a = load_epi32_avx2(in + i);
+        const __m256i b = load_epi32_avx2(in + i + 8);
+        _mm256_storeu_ps(out + i, _mm256_cvtepi32_ps(a));
+        _mm256_storeu_ps(out + i + 8, _mm256_cvtepi32_ps(b));
+    }
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_cvtepi32_ps(load_epi32_avx2(in + i)));
+    }
+    return i;
+}
+
+// Saturating packs of two vectors to elements of half the width. The AVX2
+// packs work within 128-bit lanes, so the results are interleaved by lane.
+TCB_SPAN_TARGET("avx2")
+inline __m256i pack_avx2(__m256i a, __m256i b, std::int32_t,
+                         std::int16_t) noexcept
+{
+    return _mm256_packs_epi32(a, b);
+}
+
+TCB_SPAN_TARGET("avx2")
+inline __m256i pack_avx2(__m256i a, __m256i b, std::int32_t,
+                         std::uint16_t) noexcept
+{
+    return _mm256_packus_epi32(a, b);
+}
+
+TCB_SPAN_TARGET("avx2")
+inline __m256i pack_avx2(__m256i a, __m256i b, std::int16_t,
+                         std::int8_t) noexcept
+{
+    return _mm256_packs_epi16(a, b);
+}
+
+TCB_SPAN_TARGET("avx2")
+inline __m256i pack_avx2(__m256i a, __m256i b, std::int16_t,
+                         std::uint8_t) noexcept
+{
+    return _mm256_packus_epi16(a, b);
+}
+
+// Narrowing to half the width
+template <typename From, typename To>
+TCB_SPAN_TARGET("avx2")
+std::size_t narrow_avx2(const From* in, To* out, std::size_t n) noexcept
+{
+    const std::size_t step = 32 / sizeof(To);
+    std::size_t i = 0;
+    for (; i + step <= n; i += step) {
+        const __m256i a =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        const __m256i b = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(in + i + step / 2));
+        const __m256i packed = pack_avx2(a, b, From{}, To{});
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                            _mm256_permute4x64_epi64(packed, 0xd8));
+    }
+    return i;
+}
+
+// Narrowing 32-bit integers to bytes, through 16 bits
+template <typename To>
+TCB_SPAN_TARGET("avx2")
+std::size_t narrow_bytes_avx2(const std::int32_t* in, To* out,
+                              std::size_t n) noexcept
+{
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i* p = reinterpret_cast<const __m256i*>(in + i);
+        const __m256i ab = _mm256_packs_epi32(_mm256_loadu_si256(p),
+                                              _mm256_loadu_si256(p + 1));
+        const __m256i cd = _mm256_packs_epi32(_mm256_loadu_si256(p + 2),
+                                              _mm256_loadu_si256(p + 3));
+        const __m256i packed = pack_avx2(ab, cd, std::int16_t{}, To{});
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                            _mm256_permutevar8x32_epi32(packed, order));
+    }
+    return i;
+}
+
+TCB_SPAN_TARGET("avx,f16c")
+inline std::size_t float_to_half_f16c(const float* in, float16* out,
+                                      std::size_t n) noexcept
+{
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(in + i),
+                                          _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), h);
+    }
+    return i;
+}
+
+TCB_SPAN_TARGET("avx,f16c")
+inline std::size_t half_to_float_f16c(const float16* in, float* out,
+                                      std::size_t n) noexcept
+{
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(out + i,
+                         _mm256_cvtph_ps(_mm_loadu_si128(
+                             reinterpret_cast<const __m128i*>(in + i))));
+    }
+    return i;
+}
+
+TCB_SPAN_TARGET("avx512f")
+inline std::size_t float_to_half_avx512(const float* in, float16* out,
+                                        std::size_t n) noexcept
+{
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                            _mm512_cvtps_ph(_mm512_loadu_ps(in + i),
+                                            _MM_FROUND_TO_NEAREST_INT));
+    }
+    return i;
+}
+
+TCB_SPAN_TARGET("avx512f")
+inline std::size_t half_to_float_avx512(const float16* in, float* out,
+                                        std::size_t n) noexcept
+{
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(out + i,
+                         _mm512_cvtph_ps(_mm256_loadu_si256(
+                             reinterpret_cast<const __m256i*>(in + i))));
+    }
+    return i;
+}
+
+// The bfloat16 roundings of eight floats, in the low halves of 32-bit lanes
+TCB_SPAN_TARGET("avx2")
+inline __m256i float_to_bf16_avx2(__m256 v) noexcept
+{
+    const __m256i bits = _mm256_castps_si256(v);
+    const __m256i high = _mm256_srli_epi32(bits, 16);
+    const __m256i bias = _mm256_add_epi32(
+        _mm256_set1_epi32(0x7fff),
+        _mm256_and_si256(high, _mm256_set1_epi32(1)));
+    const __m256i rounded =
+        _mm256_srli_epi32(_mm256_add_epi32(bits, bias), 16);
+    const __m256i quiet = _mm256_or_si256(high, _mm256_set1_epi32(0x40));
+    const __m256i nan = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+    return _mm256_blendv_epi8(rounded, quiet, nan);
+}
+
+TCB_SPAN_TARGET("avx2")
+inline std::size_t float_to_bf16_avx2(const float* in, bfloat16* out,
+                                      std::size_t n) noexcept
+{
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m256i a = float_to_bf16_avx2(_mm256_loadu_ps(in + i));
+        const __m256i b = float_to_bf16_avx2(_mm256_loadu_ps(in + i + 8));
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(out + i),
+            _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), 0xd8));
+    }
+    return i;
+}
+
+TCB_SPAN_TARGET("avx2")
+inline std::size_t bf16_to_float_avx2(const bfloat16* in, float* out,
+                                      std::size_t n) noexcept
+{
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i v = _mm256_cvtepu16_epi32(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)));
+        _mm256_storeu_ps(out + i,
+                         _mm256_castsi256_ps(_mm256_slli_epi32(v, 16)));
+    }
+    return i;
+}
+
+// Dispatch for the conversions with SIMD kernels
+
+inline std::size_t convert_simd(const std::int8_t* in, float* out,
+                                std::size_t n) noexcept
+{
+    return cpu().avx2 ? int_to_float_avx2(in, out, n) : 0;
+}
+
+inline std::size_t convert_simd(const std::uint8_t* in, float* out,
+                                std::size_t n) noexcept
+{
+    return cpu().avx2 ? int_to_float_avx2(in, out, n) : 0;
+}
+
+inline std::size_t convert_simd(const std::int16_t* in, float* out,
+                                std::size_t n) noexcept
+{
+    return cpu().avx2 ? int_to_float_avx2(in, out, n) : 0;
+}
+
+inline std::size_t convert_simd(const std::uint16_t* in, float* out,
+                                std::size_t n) noexcept
+{
+    return cpu().avx2 ? int_to_float_avx2(in, out, n) : 0;
+}
+
+inline std::size_t convert_simd(const std::int32_t* in, float* out,
+                                std::size_t n) noexcept
+{
+    return cpu().avx2 ? int_to_float_avx2(in, out, n) : 0;
+}
+
+inline std::size_t convert_simd(const std::int32_t* in, std::int16_t* out,
+                                std::size_t n) noexcept
+{
+    return cpu().avx2 ? narrow_avx2(in, out, n) : 0;
+}
+
+inline std::size_t convert_simd(const std::int32_t* in, std::uint16_t* out,
+                                std::size_t n) noexcept
+{
+    return cpu().avx2 ? narrow_avx2(in, out, n) : 0;
+}
+
+inline std::size_t convert_simd(const std::int16_t* in, std::int8_t* out,
+                                std::size_t n) noexcept
+{
+    return cpu().avx2 ? narrow_avx2(in, out, n) : 0;
+}
+
+inline std::size_t convert_simd(const std::int16_t* in, std::uint8_t* out,
+                                std::size_t n) noexcept
+{
+    return cpu().avx2 ? narrow_avx2(in, out, n) : 0;
+}
+
+inline std::size_t convert_simd(const std::int32_t* in, std::int8_t* out,
+                                std::size_t n) noexcept
+{
+    return cpu().avx2 ? narrow_bytes_avx2(in, out, n) : 0;
+}
+
+inline std::size_t convert_simd(const std::int32_t* in, std::uint8_t* out,
+                                std::size_t n) noexcept
+{
+    return cpu().avx2 ? narrow_bytes_avx2(in, out, n) : 0;
+}
+
+inline std::size_t convert_simd(const float* in, float16* out,
+                                std::size_t n) noexcept
+{
+    std::size_t i = 0;
+    if (cpu().avx512f) {
+        i = float_to_half_avx512(in, out, n);
+    }
+    if (cpu().f16c) {
+        i += float_to_half_f16c(in + i, out + i, n - i);
+    }
+    return i;
+}
+
+inline std::size_t convert_simd(const float16* in, float* out,
+                                std::size_t n) noexcept
+{
+    std::size_t i = 0;
+    if (cpu().avx512f) {
+        i = half_to_float_avx512(in, out, n);
+    }
+    if (cpu().f16c) {
+        i += half_to_float_f16c(in + i, out + i, n - i);
+    }
+    return i;
+}
+
+inline std::size_t convert_simd(const float* in, bfloat16* out,
+                                std::size_t n) noexcept
+{
+    return cpu().avx2 ? float_to_bf16_avx2(in, out, n) : 0;
+}
+
+inline std::size_t convert_simd(const bfloat16* in, float* out,
+                                std::size_t n) noexcept
+{
+    return cpu().avx2 ? bf16_to_float_avx2(in, out, n) : 0;
+}
+
+#endif // TCB_SPAN_HAVE_X86_SIMD
+
+} // namespace detail
+
+// Converts each element of in to the element type of out, which must be the
+// same size. The sizes are checked once, up front. Conversions are:
+//
+//  * between integer types, clamping values to the range of the destination
+//    type rather than wrapping;
+//  * from floating point to integers, truncating towards zero and clamping,
+//    with NaN converting to zero;
+//  * from integers to floating point and between floating-point types, as
+//    with static_cast;
+//  * between float and float16 or bfloat16, rounding to nearest even.
+//
+// SIMD kernels are used for 8-, 16- and 32-bit integers to float, for
+// narrowing from 32- and 16-bit integers, and for the 16-bit float formats.
+template <typename From, std::size_t InExtent, typename To,
+          std::size_t OutExtent>
+void convert(span<From, InExtent> in, span<To, OutExtent> out)
+{
+    using from_type = typename std::remove_cv<From>::type;
+    static_assert(!std::is_const<To>::value,
+                  "convert() requires a span of mutable elements");
+    static_assert(detail::is_convertible_element<from_type, To>::value,
+                  "convert() requires arithmetic element types, or float "
+                  "and float16 or bfloat16");
+    static_assert(InExtent == dynamic_extent || OutExtent == dynamic_extent ||
+                      InExtent == OutExtent,
+                  "convert() requires spans of the same size");
+    TCB_SPAN_EXPECT(in.size() == out.size());
+
+    const from_type* p = in.data();
+    To* o = out.data();
+    const std::size_t n = in.size();
+    std::size_t i = detail::convert_simd(p, o, n);
+    for (; i < n; i++) {
+        detail::convert_one(p[i], o[i]);
+    }
+}
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_CONVERT_HPP_INCLUDED
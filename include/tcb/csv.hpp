@@ -0,0 +1,512 @@
+
+/*
+Structural indexing of CSV and TSV text, with rows and fields as subspans
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_CSV_HPP_INCLUDED
+#define TCB_CSV_HPP_INCLUDED
+
+#include "span_ext.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+
+// The characters which separate and quote fields. Records are separated by
+// "\n" or "\r\n". Use csv_dialect('\t') for TSV.
+struct csv_dialect {
+    char delimiter;
+    char quote;
+
+    constexpr csv_dialect(char delimiter = ',', char quote = '"') noexcept
+        : delimiter(delimiter), quote(quote)
+    {}
+};
+
+namespace detail {
+
+// The input is processed in blocks of 64 bytes, each byte corresponding to
+// a bit of a mask. For each block the kernels find the candidate separators
+// (delimiters and newlines) and which bytes lie inside quotes; separators
+// inside quotes are not structural. A quote toggles the state, so the
+// quoted bytes are the prefix XOR of the quote mask, flipped if the previous
+// block ended inside quotes. Doubled quotes within a quoted field toggle it
+// twice, and need no special treatment.
+struct csv_block {
+    std::uint64_t separators;
+    std::uint64_t inside;
+};
+
+inline std::uint64_t prefix_xor_scalar(std::uint64_t x) noexcept
+{
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+// Continues the quote state from the previous block, which is all ones if
+// it ended inside quotes
+inline std::uint64_t csv_carry(std::uint64_t inside) noexcept
+{
+    return std::uint64_t{0} - (inside >> 63);
+}
+
+inline void csv_blocks_scalar(const unsigned char* p, std::size_t blocks,
+                              const csv_dialect& d, std::uint64_t& carry,
+                              csv_block* out) noexcept
+{
+    const auto quote = static_cast<unsigned char>(d.quote);
+    const auto delim = static_cast<unsigned char>(d.delimiter);
+    for (std::size_t b = 0; b < blocks; b++, p += 64) {
+        std::uint64_t quotes = 0;
+        std::uint64_t seps = 0;
+        for (unsigned i = 0; i < 64; i++) {
+            quotes |= static_cast<std::uint64_t>(p[i] == quote) << i;
+            seps |= static_cast<std::uint64_t>(p[i] == delim || p[i] == '\n')
+                    << i;
+        }
+        const std::uint64_t inside = prefix_xor_scalar(quotes) ^ carry;
+        carry = csv_carry(inside);
+        out[b] = csv_block{seps, inside};
+    }
+}
+
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+
+// Carry-less multiplication by all ones computes the prefix XOR in one
+// instruction
+TCB_SPAN_TARGET("pclmul")
+inline std::uint64_t prefix_xor_clmul(std::uint64_t x) noexcept
+{
+    const __m128i r =
+        _mm_clmulepi64_si128(_mm_set_epi64x(0, static_cast<long long>(x)),
+                             _mm_set1_epi8(-1), 0);
+    std::uint64_t result;
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(&result), r);
+    return result;
+}
+
+TCB_SPAN_TARGET("pclmul")
+inline void csv_blocks_sse2(const unsigned char* p, std::size_t blocks,
+                            const csv_dialect& d, std::uint64_t& carry,
+                            csv_block* out) noexcept
+{
+    const __m128i quote = _mm_set1_epi8(d.quote);
+    const __m128i delim = _mm_set1_epi8(d.delimiter);
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (std::size_t b = 0; b < blocks; b++, p += 64) {
+        std::uint64_t quotes = 0;
+        std::uint64_t seps = 0;
+        for (unsigned j = 0; j < 4; j++) {
+            const __m128i v =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p) + j);
+            quotes |= static_cast<std::uint64_t>(static_cast<unsigned>(
+                          _mm_movemask_epi8(_mm_cmpeq_epi8(v, quote))))
+                      << (16 * j);
+            seps |= static_cast<std::uint64_t>(static_cast<unsigned>(
+                        _mm_movemask_epi8(
+                            _mm_or_si128(_mm_cmpeq_epi8(v, delim),
+                                         _mm_cmpeq_epi8(v, newline)))))
+                    << (16 * j);
+        }
+        const std::uint64_t inside = prefix_xor_clmul(quotes) ^ carry;
+        carry = csv_carry(inside);
+        out[b] = csv_block{seps, inside};
+    }
+}
+
+TCB_SPAN_TARGET("avx2")
+inline std::uint64_t csv_movemask_avx2(__m256i lo, __m256i hi) noexcept
+{
+    return static_cast<std::uint64_t>(
+               static_cast<std::uint32_t>(_mm256_movemask_epi8(hi)))
+               << 32 |
+           static_cast<std::uint32_t>(_mm256_movemask_epi8(lo));
+}
+
+TCB_SPAN_TARGET("avx2,pclmul")
+inline void csv_blocks_avx2(const unsigned char* p, std::size_t blocks,
+                            const csv_dialect& d, std::uint64_t& carry,
+                            csv_block* out) noexcept
+{
+    const __m256i quote = _mm256_set1_epi8(d.quote);
+    const __m256i delim = _mm256_set1_epi8(d.delimiter);
+    const __m256i newline = _mm256_set1_epi8('\n');
+    for (std::size_t b = 0; b < blocks; b++, p += 64) {
+        const __m256i lo =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i hi =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p) + 1);
+        const std::uint64_t quotes =
+            csv_movemask_avx2(_mm256_cmpeq_epi8(lo, quote),
+                              _mm256_cmpeq_epi8(hi, quote));
+        const std::uint64_t seps = csv_movemask_avx2(
+            _mm256_or_si256(_mm256_cmpeq_epi8(lo, delim),
+                            _mm256_cmpeq_epi8(lo, newline)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(hi, delim),
+                            _mm256_cmpeq_epi8(hi, newline)));
+        const std::uint64_t inside = prefix_xor_clmul(quotes) ^ carry;
+        carry = csv_carry(inside);
+        out[b] = csv_block{seps, inside};
+    }
+}
+
+#endif // TCB_SPAN_HAVE_X86_SIMD
+
+inline void csv_blocks(const unsigned char* p, std::size_t blocks,
+                       const csv_dialect& d, std::uint64_t& carry,
+                       csv_block* out) noexcept
+{
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+    if (cpu().pclmul) {
+        if (cpu().avx2) {
+            return csv_blocks_avx2(p, blocks, d, carry, out);
+        }
+        return csv_blocks_sse2(p, blocks, d, carry, out);
+    }
+#endif
+    csv_blocks_scalar(p, blocks, d, carry, out);
+}
+
+// Writes the positions of the set bits of a block's structural mask. While
+// there is room before limit, they are written eight at a time without
+// branching on the count, and the extra entries are overwritten later.
+inline std::uint32_t* csv_flatten(std::uint32_t* out, std::uint32_t* limit,
+                                  std::uint32_t base,
+                                  std::uint64_t bits) noexcept
+{
+    const std::uint64_t top = std::uint64_t{1} << 63;
+    std::uint32_t* const end = out + popcount64(bits);
+    if (limit - out >= 64) {
+        while (bits != 0) {
+            for (unsigned i = 0; i < 8; i++) {
+                // Or-ing in the top bit gives a harmless result once the
+                // mask is exhausted
+                out[i] = base + static_cast<std::uint32_t>(ctz64(bits | top));
+                bits &= bits - 1;
+            }
+            out += 8;
+        }
+    } else {
+        for (; bits != 0; bits &= bits - 1) {
+            *out++ = base + static_cast<std::uint32_t>(ctz64(bits));
+        }
+    }
+    return end;
+}
+
+// Blocks are scanned in batches, and their masks then flattened
+constexpr std::size_t csv_batch_blocks = 64;
+
+// Indexes the whole blocks of [p, p + 64 * blocks), starting from the given
+// quote state, and returns the end of the entries written
+inline std::uint32_t* csv_index_blocks(const unsigned char* p,
+                                       std::size_t blocks, std::size_t base,
+                                       const csv_dialect& d,
+                                       std::uint64_t& carry,
+                                       std::uint32_t* out,
+                                       std::uint32_t* limit) noexcept
+{
+    csv_block masks[csv_batch_blocks];
+    while (blocks > 0) {
+        const std::size_t count = (std::min)(blocks, csv_batch_blocks);
+        csv_blocks(p, count, d, carry, masks);
+        for (std::size_t b = 0; b < count; b++, base += 64) {
+            out = csv_flatten(out, limit, static_cast<std::uint32_t>(base),
+                              masks[b].separators & ~masks[b].inside);
+        }
+        p += 64 * count;
+        blocks -= count;
+    }
+    return out;
+}
+
+// Indexes the final n < 64 bytes, padded out to a block, and terminates the
+// last record if the text doesn't end with a newline
+inline std::uint32_t* csv_index_tail(const unsigned char* text,
+                                     std::size_t size, const csv_dialect& d,
+                                     std::uint64_t carry,
+                                     const std::uint32_t* index,
+                                     std::uint32_t* out,
+                                     std::uint32_t* limit) noexcept
+{
+    const std::size_t base = size - size % 64;
+    const std::size_t n = size - base;
+    if (n > 0) {
+        unsigned char padded[64] = {};
+        std::memcpy(padded, text + base, n);
+        csv_block block;
+        csv_blocks(padded, 1, d, carry, &block);
+        const std::uint64_t valid = ~std::uint64_t{0} >> (64 - n);
+        out = csv_flatten(out, limit, static_cast<std::uint32_t>(base),
+                          block.separators & ~block.inside & valid);
+    }
+    if (size > 0 &&
+        (out == index || out[-1] != size - 1 || text[size - 1] != '\n')) {
+        *out++ = static_cast<std::uint32_t>(size);
+    }
+    return out;
+}
+
+inline void csv_check(span<const char> text, span<std::uint32_t> index,
+                      const csv_dialect& d)
+{
+    TCB_SPAN_EXPECT(d.delimiter != d.quote && d.delimiter != '\n' &&
+                    d.quote != '\n');
+    TCB_SPAN_EXPECT(text.size() <
+                    (std::numeric_limits<std::uint32_t>::max)());
+    TCB_SPAN_EXPECT(index.size() > text.size());
+    (void) text, (void) index, (void) d;
+}
+
+// The fewest bytes of text per thread. The parallel indexer reads its
+// input twice, once to count quotes and entries and once to write them,
+// and the SIMD scan is fast enough that a smaller chunk would spend more
+// on starting its thread than the second pass saves.
+constexpr std::size_t csv_parallel_chunk = std::size_t{1} << 20;
+
+} // namespace detail
+
+// The number of index entries which index_csv() may need for text of the
+// given size
+constexpr std::size_t max_csv_index_size(std::size_t text_size) noexcept
+{
+    return text_size + 1;
+}
+
+// Finds the structure of CSV (or TSV) text without copying or unescaping it.
+// The offset of every delimiter and newline outside quotes is written to
+// index, followed by the size of the text if it does not end with a newline,
+// so that each entry marks the end of a field; the written prefix of index
+// is returned. Pass it to csv_table to access the rows and fields.
+//
+// The text is examined 64 bytes at a time with SIMD comparisons, and quoted
+// regions are found with a carry-less multiplication. index must have room
+// for max_csv_index_size(text.size()) entries, and text must be smaller
+// than 4GB.
+inline span<std::uint32_t> index_csv(span<const char> text,
+                                     span<std::uint32_t> index,
+                                     const csv_dialect& dialect = {})
+{
+    detail::csv_check(text, index, dialect);
+    const auto p = reinterpret_cast<const unsigned char*>(text.data());
+    std::uint32_t* const limit = index.data() + index.size();
+    std::uint64_t carry = 0;
+    std::uint32_t* out = detail::csv_index_blocks(
+        p, text.size() / 64, 0, dialect, carry, index.data(), limit);
+    out = detail::csv_index_tail(p, text.size(), dialect, carry, index.data(),
+                                 out, limit);
+    return index.first(static_cast<std::size_t>(out - index.data()));
+}
+
+// As index_csv(), but indexes chunks of large inputs on up to the given
+// number of threads. Whether each chunk starts inside quotes, and so where
+// its entries go, is not known until the chunks before it have been
+// examined, so the text is scanned twice: first to count the quotes and
+// separators of each chunk, then to write the entries.
+inline span<std::uint32_t>
+index_csv_parallel(span<const char> text, span<std::uint32_t> index,
+                   const csv_dialect& dialect = {},
+                   unsigned threads = std::thread::hardware_concurrency())
+{
+    const std::size_t blocks = text.size() / 64;
+    const std::size_t max_threads = text.size() / detail::csv_parallel_chunk;
+    if (threads > max_threads) {
+        threads = static_cast<unsigned>(max_threads);
+    }
+    if (threads <= 1) {
+        return index_csv(text, index, dialect);
+    }
+    detail::csv_check(text, index, dialect);
+
+    const auto p = reinterpret_cast<const unsigned char*>(text.data());
+    const auto chunk_begin = [blocks, threads](unsigned c) {
+        return static_cast<std::size_t>(
+            static_cast<unsigned long long>(blocks) * c / threads);
+    };
+
+    // The number of entries in each chunk if it starts outside or inside
+    // quotes, and whether it contains an odd number of quotes
+    struct chunk_summary {
+        std::size_t outside = 0;
+        std::size_t inside = 0;
+        bool odd = false;
+    };
+    std::vector<chunk_summary> summaries(threads);
+    detail::run_concurrently(threads, [&](unsigned c) {
+        detail::csv_block masks[detail::csv_batch_blocks];
+        chunk_summary& s = summaries[c];
+        std::uint64_t carry = 0;
+        for (std::size_t b = chunk_begin(c); b < chunk_begin(c + 1);) {
+            const std::size_t count =
+                (std::min)(chunk_begin(c + 1) - b, detail::csv_batch_blocks);
+            detail::csv_blocks(p + 64 * b, count, dialect, carry, masks);
+            for (std::size_t i = 0; i < count; i++) {
+                const detail::csv_block& m = masks[i];
+                s.outside += static_cast<std::size_t>(
+                    detail::popcount64(m.separators & ~m.inside));
+                s.inside += static_cast<std::size_t>(
+                    detail::popcount64(m.separators & m.inside));
+            }
+            b += count;
+        }
+        s.odd = carry != 0;
+    });
+
+    std::vector<std::size_t> offsets(threads + 1);
+    std::vector<std::uint64_t> carries(threads + 1);
+    for (unsigned c = 0; c < threads; c++) {
+        const chunk_summary& s = summaries[c];
+        offsets[c + 1] = offsets[c] + (carries[c] != 0 ? s.inside : s.outside);
+        carries[c + 1] = s.odd ? ~carries[c] : carries[c];
+    }
+
+    std::uint32_t* const limit = index.data() + index.size();
+    detail::run_concurrently(threads, [&](unsigned c) {
+        const std::size_t first = chunk_begin(c);
+        std::uint64_t carry = carries[c];
+        detail::csv_index_blocks(
+            p + 64 * first, chunk_begin(c + 1) - first, 64 * first, dialect,
+            carry, index.data() + offsets[c],
+            c + 1 == threads ? limit : index.data() + offsets[c + 1]);
+    });
+    std::uint32_t* const out =
+        detail::csv_index_tail(p, text.size(), dialect, carries[threads],
+                               index.data(), index.data() + offsets[threads],
+                               limit);
+    return index.first(static_cast<std::size_t>(out - index.data()));
+}
+
+// The rows and fields of CSV text, given the index produced for it by
+// index_csv(). Fields are subspans of the text: the quotes around a quoted
+// field are included, and doubled quotes within it are left as they are. A
+// "\r" before the newline ending a record is removed from its last field.
+class csv_table {
+public:
+    class row {
+    public:
+        row() = default;
+
+        // The number of fields in the row
+        std::size_t size() const noexcept { return ends_.size(); }
+
+        span<const char> operator[](std::size_t i) const
+        {
+            TCB_SPAN_EXPECT(i < ends_.size());
+            const std::size_t first = i == 0 ? begin_ : ends_[i - 1] + 1;
+            span<const char> field = text_.subspan(first, ends_[i] - first);
+            if (i + 1 == ends_.size() && ends_[i] < text_.size() &&
+                !field.empty() && field[field.size() - 1] == '\r') {
+                field = field.first(field.size() - 1);
+            }
+            return field;
+        }
+
+    private:
+        friend class csv_table;
+
+        row(span<const char> text, std::size_t begin,
+            span<const std::uint32_t> ends)
+            : text_(text), begin_(begin), ends_(ends)
+        {}
+
+        span<const char> text_{};
+        std::size_t begin_ = 0;
+        span<const std::uint32_t> ends_{};
+    };
+
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = row;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const row*;
+        using reference = row;
+
+        iterator() = default;
+
+        reference operator*() const
+        {
+            return row(text_, begin_, rest_.first(fields_));
+        }
+
+        iterator& operator++()
+        {
+            begin_ = rest_[fields_ - 1] + std::size_t{1};
+            rest_ = rest_.subspan(fields_);
+            find_end();
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        friend bool operator==(const iterator& a, const iterator& b)
+        {
+            return a.rest_.size() == b.rest_.size();
+        }
+
+        friend bool operator!=(const iterator& a, const iterator& b)
+        {
+            return !(a == b);
+        }
+
+    private:
+        friend class csv_table;
+
+        iterator(span<const char> text, span<const std::uint32_t> rest)
+            : text_(text), rest_(rest)
+        {
+            find_end();
+        }
+
+        void find_end()
+        {
+            fields_ = 0;
+            while (fields_ < rest_.size()) {
+                const std::size_t end = rest_[fields_++];
+                if (end == text_.size() || text_[end] == '\n') {
+                    break;
+                }
+            }
+        }
+
+        span<const char> text_{};
+        span<const std::uint32_t> rest_{};
+        std::size_t begin_ = 0;
+        std::size_t fields_ = 0;
+    };
+
+    csv_table(span<const char> text, span<const std::uint32_t> index)
+        : text_(text), index_(index)
+    {}
+
+    iterator begin() const { return iterator(text_, index_); }
+    iterator end() const
+    {
+        return iterator(text_, index_.subspan(index_.size()));
+    }
+
+private:
+    span<const char> text_;
+    span<const std::uint32_t> index_;
+};
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_CSV_HPP_INCLUDED
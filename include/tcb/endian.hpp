@@ -0,0 +1,300 @@
+
+/*
+Byte order conversion of spans of integers and floating-point values
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_ENDIAN_HPP_INCLUDED
+#define TCB_ENDIAN_HPP_INCLUDED
+
+#include "span_ext.hpp"
+
+#include <type_traits>
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+namespace detail {
+
+template <typename T>
+struct is_byteswappable
+    : std::integral_constant<bool, (std::is_arithmetic<T>::value ||
+                                    std::is_enum<T>::value) &&
+                                       (sizeof(T) == 1 || sizeof(T) == 2 ||
+                                        sizeof(T) == 4 || sizeof(T) == 8)> {};
+
+inline std::uint16_t bswap(std::uint16_t x) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_bswap16(x);
+#else
+    return static_cast<std::uint16_t>(x >> 8 | x << 8);
+#endif
+}
+
+inline std::uint32_t bswap(std::uint32_t x) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_bswap32(x);
+#else
+    return x >> 24 | (x >> 8 & 0xff00u) | (x << 8 & 0xff0000u) | x << 24;
+#endif
+}
+
+inline std::uint64_t bswap(std::uint64_t x) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_bswap64(x);
+#else
+    return static_cast<std::uint64_t>(bswap(static_cast<std::uint32_t>(x)))
+               << 32 |
+           bswap(static_cast<std::uint32_t>(x >> 32));
+#endif
+}
+
+template <std::size_t Size>
+struct uint_of_size;
+
+template <>
+struct uint_of_size<2> {
+    using type = std::uint16_t;
+};
+
+template <>
+struct uint_of_size<4> {
+    using type = std::uint32_t;
+};
+
+template <>
+struct uint_of_size<8> {
+    using type = std::uint64_t;
+};
+
+// The kernels below reverse the bytes of each Size-byte element of the n
+// bytes at in, writing the result to out, which may be equal to in (but must
+// not otherwise overlap it). They advance the pointers past the bytes they
+// have processed.
+
+template <std::size_t Size>
+void byteswap_scalar(const unsigned char*& in, unsigned char*& out,
+                     std::size_t& n) noexcept
+{
+    using uint_type = typename uint_of_size<Size>::type;
+    for (; n >= Size; in += Size, out += Size, n -= Size) {
+        uint_type v;
+        std::memcpy(&v, in, Size);
+        v = bswap(v);
+        std::memcpy(out, &v, Size);
+    }
+}
+
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+
+// pshufb controls reversing each element of a 16-byte lane
+inline __m128i byteswap_control(byte_size_constant<2>) noexcept
+{
+    return _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+}
+
+inline __m128i byteswap_control(byte_size_constant<4>) noexcept
+{
+    return _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+}
+
+inline __m128i byteswap_control(byte_size_constant<8>) noexcept
+{
+    return _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+}
+
+template <std::size_t Size>
+TCB_SPAN_TARGET("ssse3")
+void byteswap_ssse3(const unsigned char*& in, unsigned char*& out,
+                    std::size_t& n) noexcept
+{
+    const __m128i control = byteswap_control(byte_size_constant<Size>{});
+    for (; n >= 16; in += 16, out += 16, n -= 16) {
+        const __m128i v =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                         _mm_shuffle_epi8(v, control));
+    }
+}
+
+template <std::size_t Size>
+TCB_SPAN_TARGET("avx2")
+void byteswap_avx2(const unsigned char*& in, unsigned char*& out,
+                   std::size_t& n) noexcept
+{
+    const __m256i control = _mm256_broadcastsi128_si256(
+        byteswap_control(byte_size_constant<Size>{}));
+    for (; n >= 64; in += 64, out += 64, n -= 64) {
+        const __m256i a =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+        const __m256i b =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 32));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out),
+                            _mm256_shuffle_epi8(a, control));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 32),
+                            _mm256_shuffle_epi8(b, control));
+    }
+    for (; n >= 32; in += 32, out += 32, n -= 32) {
+        const __m256i v =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out),
+                            _mm256_shuffle_epi8(v, control));
+    }
+}
+
+// Handles all of the input, finishing with a masked load and store
+template <std::size_t Size>
+TCB_SPAN_TARGET("avx512f,avx512bw")
+void byteswap_avx512(const unsigned char*& in, unsigned char*& out,
+                     std::size_t& n) noexcept
+{
+    const __m512i control = _mm512_broadcast_i32x4(
+        byteswap_control(byte_size_constant<Size>{}));
+    for (; n >= 64; in += 64, out += 64, n -= 64) {
+        const __m512i v = _mm512_loadu_si512(in);
+        _mm512_storeu_si512(out, _mm512_shuffle_epi8(v, control));
+    }
+    if (n > 0) {
+        const __mmask64 mask = (std::uint64_t{1} << n) - 1;
+        const __m512i v = _mm512_maskz_loadu_epi8(mask, in);
+        _mm512_mask_storeu_epi8(out, mask, _mm512_shuffle_epi8(v, control));
+        in += n;
+        out += n;
+        n = 0;
+    }
+}
+
+#endif // TCB_SPAN_HAVE_X86_SIMD
+
+template <std::size_t Size>
+void byteswap_bytes(const unsigned char* in, unsigned char* out,
+                    std::size_t n, byte_size_constant<Size>) noexcept
+{
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+    if (cpu().avx512bw) {
+        byteswap_avx512<Size>(in, out, n);
+    } else if (cpu().avx2) {
+        byteswap_avx2<Size>(in, out, n);
+    }
+    if (cpu().ssse3) {
+        byteswap_ssse3<Size>(in, out, n);
+    }
+#endif
+    byteswap_scalar<Size>(in, out, n);
+}
+
+inline void byteswap_bytes(const unsigned char* in, unsigned char* out,
+                           std::size_t n, byte_size_constant<1>) noexcept
+{
+    if (in != out && n > 0) {
+        std::memcpy(out, in, n);
+    }
+}
+
+// Copies n bytes of elements of type T, reversing the byte order of each
+// element when the last argument is true_type
+template <typename T>
+void copy_with_byte_order(const void* in, void* out, std::size_t n,
+                          std::true_type /* swap */) noexcept
+{
+    byteswap_bytes(static_cast<const unsigned char*>(in),
+                   static_cast<unsigned char*>(out), n,
+                   byte_size_constant<sizeof(T)>{});
+}
+
+template <typename T>
+void copy_with_byte_order(const void* in, void* out, std::size_t n,
+                          std::false_type /* swap */) noexcept
+{
+    if (in != out && n > 0) {
+        std::memcpy(out, in, n);
+    }
+}
+
+template <typename T>
+void check_byteswappable() noexcept
+{
+    static_assert(is_byteswappable<T>::value,
+                  "Byte order conversion requires an arithmetic or "
+                  "enumeration type of 1, 2, 4 or 8 bytes");
+}
+
+#if defined(TCB_SPAN_BIG_ENDIAN)
+using native_is_big_endian = std::true_type;
+#else
+using native_is_big_endian = std::false_type;
+#endif
+
+using native_is_little_endian =
+    std::integral_constant<bool, !native_is_big_endian::value>;
+
+} // namespace detail
+
+// Reverses the byte order of each element of s, in place
+template <typename T, std::size_t Extent>
+void byteswap_inplace(span<T, Extent> s) noexcept
+{
+    static_assert(!std::is_const<T>::value,
+                  "byteswap_inplace() requires a span of mutable elements");
+    detail::check_byteswappable<T>();
+    detail::copy_with_byte_order<T>(s.data(), s.data(), s.size_bytes(),
+                                    std::true_type{});
+}
+
+// Bulk conversions between spans of values and their big- or little-endian
+// representations as bytes. The byte span must be exactly the size of the
+// value span. Where the byte order matches that of the target, these are
+// plain copies.
+
+// Reads the big-endian representations of out.size() values from in
+template <typename T, std::size_t Extent>
+void load_be(span<const byte> in, span<T, Extent> out)
+{
+    static_assert(!std::is_const<T>::value,
+                  "load_be() requires a span of mutable elements");
+    detail::check_byteswappable<T>();
+    TCB_SPAN_EXPECT(in.size() == out.size_bytes());
+    detail::copy_with_byte_order<T>(in.data(), out.data(), in.size(),
+                                    detail::native_is_little_endian{});
+}
+
+// Writes the big-endian representations of the values of in to out
+template <typename T, std::size_t Extent>
+void store_be(span<T, Extent> in, span<byte> out)
+{
+    detail::check_byteswappable<typename std::remove_cv<T>::type>();
+    TCB_SPAN_EXPECT(out.size() == in.size_bytes());
+    detail::copy_with_byte_order<T>(in.data(), out.data(), out.size(),
+                                    detail::native_is_little_endian{});
+}
+
+// Reads the little-endian representations of out.size() values from in
+template <typename T, std::size_t Extent>
+void load_le(span<const byte> in, span<T, Extent> out)
+{
+    static_assert(!std::is_const<T>::value,
+                  "load_le() requires a span of mutable elements");
+    detail::check_byteswappable<T>();
+    TCB_SPAN_EXPECT(in.size() == out.size_bytes());
+    detail::copy_with_byte_order<T>(in.data(), out.data(), in.size(),
+                                    detail::native_is_big_endian{});
+}
+
+// Writes the little-endian representations of the values of in to out
+template <typename T, std::size_t Extent>
+void store_le(span<T, Extent> in, span<byte> out)
+{
+    detail::check_byteswappable<typename std::remove_cv<T>::type>();
+    TCB_SPAN_EXPECT(out.size() == in.size_bytes());
+    detail::copy_with_byte_order<T>(in.data(), out.data(), out.size(),
+                                    detail::native_is_big_endian{});
+}
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_ENDIAN_HPP_INCLUDED
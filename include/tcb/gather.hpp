@@ -0,0 +1,323 @@
+
+/*
+Indexed gather and scatter operations between spans
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_GATHER_HPP_INCLUDED
+#define TCB_GATHER_HPP_INCLUDED
+
+#include "span_ext.hpp"
+
+#include <climits>
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+namespace detail {
+
+template <typename I>
+using unsigned_index_t = typename std::make_unsigned<I>::type;
+
+// Returns the largest index in [idx, idx + n), with negative values treated
+// as huge. Used to bounds-check a whole index span at once.
+template <typename I>
+unsigned_index_t<I> max_index_scalar(const I* idx, std::size_t n)
+{
+    unsigned_index_t<I> m = 0;
+    for (std::size_t i = 0; i < n; i++) {
+        const unsigned_index_t<I> v = static_cast<unsigned_index_t<I>>(idx[i]);
+        m = v > m ? v : m;
+    }
+    return m;
+}
+
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+
+TCB_SPAN_TARGET("avx2")
+inline std::uint32_t max_index_avx2(const std::uint32_t* idx, std::size_t n)
+{
+    __m256i m = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        m = _mm256_max_epu32(
+            m, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx + i)));
+    }
+    __m128i m4 = _mm_max_epu32(_mm256_castsi256_si128(m),
+                               _mm256_extracti128_si256(m, 1));
+    m4 = _mm_max_epu32(m4, _mm_shuffle_epi32(m4, _MM_SHUFFLE(1, 0, 3, 2)));
+    m4 = _mm_max_epu32(m4, _mm_shuffle_epi32(m4, _MM_SHUFFLE(2, 3, 0, 1)));
+    const std::uint32_t tail = max_index_scalar(idx + i, n - i);
+    const std::uint32_t head =
+        static_cast<std::uint32_t>(_mm_cvtsi128_si32(m4));
+    return head > tail ? head : tail;
+}
+
+// Gathers n elements of Size bytes. Indices are treated as signed, so the
+// caller must ensure that every valid index fits in an int32_t.
+TCB_SPAN_TARGET("avx512f")
+inline std::size_t gather32_avx512(const void* src, const std::uint32_t* idx,
+                                   void* dst, std::size_t n)
+{
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m512i vidx = _mm512_loadu_si512(idx + i);
+        _mm512_storeu_si512(static_cast<std::uint32_t*>(dst) + i,
+                            _mm512_i32gather_epi32(vidx, src, 4));
+    }
+    return i;
+}
+
+TCB_SPAN_TARGET("avx512f")
+inline std::size_t gather64_avx512(const void* src, const std::uint32_t* idx,
+                                   void* dst, std::size_t n)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i vidx =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx + i));
+        _mm512_storeu_si512(static_cast<std::uint64_t*>(dst) + i,
+                            _mm512_i32gather_epi64(vidx, src, 8));
+    }
+    return i;
+}
+
+TCB_SPAN_TARGET("avx2")
+inline std::size_t gather32_avx2(const void* src, const std::uint32_t* idx,
+                                 void* dst, std::size_t n)
+{
+    const int* base = static_cast<const int*>(src);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i vidx =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx + i));
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(static_cast<std::uint32_t*>(dst) + i),
+            _mm256_i32gather_epi32(base, vidx, 4));
+    }
+    return i;
+}
+
+TCB_SPAN_TARGET("avx2")
+inline std::size_t gather64_avx2(const void* src, const std::uint32_t* idx,
+                                 void* dst, std::size_t n)
+{
+    const long long* base = static_cast<const long long*>(src);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i vidx =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(idx + i));
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(static_cast<std::uint64_t*>(dst) + i),
+            _mm256_i32gather_epi64(base, vidx, 8));
+    }
+    return i;
+}
+
+TCB_SPAN_TARGET("avx512f")
+inline std::size_t scatter32_avx512(const void* src, const std::uint32_t* idx,
+                                    void* dst, std::size_t n)
+{
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m512i vidx = _mm512_loadu_si512(idx + i);
+        const __m512i v =
+            _mm512_loadu_si512(static_cast<const std::uint32_t*>(src) + i);
+        // Conflicting indices are written in lane order, so the last write
+        // wins just as in the scalar loop
+        _mm512_i32scatter_epi32(dst, vidx, v, 4);
+    }
+    return i;
+}
+
+TCB_SPAN_TARGET("avx512f")
+inline std::size_t scatter64_avx512(const void* src, const std::uint32_t* idx,
+                                    void* dst, std::size_t n)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i vidx =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx + i));
+        const __m512i v =
+            _mm512_loadu_si512(static_cast<const std::uint64_t*>(src) + i);
+        _mm512_i32scatter_epi64(dst, vidx, v, 8);
+    }
+    return i;
+}
+
+#endif // TCB_SPAN_HAVE_X86_SIMD
+
+template <typename I>
+unsigned_index_t<I> max_index(const I* idx, std::size_t n)
+{
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+    if (sizeof(I) == 4 && cpu().avx2) {
+        return static_cast<unsigned_index_t<I>>(
+            max_index_avx2(reinterpret_cast<const std::uint32_t*>(idx), n));
+    }
+#endif
+    return max_index_scalar(idx, n);
+}
+
+// Whether the hardware gather/scatter kernels can be used for these types.
+// Indices must be 32 bits, and values 32 or 64 bits.
+template <typename T, typename I>
+struct is_simd_gatherable {
+    static constexpr bool value =
+        std::is_integral<I>::value && sizeof(I) == 4 &&
+        std::is_trivially_copyable<T>::value &&
+        (sizeof(T) == 4 || sizeof(T) == 8);
+};
+
+// The hardware instructions treat indices as signed
+inline bool fits_gather_index(std::size_t size)
+{
+    return size <= static_cast<std::size_t>(INT_MAX);
+}
+
+// Each of these returns the number of elements handled, leaving the rest to
+// the scalar loop
+template <typename T, typename I>
+std::size_t gather_simd(const T* src, std::size_t src_size, const I* idx,
+                        T* dst, std::size_t n, std::true_type)
+{
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+    if (!fits_gather_index(src_size)) {
+        return 0;
+    }
+    const std::uint32_t* uidx = reinterpret_cast<const std::uint32_t*>(idx);
+    const cpu_features& features = cpu();
+    if (sizeof(T) == 4) {
+        if (features.avx512f) {
+            return gather32_avx512(src, uidx, dst, n);
+        }
+        if (features.avx2) {
+            return gather32_avx2(src, uidx, dst, n);
+        }
+    } else {
+        if (features.avx512f) {
+            return gather64_avx512(src, uidx, dst, n);
+        }
+        if (features.avx2) {
+            return gather64_avx2(src, uidx, dst, n);
+        }
+    }
+#else
+    (void) src, (void) src_size, (void) idx, (void) dst, (void) n;
+#endif
+    return 0;
+}
+
+template <typename T, typename I>
+std::size_t gather_simd(const T*, std::size_t, const I*, T*, std::size_t,
+                        std::false_type)
+{
+    return 0;
+}
+
+template <typename T, typename I>
+std::size_t scatter_simd(const T* src, const I* idx, T* dst,
+                         std::size_t dst_size, std::size_t n, std::true_type)
+{
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+    if (!fits_gather_index(dst_size) || !cpu().avx512f) {
+        return 0;
+    }
+    const std::uint32_t* uidx = reinterpret_cast<const std::uint32_t*>(idx);
+    return sizeof(T) == 4 ? scatter32_avx512(src, uidx, dst, n)
+                          : scatter64_avx512(src, uidx, dst, n);
+#else
+    (void) src, (void) idx, (void) dst, (void) dst_size, (void) n;
+    return 0;
+#endif
+}
+
+template <typename T, typename I>
+std::size_t scatter_simd(const T*, const I*, T*, std::size_t, std::size_t,
+                         std::false_type)
+{
+    return 0;
+}
+
+} // namespace detail
+
+// Sets dst[i] = src[idx[i]] for each i in [0, idx.size()), and returns the
+// written part of dst. The indices are bounds-checked all at once (when
+// contract checking is enabled), rather than per element.
+template <typename T, std::size_t SrcExtent, typename I, std::size_t IdxExtent,
+          typename U, std::size_t DstExtent>
+span<U> gather(span<T, SrcExtent> src, span<I, IdxExtent> idx,
+               span<U, DstExtent> dst)
+{
+    static_assert(std::is_same<typename std::remove_cv<T>::type, U>::value,
+                  "gather() requires matching source and destination types");
+    static_assert(std::is_integral<I>::value,
+                  "gather() requires integral indices");
+    TCB_SPAN_EXPECT(idx.size() <= dst.size());
+    TCB_SPAN_EXPECT(idx.empty() ||
+                    detail::max_index(idx.data(), idx.size()) < src.size());
+
+    using index_type = typename std::remove_cv<I>::type;
+    const std::size_t n = idx.size();
+    const U* s = src.data();
+    const index_type* ix = idx.data();
+    U* d = dst.data();
+
+    std::size_t i = detail::gather_simd(
+        s, src.size(), ix, d, n,
+        std::integral_constant<
+            bool, detail::is_simd_gatherable<U, index_type>::value>{});
+    for (; i + 4 <= n; i += 4) {
+        d[i] = s[ix[i]];
+        d[i + 1] = s[ix[i + 1]];
+        d[i + 2] = s[ix[i + 2]];
+        d[i + 3] = s[ix[i + 3]];
+    }
+    for (; i < n; i++) {
+        d[i] = s[ix[i]];
+    }
+    return dst.first(n);
+}
+
+// Sets dst[idx[i]] = src[i] for each i in [0, idx.size()). Where indices are
+// repeated, the element with the highest i is the one which is stored. As
+// with gather(), the indices are bounds-checked all at once.
+template <typename T, std::size_t SrcExtent, typename I, std::size_t IdxExtent,
+          typename U, std::size_t DstExtent>
+void scatter(span<T, SrcExtent> src, span<I, IdxExtent> idx,
+             span<U, DstExtent> dst)
+{
+    static_assert(std::is_same<typename std::remove_cv<T>::type, U>::value,
+                  "scatter() requires matching source and destination types");
+    static_assert(std::is_integral<I>::value,
+                  "scatter() requires integral indices");
+    TCB_SPAN_EXPECT(idx.size() <= src.size());
+    TCB_SPAN_EXPECT(idx.empty() ||
+                    detail::max_index(idx.data(), idx.size()) < dst.size());
+
+    using index_type = typename std::remove_cv<I>::type;
+    const std::size_t n = idx.size();
+    const U* s = src.data();
+    const index_type* ix = idx.data();
+    U* d = dst.data();
+
+    std::size_t i = detail::scatter_simd(
+        s, ix, d, dst.size(), n,
+        std::integral_constant<
+            bool, detail::is_simd_gatherable<U, index_type>::value>{});
+    for (; i + 4 <= n; i += 4) {
+        d[ix[i]] = s[i];
+        d[ix[i + 1]] = s[i + 1];
+        d[ix[i + 2]] = s[i + 2];
+        d[ix[i + 3]] = s[i + 3];
+    }
+    for (; i < n; i++) {
+        d[ix[i]] = s[i];
+    }
+}
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_GATHER_HPP_INCLUDED
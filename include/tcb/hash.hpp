@@ -0,0 +1,311 @@
+
+/*
+Fast non-cryptographic hashing of span contents
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_HASH_HPP_INCLUDED
+#define TCB_HASH_HPP_INCLUDED
+
+#include "span_ext.hpp"
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+namespace detail {
+
+// The hash follows the construction of wyhash (final version 4): input is
+// consumed 48 bytes at a time in three independent lanes, each step being a
+// 64x64 -> 128-bit multiply of the data xored with secret constants, folded
+// back to 64 bits. Inputs of up to 16 bytes are read with a few overlapping
+// loads and need only two multiplies.
+
+constexpr std::uint64_t hash_secret0 = 0x2d358dccaa6c78a5u;
+constexpr std::uint64_t hash_secret1 = 0x8bb84b93962eacc9u;
+constexpr std::uint64_t hash_secret2 = 0x4b33a62ed433d4a3u;
+constexpr std::uint64_t hash_secret3 = 0x4d5a2da51de1aa47u;
+
+#if defined(__SIZEOF_INT128__)
+__extension__ typedef unsigned __int128 hash_uint128;
+#endif
+
+// Sets a and b to the low and high halves of their product
+inline void hash_mum(std::uint64_t& a, std::uint64_t& b) noexcept
+{
+#if defined(__SIZEOF_INT128__)
+    const hash_uint128 r = static_cast<hash_uint128>(a) * b;
+    a = static_cast<std::uint64_t>(r);
+    b = static_cast<std::uint64_t>(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    a = _umul128(a, b, &b);
+#else
+    const std::uint64_t ha = a >> 32, hb = b >> 32;
+    const std::uint64_t la = a & 0xffffffffu, lb = b & 0xffffffffu;
+    const std::uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la;
+    const std::uint64_t rl = la * lb;
+    const std::uint64_t t = rl + (rm0 << 32);
+    std::uint64_t carry = t < rl;
+    const std::uint64_t lo = t + (rm1 << 32);
+    carry += lo < t;
+    b = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+    a = lo;
+#endif
+}
+
+inline std::uint64_t hash_mix(std::uint64_t a, std::uint64_t b) noexcept
+{
+    hash_mum(a, b);
+    return a ^ b;
+}
+
+inline std::uint64_t hash_seed(std::uint64_t seed) noexcept
+{
+    return seed ^ hash_mix(seed ^ hash_secret0, hash_secret1);
+}
+
+// Reads one to three bytes
+inline std::uint64_t hash_read3(const unsigned char* p, std::size_t len)
+{
+    return static_cast<std::uint64_t>(p[0]) << 16 |
+           static_cast<std::uint64_t>(p[len >> 1]) << 8 | p[len - 1];
+}
+
+// Reads up to 16 bytes as two words
+inline void hash_read_small(const unsigned char* p, std::size_t len,
+                            std::uint64_t& a, std::uint64_t& b) noexcept
+{
+    if (len >= 4) {
+        const std::size_t mid = (len >> 3) << 2;
+        a = static_cast<std::uint64_t>(load_le32(p)) << 32 |
+            load_le32(p + mid);
+        b = static_cast<std::uint64_t>(load_le32(p + len - 4)) << 32 |
+            load_le32(p + len - 4 - mid);
+    } else if (len > 0) {
+        a = hash_read3(p, len);
+        b = 0;
+    } else {
+        a = b = 0;
+    }
+}
+
+// The three-lane state used for inputs of more than 48 bytes
+struct hash_lanes {
+    std::uint64_t seed;
+    std::uint64_t see1;
+    std::uint64_t see2;
+
+    void consume(const unsigned char* p) noexcept
+    {
+        seed = hash_mix(load_le64(p) ^ hash_secret1,
+                        load_le64(p + 8) ^ seed);
+        see1 = hash_mix(load_le64(p + 16) ^ hash_secret2,
+                        load_le64(p + 24) ^ see1);
+        see2 = hash_mix(load_le64(p + 32) ^ hash_secret3,
+                        load_le64(p + 40) ^ see2);
+    }
+};
+
+// Hashes the final 1 to 48 bytes [p, p + i) of an input of more than 16
+// bytes. The 16 bytes before p must be readable.
+inline std::uint64_t hash_tail(const unsigned char* p, std::size_t i,
+                               std::uint64_t seed, std::uint64_t len) noexcept
+{
+    while (i > 16) {
+        seed = hash_mix(load_le64(p) ^ hash_secret1, load_le64(p + 8) ^ seed);
+        i -= 16;
+        p += 16;
+    }
+    std::uint64_t a = load_le64(p + i - 16);
+    std::uint64_t b = load_le64(p + i - 8);
+    a ^= hash_secret1;
+    b ^= seed;
+    hash_mum(a, b);
+    return hash_mix(a ^ hash_secret0 ^ len, b ^ hash_secret1);
+}
+
+inline std::uint64_t hash_finish_small(std::uint64_t a, std::uint64_t b,
+                                       std::uint64_t seed,
+                                       std::uint64_t len) noexcept
+{
+    a ^= hash_secret1;
+    b ^= seed;
+    hash_mum(a, b);
+    return hash_mix(a ^ hash_secret0 ^ len, b ^ hash_secret1);
+}
+
+inline std::uint64_t hash_bytes(const unsigned char* p, std::size_t len,
+                                std::uint64_t seed) noexcept
+{
+    seed = hash_seed(seed);
+    if (len <= 16) {
+        std::uint64_t a, b;
+        hash_read_small(p, len, a, b);
+        return hash_finish_small(a, b, seed, len);
+    }
+    std::size_t i = len;
+    if (i > 48) {
+        hash_lanes lanes{seed, seed, seed};
+        do {
+            lanes.consume(p);
+            p += 48;
+            i -= 48;
+        } while (i > 48);
+        seed = lanes.seed ^ lanes.see1 ^ lanes.see2;
+    }
+    return hash_tail(p, i, seed, len);
+}
+
+// Keys whose size is known at compile time. The common sizes get straight-line
+// code; others use the general function, which may still be inlined.
+template <std::size_t Bytes>
+std::uint64_t hash_fixed(const unsigned char* p, std::uint64_t seed)
+{
+    return hash_bytes(p, Bytes, seed);
+}
+
+template <>
+inline std::uint64_t hash_fixed<8>(const unsigned char* p, std::uint64_t seed)
+{
+    const std::uint64_t lo = load_le32(p);
+    const std::uint64_t hi = load_le32(p + 4);
+    return hash_finish_small(lo << 32 | hi, hi << 32 | lo, hash_seed(seed), 8);
+}
+
+template <>
+inline std::uint64_t hash_fixed<16>(const unsigned char* p,
+                                    std::uint64_t seed)
+{
+    const std::uint64_t a =
+        static_cast<std::uint64_t>(load_le32(p)) << 32 | load_le32(p + 8);
+    const std::uint64_t b =
+        static_cast<std::uint64_t>(load_le32(p + 12)) << 32 | load_le32(p + 4);
+    return hash_finish_small(a, b, hash_seed(seed), 16);
+}
+
+template <>
+inline std::uint64_t hash_fixed<32>(const unsigned char* p,
+                                    std::uint64_t seed)
+{
+    seed = hash_seed(seed);
+    seed = hash_mix(load_le64(p) ^ hash_secret1, load_le64(p + 8) ^ seed);
+    return hash_finish_small(load_le64(p + 16), load_le64(p + 24), seed, 32);
+}
+
+template <typename T, std::size_t Extent>
+std::uint64_t hash_span(span<T, Extent> s, std::uint64_t seed, std::true_type)
+{
+    return hash_fixed<Extent * sizeof(T)>(
+        reinterpret_cast<const unsigned char*>(s.data()), seed);
+}
+
+template <typename T, std::size_t Extent>
+std::uint64_t hash_span(span<T, Extent> s, std::uint64_t seed,
+                        std::false_type)
+{
+    return hash_bytes(reinterpret_cast<const unsigned char*>(s.data()),
+                      s.size_bytes(), seed);
+}
+
+} // namespace detail
+
+// Returns a 64-bit hash of the bytes of s, for hash tables, deduplication and
+// the like. This is fast for inputs of all sizes, but is not cryptographically
+// secure; vary the seed per process if hash flooding is a concern.
+//
+// The hash is of the object representation, so T must be trivially copyable
+// and should not contain padding. Spans with a static extent of 8, 16 or 32
+// bytes are hashed with dedicated straight-line code. The result depends only
+// on the bytes, not on T or the extent, and for the same bytes is the same on
+// all platforms.
+template <typename T, std::size_t Extent>
+std::uint64_t hash(span<T, Extent> s, std::uint64_t seed = 0) noexcept
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "hash() requires a trivially copyable element type");
+    return detail::hash_span(
+        s, seed, std::integral_constant<bool, Extent != dynamic_extent>{});
+}
+
+// Computes the same hash as hash() over a sequence of spans, as if they had
+// been concatenated. At most 64 bytes are buffered between calls to update().
+class hasher {
+public:
+    explicit hasher(std::uint64_t seed = 0) noexcept
+        : lanes_{detail::hash_seed(seed), 0, 0}
+    {
+        lanes_.see1 = lanes_.see2 = lanes_.seed;
+    }
+
+    template <typename T, std::size_t Extent>
+    hasher& update(span<T, Extent> s) noexcept
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "hasher requires a trivially copyable element type");
+        update_bytes(reinterpret_cast<const unsigned char*>(s.data()),
+                     s.size_bytes());
+        return *this;
+    }
+
+    // The hash of everything passed to update() so far. More data may be
+    // added afterwards.
+    std::uint64_t digest() const noexcept
+    {
+        const unsigned char* p = buffer_ + history_size;
+        if (length_ <= 16) {
+            std::uint64_t a, b;
+            detail::hash_read_small(p, pending_, a, b);
+            return detail::hash_finish_small(a, b, lanes_.seed, length_);
+        }
+        const std::uint64_t seed =
+            length_ > block_size ? lanes_.seed ^ lanes_.see1 ^ lanes_.see2
+                                 : lanes_.seed;
+        return detail::hash_tail(p, pending_, seed, length_);
+    }
+
+private:
+    static constexpr std::size_t block_size = 48;
+    static constexpr std::size_t history_size = 16;
+
+    // Blocks are only consumed once data beyond them has arrived, since the
+    // final (possibly partial) block is hashed differently. Its last 16 bytes
+    // are kept as history, as the hash of the tail may read back into them.
+    void update_bytes(const unsigned char* p, std::size_t n) noexcept
+    {
+        length_ += n;
+        if (pending_ + n <= block_size) {
+            std::memcpy(buffer_ + history_size + pending_, p, n);
+            pending_ += n;
+            return;
+        }
+        if (pending_ > 0) {
+            const std::size_t fill = block_size - pending_;
+            std::memcpy(buffer_ + history_size + pending_, p, fill);
+            p += fill;
+            n -= fill;
+            lanes_.consume(buffer_ + history_size);
+            std::memcpy(buffer_, buffer_ + block_size, history_size);
+        }
+        for (; n > block_size; p += block_size, n -= block_size) {
+            lanes_.consume(p);
+            std::memcpy(buffer_, p + block_size - history_size,
+                        history_size);
+        }
+        std::memcpy(buffer_ + history_size, p, n);
+        pending_ = n;
+    }
+
+    detail::hash_lanes lanes_;
+    std::uint64_t length_ = 0;
+    std::size_t pending_ = 0;
+    unsigned char buffer_[history_size + block_size] = {};
+};
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_HASH_HPP_INCLUDED
@@ -0,0 +1,649 @@
+
+/*
+Compression of spans of integers into spans of bytes
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_INT_CODEC_HPP_INCLUDED
+#define TCB_INT_CODEC_HPP_INCLUDED
+
+#include "span_ext.hpp"
+
+#include <algorithm>
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+namespace detail {
+
+// Block codecs
+//
+// Values are encoded in blocks of up to 128. Each block starts with a header
+// holding its value count minus one (one byte), the bit width b of its packed
+// values (one byte) and a reference value (sizeof(T) bytes). The 128 packed
+// values follow in 16 * b bytes, with any slots beyond the count set to zero.
+//
+// The packed values are arranged vertically, as in SIMD-BP128: the payload is
+// b rows of 16 bytes, each holding one word of T from each of 16 / sizeof(T)
+// lanes. Value i belongs to lane i % lanes, and each lane packs its values
+// into its column of words. Unpacking a row of values then takes the same
+// shifts and masks in every lane, so can be done in a SIMD register, and the
+// values come out in order.
+//
+// Words are stored in the host's byte order.
+
+constexpr std::size_t int_block_size = 128;
+
+template <typename T>
+struct int_block_traits {
+    static_assert(std::is_same<T, std::uint32_t>::value ||
+                      std::is_same<T, std::uint64_t>::value,
+                  "Block codecs support std::uint32_t and std::uint64_t");
+
+    static constexpr unsigned value_bits = 8 * sizeof(T);
+    static constexpr unsigned lanes = 16 / sizeof(T);
+    static constexpr std::size_t header_size = 2 + sizeof(T);
+};
+
+enum class int_block_kind { frame_of_reference, delta };
+
+template <typename T>
+T load_word(const unsigned char* p) noexcept
+{
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+template <typename T>
+void store_word(unsigned char* p, T v) noexcept
+{
+    std::memcpy(p, &v, sizeof(T));
+}
+
+template <typename T>
+T width_mask(unsigned b) noexcept
+{
+    return b >= 8 * sizeof(T) ? static_cast<T>(~T{0})
+                              : static_cast<T>((T{1} << b) - 1);
+}
+
+// Packs 128 values of b bits into 16 * b bytes of payload
+template <typename T>
+void pack_int_block(const T* vals, unsigned b, unsigned char* out) noexcept
+{
+    using traits = int_block_traits<T>;
+    constexpr unsigned K = traits::value_bits;
+    constexpr unsigned L = traits::lanes;
+    for (unsigned j = 0; j < L; j++) {
+        unsigned char* p = out + j * sizeof(T);
+        T acc = 0;
+        unsigned fill = 0;
+        for (unsigned k = 0; k < K; k++) {
+            const T v = vals[k * L + j];
+            acc |= static_cast<T>(v << fill);
+            fill += b;
+            if (fill >= K) {
+                store_word<T>(p, acc);
+                p += 16;
+                fill -= K;
+                acc = fill > 0 ? static_cast<T>(v >> (b - fill)) : 0;
+            }
+        }
+    }
+}
+
+// Unpacks 128 values of b bits, for b > 0
+template <typename T>
+void unpack_int_block(const unsigned char* in, unsigned b, T* vals) noexcept
+{
+    using traits = int_block_traits<T>;
+    constexpr unsigned K = traits::value_bits;
+    constexpr unsigned L = traits::lanes;
+    const T mask = width_mask<T>(b);
+    for (unsigned j = 0; j < L; j++) {
+        const unsigned char* p = in + j * sizeof(T);
+        for (unsigned k = 0; k < K; k++) {
+            const unsigned bit = k * b;
+            const unsigned off = bit % K;
+            const unsigned char* w = p + 16 * (bit / K);
+            T v = static_cast<T>(load_word<T>(w) >> off);
+            if (off + b > K) {
+                v |= static_cast<T>(load_word<T>(w + 16) << (K - off));
+            }
+            vals[k * L + j] = static_cast<T>(v & mask);
+        }
+    }
+}
+
+#if defined(TCB_SPAN_HAVE_SSE2)
+
+// The lane operations needed to unpack and decode a row of values
+template <typename T>
+struct sse2_int_lanes;
+
+template <>
+struct sse2_int_lanes<std::uint32_t> {
+    static __m128i set1(std::uint32_t v)
+    {
+        return _mm_set1_epi32(static_cast<int>(v));
+    }
+    static __m128i srl(__m128i v, __m128i n) { return _mm_srl_epi32(v, n); }
+    static __m128i sll(__m128i v, __m128i n) { return _mm_sll_epi32(v, n); }
+    static __m128i add(__m128i a, __m128i b) { return _mm_add_epi32(a, b); }
+
+    // Adds the running total carry to the inclusive prefix sum of v, and
+    // broadcasts the last lane of the result into carry
+    static __m128i prefix_sum(__m128i v, __m128i& carry)
+    {
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+        v = _mm_add_epi32(v, carry);
+        carry = _mm_shuffle_epi32(v, 0xff);
+        return v;
+    }
+};
+
+template <>
+struct sse2_int_lanes<std::uint64_t> {
+    static __m128i set1(std::uint64_t v)
+    {
+        return _mm_set1_epi64x(static_cast<long long>(v));
+    }
+    static __m128i srl(__m128i v, __m128i n) { return _mm_srl_epi64(v, n); }
+    static __m128i sll(__m128i v, __m128i n) { return _mm_sll_epi64(v, n); }
+    static __m128i add(__m128i a, __m128i b) { return _mm_add_epi64(a, b); }
+
+    static __m128i prefix_sum(__m128i v, __m128i& carry)
+    {
+        v = _mm_add_epi64(v, _mm_slli_si128(v, 8));
+        v = _mm_add_epi64(v, carry);
+        carry = _mm_unpackhi_epi64(v, v);
+        return v;
+    }
+};
+
+// Unpacks and decodes 128 values of b bits, for b > 0, a row at a time
+template <typename T>
+void decode_int_block_sse2(const unsigned char* in, unsigned b, T reference,
+                           int_block_kind kind, T* out) noexcept
+{
+    using lanes = sse2_int_lanes<T>;
+    constexpr unsigned K = int_block_traits<T>::value_bits;
+    constexpr unsigned L = int_block_traits<T>::lanes;
+    const __m128i mask = lanes::set1(width_mask<T>(b));
+    const __m128i ref = lanes::set1(reference);
+    __m128i carry = ref;
+    for (unsigned k = 0; k < K; k++) {
+        const unsigned bit = k * b;
+        const unsigned off = bit % K;
+        const unsigned char* w = in + 16 * (bit / K);
+        __m128i v = lanes::srl(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(w)),
+            _mm_cvtsi32_si128(static_cast<int>(off)));
+        if (off + b > K) {
+            v = _mm_or_si128(
+                v, lanes::sll(
+                       _mm_loadu_si128(
+                           reinterpret_cast<const __m128i*>(w + 16)),
+                       _mm_cvtsi32_si128(static_cast<int>(K - off))));
+        }
+        v = _mm_and_si128(v, mask);
+        v = kind == int_block_kind::delta ? lanes::prefix_sum(v, carry)
+                                          : lanes::add(v, ref);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + k * L), v);
+    }
+}
+
+#endif // TCB_SPAN_HAVE_SSE2
+
+// Decodes all 128 slots of a block into out
+template <typename T>
+void decode_int_block(const unsigned char* in, unsigned b, T reference,
+                      int_block_kind kind, T* out) noexcept
+{
+    if (b == 0) {
+        std::fill(out, out + int_block_size, reference);
+        return;
+    }
+#if defined(TCB_SPAN_HAVE_SSE2)
+    decode_int_block_sse2<T>(in, b, reference, kind, out);
+#else
+    unpack_int_block<T>(in, b, out);
+    T acc = reference;
+    for (std::size_t i = 0; i < int_block_size; i++) {
+        out[i] = kind == int_block_kind::delta ? (acc += out[i])
+                                               : static_cast<T>(out[i] +
+                                                                reference);
+    }
+#endif
+}
+
+template <typename T>
+codec_result<const T, byte> encode_int_blocks(span<const T> in,
+                                              span<byte> out,
+                                              int_block_kind kind)
+{
+    using traits = int_block_traits<T>;
+    unsigned char* const first = reinterpret_cast<unsigned char*>(out.data());
+    unsigned char* dst = first;
+    std::size_t avail = out.size();
+    std::size_t i = 0;
+    T vals[int_block_size];
+    while (i < in.size()) {
+        const std::size_t count = (std::min)(int_block_size, in.size() - i);
+        const T* src = in.data() + i;
+
+        T reference;
+        if (kind == int_block_kind::delta) {
+            reference = src[0];
+            vals[0] = 0;
+            for (std::size_t j = 1; j < count; j++) {
+                vals[j] = static_cast<T>(src[j] - src[j - 1]);
+            }
+        } else {
+            reference = *std::min_element(src, src + count);
+            for (std::size_t j = 0; j < count; j++) {
+                vals[j] = static_cast<T>(src[j] - reference);
+            }
+        }
+        std::fill(vals + count, vals + int_block_size, T{0});
+
+        T all = 0;
+        for (std::size_t j = 0; j < count; j++) {
+            all |= vals[j];
+        }
+        const unsigned b =
+            all == 0 ? 0 : 64 - static_cast<unsigned>(clz64(all));
+        const std::size_t block_bytes = traits::header_size + 16 * b;
+        if (block_bytes > avail) {
+            break;
+        }
+
+        dst[0] = static_cast<unsigned char>(count - 1);
+        dst[1] = static_cast<unsigned char>(b);
+        store_word<T>(dst + 2, reference);
+        pack_int_block<T>(vals, b, dst + traits::header_size);
+        dst += block_bytes;
+        avail -= block_bytes;
+        i += count;
+    }
+    return {in.first(i), out.first(static_cast<std::size_t>(dst - first))};
+}
+
+template <typename T>
+codec_result<const byte, T> decode_int_blocks(span<const byte> in,
+                                              span<T> out,
+                                              int_block_kind kind)
+{
+    using traits = int_block_traits<T>;
+    const unsigned char* const first =
+        reinterpret_cast<const unsigned char*>(in.data());
+    const unsigned char* src = first;
+    std::size_t avail = in.size();
+    std::size_t n = 0;
+    T vals[int_block_size];
+    while (avail >= traits::header_size) {
+        const std::size_t count = std::size_t{src[0]} + 1;
+        const unsigned b = src[1];
+        if (count > int_block_size || b > traits::value_bits) {
+            break; // malformed
+        }
+        const std::size_t block_bytes = traits::header_size + 16 * b;
+        if (block_bytes > avail || count > out.size() - n) {
+            break;
+        }
+
+        const T reference = load_word<T>(src + 2);
+        const unsigned char* payload = src + traits::header_size;
+        if (count == int_block_size) {
+            decode_int_block<T>(payload, b, reference, kind, out.data() + n);
+        } else {
+            decode_int_block<T>(payload, b, reference, kind, vals);
+            std::copy(vals, vals + count, out.data() + n);
+        }
+        src += block_bytes;
+        avail -= block_bytes;
+        n += count;
+    }
+    return {in.first(static_cast<std::size_t>(src - first)), out.first(n)};
+}
+
+} // namespace detail
+
+// The largest number of bytes needed to encode count values of type T with
+// the block codecs below
+template <typename T>
+constexpr std::size_t max_block_encoded_size(std::size_t count) noexcept
+{
+    return (count + detail::int_block_size - 1) / detail::int_block_size *
+           (detail::int_block_traits<T>::header_size +
+            16 * detail::int_block_traits<T>::value_bits);
+}
+
+// Block codecs for spans of std::uint32_t or std::uint64_t.
+//
+// encode_for() and decode_for() use frame-of-reference coding, storing each
+// block of up to 128 values as offsets from the block's minimum value, packed
+// into as few bits as the largest offset needs. This suits values which are
+// clustered but unordered.
+//
+// encode_delta() and decode_delta() store the differences between successive
+// values instead (wrapping on overflow), which suits sorted sequences such as
+// ID lists. Decoding computes the running sums a SIMD register at a time.
+//
+// Blocks are independent, and are only ever encoded or decoded whole: each
+// function processes as many blocks as fit in both the input and the output,
+// and returns the consumed and produced prefixes so that a stream can be
+// encoded or decoded through fixed-size buffers. Decoding also stops at a
+// malformed block header, which is left unconsumed.
+
+template <typename T, std::size_t InExtent, std::size_t OutExtent>
+codec_result<const typename std::remove_cv<T>::type, byte>
+encode_for(span<T, InExtent> in, span<byte, OutExtent> out)
+{
+    using value_type = typename std::remove_cv<T>::type;
+    return detail::encode_int_blocks<value_type>(
+        in, out, detail::int_block_kind::frame_of_reference);
+}
+
+template <typename B, std::size_t InExtent, typename T, std::size_t OutExtent>
+codec_result<const byte, T> decode_for(span<B, InExtent> in,
+                                       span<T, OutExtent> out)
+{
+    static_assert(std::is_same<typename std::remove_cv<B>::type, byte>::value,
+                  "decode_for() requires a span of bytes");
+    return detail::decode_int_blocks<T>(
+        in, out, detail::int_block_kind::frame_of_reference);
+}
+
+template <typename T, std::size_t InExtent, std::size_t OutExtent>
+codec_result<const typename std::remove_cv<T>::type, byte>
+encode_delta(span<T, InExtent> in, span<byte, OutExtent> out)
+{
+    using value_type = typename std::remove_cv<T>::type;
+    return detail::encode_int_blocks<value_type>(
+        in, out, detail::int_block_kind::delta);
+}
+
+template <typename B, std::size_t InExtent, typename T, std::size_t OutExtent>
+codec_result<const byte, T> decode_delta(span<B, InExtent> in,
+                                         span<T, OutExtent> out)
+{
+    static_assert(std::is_same<typename std::remove_cv<B>::type, byte>::value,
+                  "decode_delta() requires a span of bytes");
+    return detail::decode_int_blocks<T>(in, out,
+                                        detail::int_block_kind::delta);
+}
+
+namespace detail {
+
+// Varints
+//
+// Each value is stored in little-endian groups of seven bits, one per byte,
+// with the high bit of each byte set if another byte follows (LEB128, as used
+// by Protocol Buffers). A std::uint64_t takes between one and ten bytes.
+
+constexpr std::size_t max_varint_size = 10;
+
+inline std::size_t varint_size(std::uint64_t v) noexcept
+{
+    return v == 0 ? 1 : (70 - static_cast<std::size_t>(clz64(v))) / 7;
+}
+
+// Decodes one varint from [p, end), advancing p past it. Returns false, and
+// leaves p unchanged, if the varint is truncated or does not fit in 64 bits.
+inline bool decode_varint(const unsigned char*& p, const unsigned char* end,
+                          std::uint64_t& value) noexcept
+{
+    std::uint64_t v = 0;
+    for (std::size_t i = 0; i < max_varint_size && p + i != end; i++) {
+        const std::uint64_t b = p[i];
+        v |= (b & 0x7f) << (7 * i);
+        if (b < 0x80) {
+            if (i == max_varint_size - 1 && b > 1) {
+                return false;
+            }
+            p += i + 1;
+            value = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Encodes v at p, which must have room for max_varint_size bytes, and returns
+// the end of the encoding. This is branch-free apart from the rare values
+// wider than 56 bits: the low 56 bits are spread into the low seven bits of
+// eight bytes, and the continuation bits are set with a mask.
+inline unsigned char* encode_varint(std::uint64_t v, unsigned char* p) noexcept
+{
+    const std::size_t len = varint_size(v);
+    std::uint64_t spread = 0;
+    for (unsigned i = 0; i < 8; i++) {
+        spread |= (v << i) & (std::uint64_t{0x7f} << (8 * i));
+    }
+    const std::uint64_t more =
+        len > 8 ? ~std::uint64_t{0}
+                : (std::uint64_t{1} << (8 * (len - 1))) - 1;
+    spread |= more & 0x8080808080808080u;
+    // The compiler merges these into a single store
+    for (unsigned i = 0; i < 8; i++) {
+        p[i] = static_cast<unsigned char>(spread >> (8 * i));
+    }
+    if (len > 8) {
+        p[8] = static_cast<unsigned char>(((v >> 56) & 0x7f) |
+                                          (len > 9 ? 0x80 : 0));
+        p[9] = static_cast<unsigned char>(v >> 63);
+    }
+    return p + len;
+}
+
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+
+// For each pattern of continuation bits in eight bytes, the byte shuffle
+// which moves the longest run of leading one- and two-byte varints (up to
+// eight of them) into 16-bit lanes, with the number of varints and bytes
+// which that covers
+struct varint_shuffle_table {
+    struct entry {
+        unsigned char shuffle[16];
+        unsigned char count;
+        unsigned char length;
+    };
+
+    entry entries[256];
+
+    varint_shuffle_table() noexcept
+    {
+        for (unsigned m = 0; m < 256; m++) {
+            entry& e = entries[m];
+            std::memset(e.shuffle, 0x80, sizeof(e.shuffle));
+            unsigned pos = 0;
+            unsigned n = 0;
+            while (n < 8 && pos < 8) {
+                if (((m >> pos) & 1) == 0) {
+                    e.shuffle[2 * n] = static_cast<unsigned char>(pos);
+                    pos += 1;
+                } else if (pos + 1 < 8 && ((m >> (pos + 1)) & 1) == 0) {
+                    e.shuffle[2 * n] = static_cast<unsigned char>(pos);
+                    e.shuffle[2 * n + 1] = static_cast<unsigned char>(pos + 1);
+                    pos += 2;
+                } else {
+                    break;
+                }
+                ++n;
+            }
+            e.count = static_cast<unsigned char>(n);
+            e.length = static_cast<unsigned char>(pos);
+        }
+    }
+};
+
+inline const varint_shuffle_table::entry* varint_shuffles() noexcept
+{
+    static const varint_shuffle_table table;
+    return table.entries;
+}
+
+// Stores the eight 16-bit lanes of v as std::uint64_t values
+TCB_SPAN_TARGET("sse4.1")
+inline void store_u16_lanes(__m128i v, std::uint64_t* out) noexcept
+{
+    __m128i* o = reinterpret_cast<__m128i*>(out);
+    _mm_storeu_si128(o, _mm_cvtepu16_epi64(v));
+    _mm_storeu_si128(o + 1, _mm_cvtepu16_epi64(_mm_srli_si128(v, 4)));
+    _mm_storeu_si128(o + 2, _mm_cvtepu16_epi64(_mm_srli_si128(v, 8)));
+    _mm_storeu_si128(o + 3, _mm_cvtepu16_epi64(_mm_srli_si128(v, 12)));
+}
+
+// Decodes varints in the style of Masked VByte while at least 16 bytes of
+// input and 16 values of output space remain, stopping early at a varint
+// longer than two bytes. The continuation bits of the next eight bytes select
+// a shuffle which spreads their leading short varints into 16-bit lanes,
+// where the seven-bit groups are joined with shifts and masks. Sixteen
+// single-byte varints in a row are simply widened.
+TCB_SPAN_TARGET("sse4.1")
+inline void decode_varints_sse41(const unsigned char*& in,
+                                 const unsigned char* in_end,
+                                 std::uint64_t*& out,
+                                 const std::uint64_t* out_end) noexcept
+{
+    const varint_shuffle_table::entry* table = varint_shuffles();
+    const __m128i low7 = _mm_set1_epi16(0x7f);
+    const __m128i high7 = _mm_set1_epi16(0x3f80);
+    while (in_end - in >= 16 && out_end - out >= 16) {
+        const __m128i bytes =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        const unsigned mask =
+            static_cast<unsigned>(_mm_movemask_epi8(bytes));
+        if (mask == 0) {
+            store_u16_lanes(_mm_cvtepu8_epi16(bytes), out);
+            store_u16_lanes(_mm_cvtepu8_epi16(_mm_srli_si128(bytes, 8)),
+                            out + 8);
+            in += 16;
+            out += 16;
+            continue;
+        }
+        const varint_shuffle_table::entry& e = table[mask & 0xff];
+        if (e.count == 0) {
+            return;
+        }
+        const __m128i shuffle =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(e.shuffle));
+        __m128i v = _mm_shuffle_epi8(bytes, shuffle);
+        v = _mm_or_si128(_mm_and_si128(v, low7),
+                         _mm_and_si128(_mm_srli_epi16(v, 1), high7));
+        store_u16_lanes(v, out);
+        in += e.length;
+        out += e.count;
+    }
+}
+
+#endif // TCB_SPAN_HAVE_X86_SIMD
+
+inline codec_result<const std::uint64_t, byte>
+encode_varints_impl(span<const std::uint64_t> in, span<byte> out)
+{
+    unsigned char* const first = reinterpret_cast<unsigned char*>(out.data());
+    unsigned char* p = first;
+    unsigned char* const end = first + out.size();
+    const std::uint64_t* v = in.data();
+    const std::uint64_t* const v_end = v + in.size();
+    while (v != v_end) {
+        // Runs of values below 128 take a byte each
+        if (v_end - v >= 8 && end - p >= 8 &&
+            (v[0] | v[1] | v[2] | v[3] | v[4] | v[5] | v[6] | v[7]) < 0x80) {
+            for (unsigned i = 0; i < 8; i++) {
+                p[i] = static_cast<unsigned char>(v[i]);
+            }
+            p += 8;
+            v += 8;
+        } else if (end - p >= static_cast<std::ptrdiff_t>(max_varint_size)) {
+            p = encode_varint(*v++, p);
+        } else {
+            unsigned char tmp[max_varint_size];
+            const std::size_t len =
+                static_cast<std::size_t>(encode_varint(*v, tmp) - tmp);
+            if (len > static_cast<std::size_t>(end - p)) {
+                break;
+            }
+            std::memcpy(p, tmp, len);
+            p += len;
+            ++v;
+        }
+    }
+    return {in.first(static_cast<std::size_t>(v - in.data())),
+            out.first(static_cast<std::size_t>(p - first))};
+}
+
+inline codec_result<const byte, std::uint64_t>
+decode_varints_impl(span<const byte> in, span<std::uint64_t> out)
+{
+    const unsigned char* const first =
+        reinterpret_cast<const unsigned char*>(in.data());
+    const unsigned char* p = first;
+    const unsigned char* const end = first + in.size();
+    std::uint64_t* o = out.data();
+    std::uint64_t* const o_end = o + out.size();
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+    const bool use_simd = cpu().sse41;
+#endif
+    while (o != o_end) {
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+        if (use_simd) {
+            decode_varints_sse41(p, end, o, o_end);
+            if (o == o_end) {
+                break;
+            }
+        }
+#endif
+        if (!decode_varint(p, end, *o)) {
+            break;
+        }
+        ++o;
+    }
+    return {in.first(static_cast<std::size_t>(p - first)),
+            out.first(static_cast<std::size_t>(o - out.data()))};
+}
+
+} // namespace detail
+
+// The largest number of bytes needed to encode count values as varints
+constexpr std::size_t max_varint_encoded_size(std::size_t count) noexcept
+{
+    return count * detail::max_varint_size;
+}
+
+// Encodes values from in as varints (LEB128, as in Protocol Buffers) into
+// out, stopping at the first value which does not fit.
+template <typename T, std::size_t InExtent, std::size_t OutExtent>
+codec_result<const std::uint64_t, byte>
+encode_varints(span<T, InExtent> in, span<byte, OutExtent> out)
+{
+    static_assert(
+        std::is_same<typename std::remove_cv<T>::type, std::uint64_t>::value,
+        "encode_varints() requires a span of std::uint64_t");
+    return detail::encode_varints_impl(in, out);
+}
+
+// Decodes varints from in into out, stopping when out is full or at a
+// varint which is truncated by the end of in or which overflows 64 bits. That
+// varint is left unconsumed, so a truncated one can be completed by the next
+// call. Short varints are decoded several at a time with SSE4.1 where
+// available, in which case elements of out beyond the produced prefix may be
+// overwritten.
+template <typename B, std::size_t InExtent, std::size_t OutExtent>
+codec_result<const byte, std::uint64_t>
+decode_varints(span<B, InExtent> in, span<std::uint64_t, OutExtent> out)
+{
+    static_assert(std::is_same<typename std::remove_cv<B>::type, byte>::value,
+                  "decode_varints() requires a span of bytes");
+    return detail::decode_varints_impl(in, out);
+}
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_INT_CODEC_HPP_INCLUDED
@@ -0,0 +1,578 @@
+
+/*
+Conversion between interleaved (array of structures) and separate (structure
+of arrays) layouts of spans
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_INTERLEAVE_HPP_INCLUDED
+#define TCB_INTERLEAVE_HPP_INCLUDED
+
+#include "span_ext.hpp"
+
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+namespace detail {
+
+// Whether the SIMD kernels handle N columns of type T
+template <std::size_t N, typename T>
+struct is_simd_interleavable
+    : std::integral_constant<bool, std::is_arithmetic<T>::value &&
+                                       (N == 2 || N == 3 || N == 4 ||
+                                        N == 8) &&
+                                       (sizeof(T) == 1 || sizeof(T) == 2 ||
+                                        sizeof(T) == 4 || sizeof(T) == 8)> {};
+
+// Whether the first Count of Ts are U, ignoring cv-qualification
+template <typename U, std::size_t Count, typename... Ts>
+struct leading_types_are : std::true_type {};
+
+template <typename U, std::size_t Count, typename T, typename... Ts>
+struct leading_types_are<U, Count, T, Ts...>
+    : std::integral_constant<
+          bool, std::is_same<typename std::remove_cv<T>::type, U>::value &&
+                    leading_types_are<U, Count - 1, Ts...>::value> {};
+
+template <typename U, typename T, typename... Ts>
+struct leading_types_are<U, 0, T, Ts...> : std::true_type {};
+
+// The interleaved side is either a span of the column type, with N elements
+// per row, or a span of records each holding one row of N values
+template <typename Row, typename U, std::size_t N>
+struct is_interleaved_row
+    : std::integral_constant<
+          bool, std::is_same<typename std::remove_cv<Row>::type, U>::value ||
+                    (std::is_trivially_copyable<Row>::value &&
+                     sizeof(Row) == N * sizeof(U))> {};
+
+template <typename Row, typename U, std::size_t N>
+struct interleaved_per_row
+    : byte_size_constant<
+          std::is_same<typename std::remove_cv<Row>::type, U>::value ? N
+                                                                     : 1> {};
+
+// The number of rows, as a compile-time constant when the interleaved span
+// has a static extent
+template <std::size_t Extent, std::size_t PerRow>
+std::size_t interleave_rows(std::size_t size, std::true_type /* dynamic */)
+{
+    return size / PerRow;
+}
+
+template <std::size_t Extent, std::size_t PerRow>
+byte_size_constant<Extent / PerRow>
+interleave_rows(std::size_t, std::false_type /* dynamic */)
+{
+    return {};
+}
+
+// Small static row counts are left to the scalar loops, which the compiler
+// can then unroll completely
+template <typename Rows, std::size_t RowBytes>
+struct is_unrolled_rows : std::false_type {};
+
+template <std::size_t R, std::size_t RowBytes>
+struct is_unrolled_rows<byte_size_constant<R>, RowBytes>
+    : std::integral_constant<bool, R * RowBytes <= 256> {};
+
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+
+// The AVX2 kernels for 2, 4 and 8 columns split and join pairs of vectors
+// recursively: the even and odd elements of an interleaving of N columns
+// are interleavings of N / 2 columns each.
+
+// Shuffles moving the even elements of each lane to its low half, and the
+// odd elements to its high half
+TCB_SPAN_TARGET("avx2")
+inline __m256i unzip_lanes_avx2(__m256i v, byte_size_constant<1>) noexcept
+{
+    return _mm256_shuffle_epi8(
+        v, _mm256_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13,
+                            15, 0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11,
+                            13, 15));
+}
+
+TCB_SPAN_TARGET("avx2")
+inline __m256i unzip_lanes_avx2(__m256i v, byte_size_constant<2>) noexcept
+{
+    return _mm256_shuffle_epi8(
+        v, _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14,
+                            15, 0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11,
+                            14, 15));
+}
+
+TCB_SPAN_TARGET("avx2")
+inline __m256i unzip_lanes_avx2(__m256i v, byte_size_constant<4>) noexcept
+{
+    return _mm256_shuffle_epi32(v, 0xd8);
+}
+
+TCB_SPAN_TARGET("avx2")
+inline __m256i unzip_lanes_avx2(__m256i v, byte_size_constant<8>) noexcept
+{
+    return v;
+}
+
+// Splits the elements of a and b into even and odd positions
+template <std::size_t S>
+TCB_SPAN_TARGET("avx2")
+void unzip_avx2(__m256i a, __m256i b, __m256i& even, __m256i& odd) noexcept
+{
+    a = unzip_lanes_avx2(a, byte_size_constant<S>{});
+    b = unzip_lanes_avx2(b, byte_size_constant<S>{});
+    even = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), 0xd8);
+    odd = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(a, b), 0xd8);
+}
+
+TCB_SPAN_TARGET("avx2")
+inline void zip_lanes_avx2(__m256i a, __m256i b, __m256i& lo, __m256i& hi,
+                           byte_size_constant<1>) noexcept
+{
+    lo = _mm256_unpacklo_epi8(a, b);
+    hi = _mm256_unpackhi_epi8(a, b);
+}
+
+TCB_SPAN_TARGET("avx2")
+inline void zip_lanes_avx2(__m256i a, __m256i b, __m256i& lo, __m256i& hi,
+                           byte_size_constant<2>) noexcept
+{
+    lo = _mm256_unpacklo_epi16(a, b);
+    hi = _mm256_unpackhi_epi16(a, b);
+}
+
+TCB_SPAN_TARGET("avx2")
+inline void zip_lanes_avx2(__m256i a, __m256i b, __m256i& lo, __m256i& hi,
+                           byte_size_constant<4>) noexcept
+{
+    lo = _mm256_unpacklo_epi32(a, b);
+    hi = _mm256_unpackhi_epi32(a, b);
+}
+
+TCB_SPAN_TARGET("avx2")
+inline void zip_lanes_avx2(__m256i a, __m256i b, __m256i& lo, __m256i& hi,
+                           byte_size_constant<8>) noexcept
+{
+    lo = _mm256_unpacklo_epi64(a, b);
+    hi = _mm256_unpackhi_epi64(a, b);
+}
+
+// Interleaves the elements of a and b, writing the first half to first and
+// the second to second
+template <std::size_t S>
+TCB_SPAN_TARGET("avx2")
+void zip_avx2(__m256i a, __m256i b, __m256i& first, __m256i& second) noexcept
+{
+    __m256i lo;
+    __m256i hi;
+    zip_lanes_avx2(a, b, lo, hi, byte_size_constant<S>{});
+    first = _mm256_permute2x128_si256(lo, hi, 0x20);
+    second = _mm256_permute2x128_si256(lo, hi, 0x31);
+}
+
+// Splits N vectors of interleaved data into one vector for each column,
+// writing column k to cols[k * stride], and joins them back again
+template <std::size_t N, std::size_t S>
+struct interleave_block_avx2 {
+    TCB_SPAN_TARGET("avx2")
+    static void split(const __m256i* v, __m256i* cols,
+                      std::size_t stride) noexcept
+    {
+        __m256i even[N / 2];
+        __m256i odd[N / 2];
+        for (std::size_t j = 0; j < N / 2; j++) {
+            unzip_avx2<S>(v[2 * j], v[2 * j + 1], even[j], odd[j]);
+        }
+        interleave_block_avx2<N / 2, S>::split(even, cols, 2 * stride);
+        interleave_block_avx2<N / 2, S>::split(odd, cols + stride,
+                                               2 * stride);
+    }
+
+    TCB_SPAN_TARGET("avx2")
+    static void join(const __m256i* cols, std::size_t stride,
+                     __m256i* v) noexcept
+    {
+        __m256i even[N / 2];
+        __m256i odd[N / 2];
+        interleave_block_avx2<N / 2, S>::join(cols, 2 * stride, even);
+        interleave_block_avx2<N / 2, S>::join(cols + stride, 2 * stride, odd);
+        for (std::size_t j = 0; j < N / 2; j++) {
+            zip_avx2<S>(even[j], odd[j], v[2 * j], v[2 * j + 1]);
+        }
+    }
+};
+
+template <std::size_t S>
+struct interleave_block_avx2<1, S> {
+    TCB_SPAN_TARGET("avx2")
+    static void split(const __m256i* v, __m256i* cols, std::size_t) noexcept
+    {
+        cols[0] = v[0];
+    }
+
+    TCB_SPAN_TARGET("avx2")
+    static void join(const __m256i* cols, std::size_t, __m256i* v) noexcept
+    {
+        v[0] = cols[0];
+    }
+};
+
+// Each kernel handles whole blocks of 32 / S rows, and returns the number
+// of rows handled
+
+template <std::size_t N, std::size_t S>
+TCB_SPAN_TARGET("avx2")
+std::size_t deinterleave_avx2(const unsigned char* in,
+                              unsigned char* const* cols, std::size_t rows,
+                              std::false_type /* three */) noexcept
+{
+    const std::size_t block = 32 / S;
+    std::size_t r = 0;
+    for (; r + block <= rows; r += block) {
+        const unsigned char* p = in + r * N * S;
+        __m256i v[N];
+        __m256i c[N];
+        for (std::size_t j = 0; j < N; j++) {
+            v[j] = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(p + 32 * j));
+        }
+        interleave_block_avx2<N, S>::split(v, c, 1);
+        for (std::size_t k = 0; k < N; k++) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(cols[k] + r * S),
+                                c[k]);
+        }
+    }
+    return r;
+}
+
+template <std::size_t N, std::size_t S>
+TCB_SPAN_TARGET("avx2")
+std::size_t interleave_avx2(const unsigned char* const* cols,
+                            unsigned char* out, std::size_t rows,
+                            std::false_type /* three */) noexcept
+{
+    const std::size_t block = 32 / S;
+    std::size_t r = 0;
+    for (; r + block <= rows; r += block) {
+        unsigned char* p = out + r * N * S;
+        __m256i c[N];
+        __m256i v[N];
+        for (std::size_t k = 0; k < N; k++) {
+            c[k] = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(cols[k] + r * S));
+        }
+        interleave_block_avx2<N, S>::join(c, 1, v);
+        for (std::size_t j = 0; j < N; j++) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(p + 32 * j), v[j]);
+        }
+    }
+    return r;
+}
+
+// Three columns don't split into pairs, so each 16-byte lane of output is
+// gathered from three lanes of input with byte shuffles. split[k][j] takes
+// the bytes of column k from the jth 16 bytes of three rows' worth of
+// interleaved data, and join[j][k] is its inverse.
+template <std::size_t S>
+struct shuffle3_table {
+    unsigned char split[3][3][16];
+    unsigned char join[3][3][16];
+
+    shuffle3_table() noexcept
+    {
+        std::memset(split, 0x80, sizeof(split));
+        std::memset(join, 0x80, sizeof(join));
+        for (unsigned p = 0; p < 48; p++) {
+            const unsigned k = p % (3 * S) / S;
+            const unsigned q = p / (3 * S) * S + p % S;
+            split[k][p / 16][q] = static_cast<unsigned char>(p % 16);
+            join[p / 16][k][p % 16] = static_cast<unsigned char>(q);
+        }
+    }
+};
+
+template <std::size_t S>
+const shuffle3_table<S>& shuffle3_tables() noexcept
+{
+    static const shuffle3_table<S> table;
+    return table;
+}
+
+TCB_SPAN_TARGET("avx2")
+inline __m256i load_shuffle_avx2(const unsigned char* control) noexcept
+{
+    return _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(control)));
+}
+
+// Loads 16 bytes from p into the low lane, and from p + 48 into the high
+TCB_SPAN_TARGET("avx2")
+inline __m256i load_lanes3_avx2(const unsigned char* p) noexcept
+{
+    return _mm256_inserti128_si256(
+        _mm256_castsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(p))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 48)), 1);
+}
+
+TCB_SPAN_TARGET("avx2")
+inline __m256i shuffle3_avx2(__m256i a, __m256i b, __m256i c,
+                             const __m256i* controls) noexcept
+{
+    return _mm256_or_si256(
+        _mm256_or_si256(_mm256_shuffle_epi8(a, controls[0]),
+                        _mm256_shuffle_epi8(b, controls[1])),
+        _mm256_shuffle_epi8(c, controls[2]));
+}
+
+template <std::size_t N, std::size_t S>
+TCB_SPAN_TARGET("avx2")
+std::size_t deinterleave_avx2(const unsigned char* in,
+                              unsigned char* const* cols, std::size_t rows,
+                              std::true_type /* three */) noexcept
+{
+    const shuffle3_table<S>& table = shuffle3_tables<S>();
+    __m256i controls[3][3];
+    for (std::size_t k = 0; k < 3; k++) {
+        for (std::size_t j = 0; j < 3; j++) {
+            controls[k][j] = load_shuffle_avx2(table.split[k][j]);
+        }
+    }
+    const std::size_t block = 32 / S;
+    std::size_t r = 0;
+    for (; r + block <= rows; r += block) {
+        const unsigned char* p = in + r * 3 * S;
+        const __m256i a = load_lanes3_avx2(p);
+        const __m256i b = load_lanes3_avx2(p + 16);
+        const __m256i c = load_lanes3_avx2(p + 32);
+        for (std::size_t k = 0; k < 3; k++) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(cols[k] + r * S),
+                                shuffle3_avx2(a, b, c, controls[k]));
+        }
+    }
+    return r;
+}
+
+template <std::size_t N, std::size_t S>
+TCB_SPAN_TARGET("avx2")
+std::size_t interleave_avx2(const unsigned char* const* cols,
+                            unsigned char* out, std::size_t rows,
+                            std::true_type /* three */) noexcept
+{
+    const shuffle3_table<S>& table = shuffle3_tables<S>();
+    __m256i controls[3][3];
+    for (std::size_t j = 0; j < 3; j++) {
+        for (std::size_t k = 0; k < 3; k++) {
+            controls[j][k] = load_shuffle_avx2(table.join[j][k]);
+        }
+    }
+    const std::size_t block = 32 / S;
+    std::size_t r = 0;
+    for (; r + block <= rows; r += block) {
+        unsigned char* p = out + r * 3 * S;
+        const __m256i a = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(cols[0] + r * S));
+        const __m256i b = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(cols[1] + r * S));
+        const __m256i c = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(cols[2] + r * S));
+        for (std::size_t j = 0; j < 3; j++) {
+            const __m256i v = shuffle3_avx2(a, b, c, controls[j]);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p + 16 * j),
+                             _mm256_castsi256_si128(v));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p + 48 + 16 * j),
+                             _mm256_extracti128_si256(v, 1));
+        }
+    }
+    return r;
+}
+
+#endif // TCB_SPAN_HAVE_X86_SIMD
+
+template <std::size_t N, typename U>
+std::size_t deinterleave_simd(const U* in, U* const* cols, std::size_t rows,
+                              std::true_type /* use SIMD */) noexcept
+{
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+    if (cpu().avx2) {
+        unsigned char* bytes[N];
+        for (std::size_t k = 0; k < N; k++) {
+            bytes[k] = reinterpret_cast<unsigned char*>(cols[k]);
+        }
+        return deinterleave_avx2<N, sizeof(U)>(
+            reinterpret_cast<const unsigned char*>(in), bytes, rows,
+            std::integral_constant<bool, N == 3>{});
+    }
+#else
+    (void) in, (void) cols, (void) rows;
+#endif
+    return 0;
+}
+
+template <std::size_t N, typename U>
+std::size_t deinterleave_simd(const U*, U* const*, std::size_t,
+                              std::false_type /* use SIMD */) noexcept
+{
+    return 0;
+}
+
+template <std::size_t N, typename U>
+std::size_t interleave_simd(const U* const* cols, U* out, std::size_t rows,
+                            std::true_type /* use SIMD */) noexcept
+{
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+    if (cpu().avx2) {
+        const unsigned char* bytes[N];
+        for (std::size_t k = 0; k < N; k++) {
+            bytes[k] = reinterpret_cast<const unsigned char*>(cols[k]);
+        }
+        return interleave_avx2<N, sizeof(U)>(
+            bytes, reinterpret_cast<unsigned char*>(out), rows,
+            std::integral_constant<bool, N == 3>{});
+    }
+#else
+    (void) cols, (void) out, (void) rows;
+#endif
+    return 0;
+}
+
+template <std::size_t N, typename U>
+std::size_t interleave_simd(const U* const*, U*, std::size_t,
+                            std::false_type /* use SIMD */) noexcept
+{
+    return 0;
+}
+
+template <std::size_t N, typename U, typename Rows>
+void deinterleave_impl(const U* in, U* const* cols, Rows rows) noexcept
+{
+    using use_simd = std::integral_constant<
+        bool, is_simd_interleavable<N, U>::value &&
+                  !is_unrolled_rows<Rows, N * sizeof(U)>::value>;
+    std::size_t r = deinterleave_simd<N>(in, cols, rows, use_simd{});
+    for (; r < rows; r++) {
+        for (std::size_t k = 0; k < N; k++) {
+            cols[k][r] = in[r * N + k];
+        }
+    }
+}
+
+template <std::size_t N, typename U, typename Rows>
+void interleave_impl(const U* const* cols, U* out, Rows rows) noexcept
+{
+    using use_simd = std::integral_constant<
+        bool, is_simd_interleavable<N, U>::value &&
+                  !is_unrolled_rows<Rows, N * sizeof(U)>::value>;
+    std::size_t r = interleave_simd<N>(cols, out, rows, use_simd{});
+    for (; r < rows; r++) {
+        for (std::size_t k = 0; k < N; k++) {
+            out[r * N + k] = cols[k][r];
+        }
+    }
+}
+
+// Takes the spans passed to interleave(), of which the last is the output
+template <typename U, std::size_t PerRow, std::size_t OutExtent,
+          typename Spans, std::size_t... Is>
+void interleave_spans(const Spans& spans, index_list<Is...>)
+{
+    const auto out = std::get<sizeof...(Is)>(spans);
+    TCB_SPAN_EXPECT(out.size() % PerRow == 0);
+    TCB_SPAN_EXPECT(
+        all_equal(out.size() / PerRow, {std::get<Is>(spans).size()...}));
+
+    const U* const cols[] = {std::get<Is>(spans).data()...};
+    interleave_impl<sizeof...(Is)>(
+        cols, reinterpret_cast<U*>(out.data()),
+        interleave_rows<OutExtent, PerRow>(
+            out.size(),
+            std::integral_constant<bool, OutExtent == dynamic_extent>{}));
+}
+
+} // namespace detail
+
+// Splits interleaved data into N separate columns, one per output span:
+// deinterleave(in, xs, ys, zs) sets xs[i] = in[3 * i], ys[i] = in[3 * i + 1]
+// and zs[i] = in[3 * i + 2]. Each output must have in.size() / N elements.
+//
+// The input may instead be a span of records each holding one row, such as
+// a struct of N values of the column type with no padding, in which case
+// each output must be the same size as the input.
+//
+// For 2, 3, 4 or 8 columns of arithmetic type, whole blocks of rows are
+// transposed with AVX2 shuffles. When the input has a static extent the
+// number of rows is a compile-time constant, and small inputs are handled
+// entirely by a loop which the compiler can unroll.
+template <typename T, std::size_t InExtent, typename... Us,
+          std::size_t... OutExtents>
+void deinterleave(span<T, InExtent> in, span<Us, OutExtents>... outs)
+{
+    constexpr std::size_t n = sizeof...(Us);
+    static_assert(n > 0, "deinterleave() requires at least one output");
+    using value_type = typename std::remove_cv<
+        typename std::tuple_element<0, std::tuple<Us...>>::type>::type;
+    static_assert(detail::leading_types_are<value_type, n, Us...>::value &&
+                      !std::is_const<typename std::tuple_element<
+                          0, std::tuple<Us...>>::type>::value,
+                  "deinterleave() requires outputs of the same mutable type");
+    static_assert(detail::is_interleaved_row<T, value_type, n>::value,
+                  "deinterleave() requires an input of the output type, or "
+                  "of records holding one row each");
+
+    constexpr std::size_t per_row =
+        detail::interleaved_per_row<T, value_type, n>::value;
+    static_assert(InExtent == dynamic_extent || InExtent % per_row == 0,
+                  "deinterleave() requires whole rows");
+    TCB_SPAN_EXPECT(in.size() % per_row == 0);
+    TCB_SPAN_EXPECT(
+        detail::all_equal(in.size() / per_row, {outs.size()...}));
+
+    value_type* const cols[] = {outs.data()...};
+    detail::deinterleave_impl<n>(
+        reinterpret_cast<const value_type*>(in.data()), cols,
+        detail::interleave_rows<InExtent, per_row>(
+            in.size(),
+            std::integral_constant<bool, InExtent == dynamic_extent>{}));
+}
+
+// The inverse of deinterleave(): interleave(xs, ys, zs, out) sets
+// out[3 * i] = xs[i], out[3 * i + 1] = ys[i] and out[3 * i + 2] = zs[i].
+// The last argument is the output, which may be a span of records as with
+// deinterleave(), and the columns must all be the same size.
+template <typename... Ts, std::size_t... Extents>
+void interleave(span<Ts, Extents>... spans)
+{
+    constexpr std::size_t n = sizeof...(Ts) - 1;
+    static_assert(sizeof...(Ts) > 1,
+                  "interleave() requires at least one input and an output");
+    using value_type = typename std::remove_cv<
+        typename std::tuple_element<0, std::tuple<Ts...>>::type>::type;
+    using out_type = typename std::tuple_element<n, std::tuple<Ts...>>::type;
+    constexpr std::size_t out_extent = std::tuple_element<
+        n, std::tuple<std::integral_constant<std::size_t, Extents>...>>::type::
+        value;
+    static_assert(detail::leading_types_are<value_type, n, Ts...>::value,
+                  "interleave() requires inputs of the same type");
+    static_assert(!std::is_const<out_type>::value,
+                  "interleave() requires a span of mutable elements");
+    static_assert(detail::is_interleaved_row<out_type, value_type, n>::value,
+                  "interleave() requires an output of the input type, or "
+                  "of records holding one row each");
+
+    constexpr std::size_t per_row =
+        detail::interleaved_per_row<out_type, value_type, n>::value;
+    static_assert(out_extent == dynamic_extent || out_extent % per_row == 0,
+                  "interleave() requires whole rows");
+    detail::interleave_spans<value_type, per_row, out_extent>(
+        std::tie(spans...), typename detail::make_index_list<n>::type{});
+}
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_INTERLEAVE_HPP_INCLUDED
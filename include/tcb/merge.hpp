@@ -0,0 +1,455 @@
+
+/*
+Stable k-way merging of sorted spans
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_MERGE_HPP_INCLUDED
+#define TCB_MERGE_HPP_INCLUDED
+
+#include "small_vector.hpp"
+#include "span_ext.hpp"
+
+#include <algorithm>
+#include <functional>
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+namespace detail {
+
+// Most merges have few enough inputs that their bookkeeping fits in-place
+constexpr std::size_t merge_inline_inputs = 16;
+
+template <typename T>
+using merge_inputs = small_vector<span<const T>, merge_inline_inputs>;
+
+template <typename T, typename U, typename Compare>
+U* merge2_scalar(const T* a, const T* ea, const T* b, const T* eb, U* out,
+                 Compare& comp)
+{
+    while (a != ea && b != eb) {
+        // Take from b only if it is strictly smaller, for stability
+        const bool take_b = comp(*b, *a);
+        *out++ = take_b ? *b : *a;
+        b += take_b;
+        a += !take_b;
+    }
+    out = std::copy(a, ea, out);
+    return std::copy(b, eb, out);
+}
+
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+
+template <bool Signed>
+struct sse41_minmax;
+
+template <>
+struct sse41_minmax<true> {
+    TCB_SPAN_TARGET("sse4.1")
+    static __m128i vmin(__m128i a, __m128i b) { return _mm_min_epi32(a, b); }
+    TCB_SPAN_TARGET("sse4.1")
+    static __m128i vmax(__m128i a, __m128i b) { return _mm_max_epi32(a, b); }
+};
+
+template <>
+struct sse41_minmax<false> {
+    TCB_SPAN_TARGET("sse4.1")
+    static __m128i vmin(__m128i a, __m128i b) { return _mm_min_epu32(a, b); }
+    TCB_SPAN_TARGET("sse4.1")
+    static __m128i vmax(__m128i a, __m128i b) { return _mm_max_epu32(a, b); }
+};
+
+// Given sorted vectors a and b, leaves the four smallest of their elements in
+// a and the four largest in b, both sorted, using a bitonic merge network
+template <typename MinMax>
+TCB_SPAN_TARGET("sse4.1")
+void bitonic_merge4(__m128i& a, __m128i& b)
+{
+    // Reversing b makes (a, b) bitonic; compare at distance 4, 2, then 1
+    b = _mm_shuffle_epi32(b, _MM_SHUFFLE(0, 1, 2, 3));
+    __m128i lo = MinMax::vmin(a, b);
+    __m128i hi = MinMax::vmax(a, b);
+
+    const __m128i t1 = _mm_unpacklo_epi64(lo, hi);
+    const __m128i t2 = _mm_unpackhi_epi64(lo, hi);
+    lo = MinMax::vmin(t1, t2);
+    hi = MinMax::vmax(t1, t2);
+
+    const __m128 flo = _mm_castsi128_ps(lo);
+    const __m128 fhi = _mm_castsi128_ps(hi);
+    const __m128i u =
+        _mm_castps_si128(_mm_shuffle_ps(flo, fhi, _MM_SHUFFLE(2, 0, 2, 0)));
+    const __m128i v =
+        _mm_castps_si128(_mm_shuffle_ps(flo, fhi, _MM_SHUFFLE(3, 1, 3, 1)));
+    lo = MinMax::vmin(u, v);
+    hi = MinMax::vmax(u, v);
+
+    const __m128i x = _mm_unpacklo_epi32(lo, hi);
+    const __m128i y = _mm_unpackhi_epi32(lo, hi);
+    a = _mm_unpacklo_epi64(x, y);
+    b = _mm_unpackhi_epi64(x, y);
+}
+
+// Merges blocks of four 32-bit integers while both inputs have a block
+// remaining, then finishes with scalar code. Equal integers are
+// indistinguishable, so the network's lack of stability doesn't matter.
+template <typename T>
+TCB_SPAN_TARGET("sse4.1")
+T* merge2_sse41(const T* a, const T* ea, const T* b, const T* eb, T* out)
+{
+    using minmax = sse41_minmax<std::is_signed<T>::value>;
+    std::less<T> comp;
+    if (ea - a < 4 || eb - b < 4) {
+        return merge2_scalar(a, ea, b, eb, out, comp);
+    }
+
+    __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+    a += 4;
+    b += 4;
+    for (;;) {
+        bitonic_merge4<minmax>(va, vb);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), va);
+        out += 4;
+
+        // The next block comes from whichever input has the smaller head
+        const bool take_a = b == eb || (a != ea && *a < *b);
+        const T*& next = take_a ? a : b;
+        if ((take_a ? ea : eb) - next < 4) {
+            break;
+        }
+        va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(next));
+        next += 4;
+    }
+
+    // Merge the four elements still in vb with what remains of the inputs
+    T held[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(held), vb);
+    const T* h = held;
+    while (h != held + 4) {
+        if (a != ea && *a < *h && (b == eb || !(*b < *a))) {
+            *out++ = *a++;
+        } else if (b != eb && *b < *h) {
+            *out++ = *b++;
+        } else {
+            *out++ = *h++;
+        }
+    }
+    return merge2_scalar(a, ea, b, eb, out, comp);
+}
+
+#endif // TCB_SPAN_HAVE_X86_SIMD
+
+template <typename T>
+T* merge2_simd(const T* a, const T* ea, const T* b, const T* eb, T* out,
+               std::less<T>& comp, std::true_type)
+{
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+    if (cpu().sse41) {
+        return merge2_sse41(a, ea, b, eb, out);
+    }
+#endif
+    return merge2_scalar(a, ea, b, eb, out, comp);
+}
+
+template <typename T, typename U, typename Compare>
+U* merge2_simd(const T* a, const T* ea, const T* b, const T* eb, U* out,
+               Compare& comp, std::false_type)
+{
+    return merge2_scalar(a, ea, b, eb, out, comp);
+}
+
+template <typename T, typename U, typename Compare>
+struct is_simd_mergeable {
+    static constexpr bool value =
+        std::is_same<T, U>::value &&
+        (std::is_same<T, std::int32_t>::value ||
+         std::is_same<T, std::uint32_t>::value) &&
+        std::is_same<Compare, std::less<T>>::value;
+};
+
+// A tournament tree over k inputs. Each internal node holds the index of the
+// input which lost the match played there, and node 0 holds the overall
+// winner; replacing the winner's head replays only the matches on its path
+// to the root. Nodes are stored as a compact implicit heap, with input i at
+// leaf k + i, so the whole tree usually occupies a few cache lines.
+template <typename T, typename Compare>
+class loser_tree {
+public:
+    loser_tree(const span<const T>* inputs, std::size_t k, Compare& comp)
+        : k_(k), comp_(comp)
+    {
+        for (std::size_t i = 0; i < k; i++) {
+            heads_.push_back(inputs[i].data());
+            ends_.push_back(inputs[i].data() + inputs[i].size());
+        }
+        tree_.resize(k);
+        tree_[0] = play(1);
+    }
+
+    const T& top() const { return *heads_[tree_[0]]; }
+
+    void pop()
+    {
+        std::size_t winner = tree_[0];
+        ++heads_[winner];
+        for (std::size_t node = (winner + k_) / 2; node > 0; node /= 2) {
+            if (beats(tree_[node], winner)) {
+                std::swap(tree_[node], winner);
+            }
+        }
+        tree_[0] = winner;
+    }
+
+private:
+    // Exhausted inputs lose to everything; ties go to the earlier input
+    bool beats(std::size_t a, std::size_t b) const
+    {
+        if (heads_[b] == ends_[b]) {
+            return true;
+        }
+        if (heads_[a] == ends_[a]) {
+            return false;
+        }
+        if (comp_(*heads_[b], *heads_[a])) {
+            return false;
+        }
+        return a < b || comp_(*heads_[a], *heads_[b]);
+    }
+
+    std::size_t play(std::size_t node)
+    {
+        if (node >= k_) {
+            return node - k_;
+        }
+        const std::size_t left = play(2 * node);
+        const std::size_t right = play(2 * node + 1);
+        if (beats(left, right)) {
+            tree_[node] = right;
+            return left;
+        }
+        tree_[node] = left;
+        return right;
+    }
+
+    std::size_t k_;
+    Compare& comp_;
+    small_vector<const T*, merge_inline_inputs> heads_;
+    small_vector<const T*, merge_inline_inputs> ends_;
+    small_vector<std::size_t, merge_inline_inputs> tree_;
+};
+
+template <typename T, typename U, typename Compare>
+void merge_impl(const span<const T>* inputs, std::size_t k, U* out,
+                Compare& comp)
+{
+    // Drop empty inputs, keeping the rest in order so the merge is stable
+    merge_inputs<T> nonempty;
+    for (std::size_t i = 0; i < k; i++) {
+        if (!inputs[i].empty()) {
+            nonempty.push_back(inputs[i]);
+        }
+    }
+
+    switch (nonempty.size()) {
+    case 0:
+        return;
+    case 1:
+        std::copy(nonempty[0].begin(), nonempty[0].end(), out);
+        return;
+    case 2:
+        merge2_simd(nonempty[0].data(),
+                    nonempty[0].data() + nonempty[0].size(),
+                    nonempty[1].data(),
+                    nonempty[1].data() + nonempty[1].size(), out, comp,
+                    std::integral_constant<
+                        bool, is_simd_mergeable<T, U, Compare>::value>{});
+        return;
+    default:
+        break;
+    }
+
+    std::size_t total = 0;
+    for (const span<const T>& s : nonempty) {
+        total += s.size();
+    }
+    loser_tree<T, Compare> tree(nonempty.data(), nonempty.size(), comp);
+    for (std::size_t n = 0; n < total; n++) {
+        out[n] = tree.top();
+        tree.pop();
+    }
+}
+
+// Finds how many elements of each input come before position rank of the
+// merged output, writing them to splits. Elements are ordered by value, then
+// input index, then position, as in the stable merge. Each round compares a
+// pivot from the largest undecided range against every input, halving that
+// range.
+template <typename T, typename Compare>
+void merge_split(const span<const T>* inputs, std::size_t k, std::size_t rank,
+                 std::size_t* splits, Compare& comp)
+{
+    small_vector<std::size_t, merge_inline_inputs> lo(k, 0);
+    small_vector<std::size_t, merge_inline_inputs> hi(k);
+    small_vector<std::size_t, merge_inline_inputs> pos(k);
+    for (std::size_t i = 0; i < k; i++) {
+        hi[i] = inputs[i].size();
+    }
+
+    for (;;) {
+        std::size_t p = k;
+        std::size_t widest = 0;
+        for (std::size_t i = 0; i < k; i++) {
+            if (hi[i] - lo[i] > widest) {
+                widest = hi[i] - lo[i];
+                p = i;
+            }
+        }
+        if (p == k) {
+            break;
+        }
+
+        // Count the elements ordered before the pivot, within each input's
+        // undecided range
+        const std::size_t mid = lo[p] + widest / 2;
+        const T& pivot = inputs[p][mid];
+        std::size_t before = 0;
+        for (std::size_t i = 0; i < k; i++) {
+            const T* first = inputs[i].data() + lo[i];
+            const T* last = inputs[i].data() + hi[i];
+            const T* it = i < p ? std::upper_bound(first, last, pivot, comp)
+                                : i > p ? std::lower_bound(first, last, pivot,
+                                                           comp)
+                                        : inputs[i].data() + mid;
+            pos[i] = static_cast<std::size_t>(it - inputs[i].data());
+            before += pos[i];
+        }
+
+        if (before < rank) {
+            // The pivot and everything before it come before the split
+            for (std::size_t i = 0; i < k; i++) {
+                lo[i] = pos[i];
+            }
+            lo[p] = mid + 1;
+        } else {
+            for (std::size_t i = 0; i < k; i++) {
+                hi[i] = pos[i];
+            }
+        }
+    }
+    std::copy(lo.begin(), lo.end(), splits);
+}
+
+template <typename Spans, typename U>
+struct check_merge_inputs {
+    using input_type = typename std::remove_cv<Spans>::type;
+    static constexpr bool value =
+        std::is_same<input_type,
+                     span<const U, input_type::extent>>::value ||
+        std::is_same<input_type, span<U, input_type::extent>>::value;
+};
+
+// The fewest output elements per thread. Each part starts with a
+// multi-sequence binary search over all k inputs, which only pays off when
+// the part itself takes much longer to merge.
+constexpr std::size_t merge_parallel_chunk = std::size_t{1} << 16;
+
+} // namespace detail
+
+// Merges the sorted spans in inputs into out, which must be large enough to
+// hold all of their elements, and returns the filled part of out. The merge
+// is stable: equivalent elements keep their order within each input, and
+// those from earlier inputs come first.
+//
+// Two inputs are merged directly (with SSE4.1 merge networks for 32-bit
+// integers compared with std::less), and more with a loser tree.
+template <typename Spans, std::size_t InputsExtent, typename U,
+          std::size_t OutExtent, typename Compare = std::less<U>>
+span<U> merge_sorted(span<Spans, InputsExtent> inputs, span<U, OutExtent> out,
+                     Compare comp = Compare())
+{
+    static_assert(detail::check_merge_inputs<Spans, U>::value,
+                  "merge_sorted() requires a span of spans of the output "
+                  "element type");
+    detail::merge_inputs<U> in;
+    std::size_t total = 0;
+    for (const auto& s : inputs) {
+        in.push_back(s);
+        total += s.size();
+        TCB_SPAN_EXPECT(std::is_sorted(s.begin(), s.end(), comp));
+    }
+    TCB_SPAN_EXPECT(total <= out.size());
+    detail::merge_impl(in.data(), in.size(), out.data(), comp);
+    return out.first(total);
+}
+
+// As merge_sorted(), but divides the output into equal parts which are merged
+// concurrently, using up to the given number of threads. The inputs are
+// split between parts by a multi-way binary search.
+template <typename Spans, std::size_t InputsExtent, typename U,
+          std::size_t OutExtent, typename Compare = std::less<U>>
+span<U> merge_sorted_parallel(
+    span<Spans, InputsExtent> inputs, span<U, OutExtent> out,
+    unsigned threads = std::thread::hardware_concurrency(),
+    Compare comp = Compare())
+{
+    static_assert(detail::check_merge_inputs<Spans, U>::value,
+                  "merge_sorted_parallel() requires a span of spans of the "
+                  "output element type");
+    detail::merge_inputs<U> in;
+    std::size_t total = 0;
+    for (const auto& s : inputs) {
+        in.push_back(s);
+        total += s.size();
+        TCB_SPAN_EXPECT(std::is_sorted(s.begin(), s.end(), comp));
+    }
+    TCB_SPAN_EXPECT(total <= out.size());
+
+    const std::size_t k = in.size();
+    const std::size_t max_threads = total / detail::merge_parallel_chunk;
+    if (threads > max_threads) {
+        threads = static_cast<unsigned>(max_threads);
+    }
+    if (threads <= 1) {
+        detail::merge_impl(in.data(), k, out.data(), comp);
+        return out.first(total);
+    }
+
+    // Row t holds the split points at the start of part t
+    std::vector<std::size_t> splits((threads + 1) * k);
+    for (std::size_t i = 0; i < k; i++) {
+        splits[threads * k + i] = in[i].size();
+    }
+    const auto part_begin = [total, threads](unsigned t) {
+        return static_cast<std::size_t>(
+            static_cast<unsigned long long>(total) * t / threads);
+    };
+
+    detail::run_concurrently(threads, [&](unsigned t) {
+        if (t > 0) {
+            Compare part_comp = comp;
+            detail::merge_split(in.data(), k, part_begin(t),
+                                splits.data() + t * k, part_comp);
+        }
+    });
+
+    detail::run_concurrently(threads, [&](unsigned t) {
+        const std::size_t* first = splits.data() + t * k;
+        const std::size_t* last = first + k;
+        detail::merge_inputs<U> parts;
+        for (std::size_t i = 0; i < k; i++) {
+            parts.push_back(in[i].subspan(first[i], last[i] - first[i]));
+        }
+        Compare part_comp = comp;
+        detail::merge_impl(parts.data(), k, out.data() + part_begin(t),
+                           part_comp);
+    });
+    return out.first(total);
+}
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_MERGE_HPP_INCLUDED
@@ -0,0 +1,315 @@
+
+/*
+A view of a span of 64-bit words as an array of fixed-width packed integers
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_PACKED_SPAN_HPP_INCLUDED
+#define TCB_PACKED_SPAN_HPP_INCLUDED
+
+#include "span_ext.hpp"
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+namespace detail {
+
+template <unsigned Bits>
+constexpr std::uint64_t packed_mask() noexcept
+{
+    return (std::uint64_t{1} << Bits) - 1;
+}
+
+// Value i occupies bits [i * Bits, (i + 1) * Bits) of the little-endian
+// bitstream formed by the words, so may straddle two of them
+template <unsigned Bits>
+std::uint32_t packed_get(const std::uint64_t* words, std::size_t i) noexcept
+{
+    const std::size_t bit = i * Bits;
+    const std::uint64_t* w = words + bit / 64;
+    const unsigned offset = static_cast<unsigned>(bit % 64);
+    std::uint64_t v = w[0] >> offset;
+    if (offset + Bits > 64) {
+        v |= w[1] << (64 - offset);
+    }
+    return static_cast<std::uint32_t>(v & packed_mask<Bits>());
+}
+
+template <unsigned Bits>
+void packed_set(std::uint64_t* words, std::size_t i,
+                std::uint32_t v) noexcept
+{
+    const std::size_t bit = i * Bits;
+    std::uint64_t* w = words + bit / 64;
+    const unsigned offset = static_cast<unsigned>(bit % 64);
+    const std::uint64_t value = v & packed_mask<Bits>();
+    w[0] = (w[0] & ~(packed_mask<Bits>() << offset)) | (value << offset);
+    if (offset + Bits > 64) {
+        const unsigned written = 64 - offset;
+        w[1] = (w[1] & ~(packed_mask<Bits>() >> written)) |
+               (value >> written);
+    }
+}
+
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+
+// Unpacks groups of eight values, which together occupy exactly Bits bytes.
+// The bytes of the first four and last four values are loaded into the two
+// halves of a register; each lane then gathers the four bytes containing its
+// value with a byte shuffle, and shifts and masks it into place. This needs
+// every value (plus its bit offset within a byte) to fit in 32 bits.
+template <unsigned Bits>
+TCB_SPAN_TARGET("avx2")
+std::size_t unpack_avx2(const std::uint64_t* words, std::size_t num_words,
+                        std::size_t count, std::uint32_t* out)
+{
+    static_assert(Bits <= 25, "Values must fit in four bytes");
+    constexpr std::size_t high_half = 4 * Bits / 8;
+
+    alignas(32) std::int8_t control[32];
+    alignas(32) std::int32_t shifts[8];
+    for (unsigned j = 0; j < 8; j++) {
+        const unsigned bit = j * Bits - (j < 4 ? 0 : 8 * high_half);
+        for (unsigned b = 0; b < 4; b++) {
+            control[4 * j + b] = static_cast<std::int8_t>(bit / 8 + b);
+        }
+        shifts[j] = static_cast<std::int32_t>(bit % 8);
+    }
+    const __m256i vcontrol =
+        _mm256_load_si256(reinterpret_cast<const __m256i*>(control));
+    const __m256i vshifts =
+        _mm256_load_si256(reinterpret_cast<const __m256i*>(shifts));
+    const __m256i vmask =
+        _mm256_set1_epi32(static_cast<int>(packed_mask<Bits>()));
+
+    const unsigned char* bytes =
+        reinterpret_cast<const unsigned char*>(words);
+    const std::size_t num_bytes = 8 * num_words;
+    std::size_t i = 0;
+    // Both loads must stay within the words
+    for (; i + 8 <= count && (i / 8) * Bits + high_half + 16 <= num_bytes;
+         i += 8) {
+        const unsigned char* p = bytes + (i / 8) * Bits;
+        const __m128i lo =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i hi =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + high_half));
+        __m256i v =
+            _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        v = _mm256_shuffle_epi8(v, vcontrol);
+        v = _mm256_and_si256(_mm256_srlv_epi32(v, vshifts), vmask);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), v);
+    }
+    return i;
+}
+
+#endif // TCB_SPAN_HAVE_X86_SIMD
+
+template <unsigned Bits>
+std::size_t unpack_simd(const std::uint64_t* words, std::size_t num_words,
+                        std::size_t count, std::uint32_t* out, std::true_type)
+{
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+    // The shuffles assume the words are stored little-endian, as on x86
+    if (cpu().avx2) {
+        return unpack_avx2<Bits>(words, num_words, count, out);
+    }
+#else
+    (void) words, (void) num_words, (void) count, (void) out;
+#endif
+    return 0;
+}
+
+template <unsigned Bits>
+std::size_t unpack_simd(const std::uint64_t*, std::size_t, std::size_t,
+                        std::uint32_t*, std::false_type)
+{
+    return 0;
+}
+
+} // namespace detail
+
+// A view of the first size * Bits bits of a span of 64-bit words as size
+// unsigned integers of Bits bits each, packed without padding. Values are
+// read and written through get() and set(), or through operator[], which
+// returns a proxy reference when Word is non-const.
+//
+// As with span, constness of the elements is expressed through the Word
+// parameter: a packed_span<Bits, const std::uint64_t> is read-only.
+template <unsigned Bits, typename Word = std::uint64_t>
+class packed_span {
+    static_assert(Bits >= 1 && Bits <= 32,
+                  "packed_span supports widths of 1 to 32 bits");
+    static_assert(std::is_same<typename std::remove_cv<Word>::type,
+                               std::uint64_t>::value,
+                  "packed_span requires 64-bit words");
+
+public:
+    using word_type = Word;
+    using value_type = std::uint32_t;
+    using size_type = std::size_t;
+
+    static constexpr unsigned bits = Bits;
+    static constexpr value_type max_value =
+        static_cast<value_type>(detail::packed_mask<Bits>());
+
+    // A proxy for a single packed value
+    class reference {
+    public:
+        reference(const reference&) = default;
+
+        reference& operator=(value_type v)
+        {
+            detail::packed_set<Bits>(words_, index_, v);
+            return *this;
+        }
+
+        reference& operator=(const reference& other)
+        {
+            return *this = static_cast<value_type>(other);
+        }
+
+        operator value_type() const
+        {
+            return detail::packed_get<Bits>(words_, index_);
+        }
+
+    private:
+        friend class packed_span;
+
+        reference(Word* words, size_type index)
+            : words_(words), index_(index)
+        {}
+
+        Word* words_;
+        size_type index_;
+    };
+
+    // The number of words needed to hold count values
+    static constexpr size_type words_needed(size_type count) noexcept
+    {
+        return (count * Bits + 63) / 64;
+    }
+
+    constexpr packed_span() noexcept = default;
+
+    packed_span(span<Word> words, size_type count)
+        : words_(words), size_(count)
+    {
+        TCB_SPAN_EXPECT(words_needed(count) <= words.size());
+    }
+
+    template <typename OtherWord,
+              typename std::enable_if<
+                  std::is_convertible<OtherWord (*)[], Word (*)[]>::value,
+                  int>::type = 0>
+    packed_span(const packed_span<Bits, OtherWord>& other) noexcept
+        : words_(other.words()), size_(other.size())
+    {}
+
+    // observers
+    span<Word> words() const noexcept { return words_; }
+    size_type size() const noexcept { return size_; }
+    TCB_SPAN_NODISCARD bool empty() const noexcept { return size_ == 0; }
+
+    // element access
+    value_type get(size_type idx) const
+    {
+        TCB_SPAN_EXPECT(idx < size_);
+        return detail::packed_get<Bits>(words_.data(), idx);
+    }
+
+    void set(size_type idx, value_type value) const
+    {
+        static_assert(!std::is_const<Word>::value,
+                      "Cannot modify a packed_span of const words");
+        TCB_SPAN_EXPECT(idx < size_ && value <= max_value);
+        detail::packed_set<Bits>(words_.data(), idx, value);
+    }
+
+    typename std::conditional<std::is_const<Word>::value, value_type,
+                              reference>::type
+    operator[](size_type idx) const
+    {
+        TCB_SPAN_EXPECT(idx < size_);
+        return access(idx, std::is_const<Word>{});
+    }
+
+    // The first count values, sharing the same words
+    packed_span first(size_type count) const
+    {
+        TCB_SPAN_EXPECT(count <= size_);
+        return packed_span(words_, count);
+    }
+
+private:
+    value_type access(size_type idx, std::true_type) const
+    {
+        return detail::packed_get<Bits>(words_.data(), idx);
+    }
+
+    reference access(size_type idx, std::false_type) const
+    {
+        return reference(words_.data(), idx);
+    }
+
+    span<Word> words_{};
+    size_type size_ = 0;
+};
+
+// Unpacks every value of in into out, which must be at least as large, and
+// returns the written part of out. Widths of up to 25 bits are unpacked
+// eight at a time with AVX2 where available.
+template <unsigned Bits, typename Word, std::size_t OutExtent>
+span<std::uint32_t> unpack(packed_span<Bits, Word> in,
+                           span<std::uint32_t, OutExtent> out)
+{
+    TCB_SPAN_EXPECT(in.size() <= out.size());
+    const std::uint64_t* words = in.words().data();
+    std::size_t i = detail::unpack_simd<Bits>(
+        words, in.words().size(), in.size(), out.data(),
+        std::integral_constant<bool, (Bits <= 25)>{});
+    for (; i < in.size(); i++) {
+        out[i] = detail::packed_get<Bits>(words, i);
+    }
+    return out.first(in.size());
+}
+
+// Packs the values of in into the start of out, which must be at least as
+// large, and returns the written part of out. Each value must fit in Bits
+// bits. Values of out beyond in.size() are left unchanged.
+template <typename T, std::size_t InExtent, unsigned Bits>
+packed_span<Bits> pack(span<T, InExtent> in, packed_span<Bits> out)
+{
+    static_assert(
+        std::is_same<typename std::remove_cv<T>::type, std::uint32_t>::value,
+        "pack() requires a span of std::uint32_t");
+    TCB_SPAN_EXPECT(in.size() <= out.size());
+
+    // Accumulate whole words, rather than masking values into memory
+    std::uint64_t* words = out.words().data();
+    std::uint64_t acc = 0;
+    unsigned fill = 0;
+    for (std::size_t i = 0; i < in.size(); i++) {
+        const std::uint64_t v = in[i];
+        TCB_SPAN_EXPECT((v >> Bits) == 0);
+        acc |= v << fill;
+        fill += Bits;
+        if (fill >= 64) {
+            *words++ = acc;
+            fill -= 64;
+            acc = fill > 0 ? v >> (Bits - fill) : 0;
+        }
+    }
+    if (fill > 0) {
+        const std::uint64_t keep = ~((std::uint64_t{1} << fill) - 1);
+        *words = (*words & keep) | acc;
+    }
+    return out.first(in.size());
+}
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_PACKED_SPAN_HPP_INCLUDED
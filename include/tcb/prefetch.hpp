@@ -0,0 +1,148 @@
+
+/*
+Software prefetching helpers for traversing spans
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_PREFETCH_HPP_INCLUDED
+#define TCB_PREFETCH_HPP_INCLUDED
+
+#include "span_ext.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#ifndef TCB_SPAN_CACHE_LINE_SIZE
+#define TCB_SPAN_CACHE_LINE_SIZE 64
+#endif
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+
+TCB_SPAN_INLINE_VAR constexpr std::size_t cache_line_size =
+    TCB_SPAN_CACHE_LINE_SIZE;
+
+// How long prefetched data should be kept in the cache, from "will be used
+// once" (none) to "will be reused soon" (high). This corresponds to the
+// locality argument of __builtin_prefetch().
+enum class prefetch_locality { none = 0, low = 1, moderate = 2, high = 3 };
+
+// The default number of cache lines that for_each_prefetch() fetches ahead of
+// the current element. Less work is done per cache line for larger elements,
+// so we need to look further ahead to cover the memory latency.
+template <typename T>
+constexpr std::size_t default_prefetch_distance() noexcept
+{
+    return sizeof(T) <= 16 ? 4 : sizeof(T) <= 64 ? 8 : 16;
+}
+
+namespace detail {
+
+template <int Write, int Locality>
+inline void prefetch_line(std::uintptr_t addr) noexcept
+{
+    const void* p = reinterpret_cast<const void*>(addr);
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(p, Write, Locality);
+#elif defined(TCB_SPAN_HAVE_SSE2)
+    _mm_prefetch(static_cast<const char*>(p),
+                 Locality == 3 ? _MM_HINT_T0
+                               : Locality == 2 ? _MM_HINT_T1
+                                               : Locality == 1 ? _MM_HINT_T2
+                                                               : _MM_HINT_NTA);
+#else
+    (void) p;
+#endif
+}
+
+inline std::uintptr_t cache_line_of(std::uintptr_t addr) noexcept
+{
+    return addr & ~static_cast<std::uintptr_t>(cache_line_size - 1);
+}
+
+template <int Write, int Locality>
+void prefetch_bytes(const void* p, std::size_t n) noexcept
+{
+    if (n == 0) {
+        return;
+    }
+    const std::uintptr_t first = reinterpret_cast<std::uintptr_t>(p);
+    const std::uintptr_t last = first + (n - 1);
+    for (std::uintptr_t line = cache_line_of(first); line <= last;
+         line += cache_line_size) {
+        prefetch_line<Write, Locality>(line);
+    }
+}
+
+// Calls f on each element of [first, first + n), prefetching distance bytes
+// ahead of the element being visited. Each cache line is prefetched once.
+template <int Write, typename T, typename F>
+F for_each_prefetch_impl(T* first, std::size_t n, std::size_t distance, F f)
+{
+    const std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(first);
+    const std::uintptr_t end = begin + n * sizeof(T);
+    std::uintptr_t next_line = cache_line_of(begin);
+
+    for (std::size_t i = 0; i < n; i++) {
+        const std::uintptr_t want =
+            (std::min)(begin + (i + 1) * sizeof(T) + distance, end);
+        while (next_line < want) {
+            prefetch_line<Write, 3>(next_line);
+            next_line += cache_line_size;
+        }
+        f(first[i]);
+    }
+    return f;
+}
+
+} // namespace detail
+
+// Hints to the CPU that the contents of s will be used soon. Each cache line
+// spanned by s is prefetched once; this never faults, even if the memory is
+// not readable.
+template <typename ElementType, std::size_t Extent>
+void prefetch(span<ElementType, Extent> s,
+              prefetch_locality locality = prefetch_locality::high) noexcept
+{
+    const void* p = s.data();
+    const std::size_t n = s.size_bytes();
+    switch (locality) {
+    case prefetch_locality::none:
+        detail::prefetch_bytes<0, 0>(p, n);
+        break;
+    case prefetch_locality::low:
+        detail::prefetch_bytes<0, 1>(p, n);
+        break;
+    case prefetch_locality::moderate:
+        detail::prefetch_bytes<0, 2>(p, n);
+        break;
+    case prefetch_locality::high:
+        detail::prefetch_bytes<0, 3>(p, n);
+        break;
+    }
+}
+
+// Equivalent to std::for_each(s.begin(), s.end(), f), but issues software
+// prefetches distance cache lines ahead of the current element. When the
+// elements are mutable they are prefetched for writing.
+template <typename ElementType, std::size_t Extent, typename F>
+F for_each_prefetch(span<ElementType, Extent> s, std::size_t distance, F f)
+{
+    constexpr int write = std::is_const<ElementType>::value ? 0 : 1;
+    return detail::for_each_prefetch_impl<write>(
+        s.data(), s.size(), distance * cache_line_size, std::move(f));
+}
+
+template <typename ElementType, std::size_t Extent, typename F>
+F for_each_prefetch(span<ElementType, Extent> s, F f)
+{
+    return for_each_prefetch(
+        s, default_prefetch_distance<ElementType>(), std::move(f));
+}
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_PREFETCH_HPP_INCLUDED
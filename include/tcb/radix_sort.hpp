@@ -0,0 +1,359 @@
+
+/*
+LSD radix sorting of spans of integers and floating-point values, optionally
+carrying a parallel span of values, using caller-provided scratch space
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_RADIX_SORT_HPP_INCLUDED
+#define TCB_RADIX_SORT_HPP_INCLUDED
+
+#include "span_ext.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+namespace detail {
+
+// Maps an arithmetic type to an unsigned key with the same ordering
+template <typename T, typename = void>
+struct radix_traits;
+
+template <std::size_t Size>
+struct radix_key_type;
+template <>
+struct radix_key_type<1> { using type = std::uint8_t; };
+template <>
+struct radix_key_type<2> { using type = std::uint16_t; };
+template <>
+struct radix_key_type<4> { using type = std::uint32_t; };
+template <>
+struct radix_key_type<8> { using type = std::uint64_t; };
+
+template <typename T>
+struct radix_traits<
+    T, typename std::enable_if<std::is_integral<T>::value>::type> {
+    using key_type = typename radix_key_type<sizeof(T)>::type;
+
+    static key_type to_key(T t) noexcept
+    {
+        // Flip the sign bit, so that negative values come first
+        constexpr key_type sign =
+            std::is_signed<T>::value
+                ? static_cast<key_type>(key_type{1} << (8 * sizeof(T) - 1))
+                : 0;
+        return static_cast<key_type>(static_cast<key_type>(t) ^ sign);
+    }
+};
+
+// Negative floating-point values have all their bits flipped (reversing their
+// order), and positive ones just the sign bit. -0.0 sorts before +0.0, and
+// NaNs sort to the ends according to their sign bits.
+template <typename T>
+struct radix_traits<
+    T, typename std::enable_if<std::is_floating_point<T>::value &&
+                               std::numeric_limits<T>::is_iec559>::type> {
+    using key_type = typename radix_key_type<sizeof(T)>::type;
+
+    static key_type to_key(T t) noexcept
+    {
+        constexpr key_type sign = key_type{1} << (8 * sizeof(T) - 1);
+        key_type k;
+        std::memcpy(&k, &t, sizeof(T));
+        return (k & sign) ? static_cast<key_type>(~k) : (k | sign);
+    }
+};
+
+template <typename T>
+unsigned radix_digit(const T& t, unsigned pass) noexcept
+{
+    return static_cast<unsigned>(radix_traits<T>::to_key(t) >> (8 * pass)) &
+           0xff;
+}
+
+using radix_histogram = std::size_t[256];
+
+// The key-only sorts use a null pointer of this type for their values
+struct radix_no_values {};
+
+template <typename V>
+void radix_move_value(V* dst, std::size_t j, V* src, std::size_t i)
+{
+    dst[j] = std::move(src[i]);
+}
+
+inline void radix_move_value(radix_no_values*, std::size_t, radix_no_values*,
+                             std::size_t)
+{}
+
+template <typename T, typename V>
+void radix_move_back(T* data, T* scratch, V* values, V* value_scratch,
+                     std::size_t n)
+{
+    for (std::size_t i = 0; i < n; i++) {
+        data[i] = scratch[i];
+        radix_move_value(values, i, value_scratch, i);
+    }
+}
+
+// Below this size, a (stable) insertion sort is faster than counting
+constexpr std::size_t radix_sort_threshold = 64;
+
+template <typename V>
+void radix_swap_value(V* values, std::size_t i, std::size_t j)
+{
+    using std::swap;
+    swap(values[i], values[j]);
+}
+
+inline void radix_swap_value(radix_no_values*, std::size_t, std::size_t) {}
+
+template <typename T, typename V>
+void radix_insertion_sort(T* keys, V* values, std::size_t n)
+{
+    using traits = radix_traits<T>;
+    for (std::size_t i = 1; i < n; i++) {
+        const auto key = traits::to_key(keys[i]);
+        for (std::size_t j = i; j > 0 && key < traits::to_key(keys[j - 1]);
+             j--) {
+            std::swap(keys[j], keys[j - 1]);
+            radix_swap_value(values, j, j - 1);
+        }
+    }
+}
+
+// Scatters src[first, last) into dst by the digit for pass, using (and
+// advancing) the given bucket offsets
+template <typename T, typename V>
+void radix_scatter(const T* src, T* dst, V* vsrc, V* vdst, std::size_t first,
+                   std::size_t last, unsigned pass, std::size_t* offsets)
+{
+    for (std::size_t i = first; i < last; i++) {
+        const std::size_t j = offsets[radix_digit(src[i], pass)]++;
+        dst[j] = src[i];
+        radix_move_value(vdst, j, vsrc, i);
+    }
+}
+
+// Converts counts into starting offsets, returning false if every element
+// falls into the same bucket (in which case the pass can be skipped)
+inline bool radix_prefix_sum(std::size_t* counts, std::size_t n)
+{
+    std::size_t sum = 0;
+    for (unsigned d = 0; d < 256; d++) {
+        if (counts[d] == n) {
+            return false;
+        }
+        const std::size_t c = counts[d];
+        counts[d] = sum;
+        sum += c;
+    }
+    return true;
+}
+
+template <typename T, typename V>
+void radix_sort_impl(T* data, T* scratch, V* values, V* value_scratch,
+                     std::size_t n)
+{
+    if (n < radix_sort_threshold) {
+        radix_insertion_sort(data, values, n);
+        return;
+    }
+
+    constexpr unsigned passes = sizeof(T);
+
+    // The counts for every digit can be found in a single read of the data
+    radix_histogram counts[passes] = {};
+    for (std::size_t i = 0; i < n; i++) {
+        const auto key = radix_traits<T>::to_key(data[i]);
+        for (unsigned p = 0; p < passes; p++) {
+            ++counts[p][static_cast<unsigned>(key >> (8 * p)) & 0xff];
+        }
+    }
+
+    T* src = data;
+    T* dst = scratch;
+    V* vsrc = values;
+    V* vdst = value_scratch;
+    for (unsigned p = 0; p < passes; p++) {
+        if (!radix_prefix_sum(counts[p], n)) {
+            continue;
+        }
+        radix_scatter(src, dst, vsrc, vdst, 0, n, p, counts[p]);
+        std::swap(src, dst);
+        std::swap(vsrc, vdst);
+    }
+
+    if (src != data) {
+        radix_move_back(data, scratch, values, value_scratch, n);
+    }
+}
+
+// The fewest elements per thread. Every pass has each thread clear and
+// count a 256-entry histogram, then wait for the others before
+// scattering, so a thread's share must be large enough to amortize that.
+constexpr std::size_t radix_parallel_chunk = std::size_t{1} << 16;
+
+// Each pass counts digits in one chunk per thread, then has every thread
+// scatter its chunk into the ranges of the output it owns. Using the same
+// chunk boundaries for both phases keeps the sort stable.
+template <typename T, typename V>
+void radix_sort_parallel_impl(T* data, T* scratch, V* values,
+                              V* value_scratch, std::size_t n,
+                              unsigned threads)
+{
+    const std::size_t max_threads = n / radix_parallel_chunk;
+    if (threads > max_threads) {
+        threads = static_cast<unsigned>(max_threads);
+    }
+    if (threads <= 1) {
+        radix_sort_impl(data, scratch, values, value_scratch, n);
+        return;
+    }
+
+    struct chunk_counts {
+        radix_histogram counts;
+    };
+    std::vector<chunk_counts> chunks(threads);
+    const auto chunk_begin = [n, threads](unsigned c) {
+        return static_cast<std::size_t>(
+            static_cast<unsigned long long>(n) * c / threads);
+    };
+
+    T* src = data;
+    T* dst = scratch;
+    V* vsrc = values;
+    V* vdst = value_scratch;
+    for (unsigned p = 0; p < sizeof(T); p++) {
+        run_concurrently(threads, [&](unsigned c) {
+            std::size_t* counts = chunks[c].counts;
+            std::fill(counts, counts + 256, std::size_t{0});
+            const std::size_t last = chunk_begin(c + 1);
+            for (std::size_t i = chunk_begin(c); i < last; i++) {
+                ++counts[radix_digit(src[i], p)];
+            }
+        });
+
+        // Chunk c's elements with digit d go after those of all lower digits,
+        // and after those of earlier chunks with the same digit
+        std::size_t sum = 0;
+        bool skip = false;
+        for (unsigned d = 0; d < 256 && !skip; d++) {
+            std::size_t total = 0;
+            for (unsigned c = 0; c < threads; c++) {
+                const std::size_t count = chunks[c].counts[d];
+                chunks[c].counts[d] = sum + total;
+                total += count;
+            }
+            skip = total == n;
+            sum += total;
+        }
+        if (skip) {
+            continue;
+        }
+
+        run_concurrently(threads, [&](unsigned c) {
+            radix_scatter(src, dst, vsrc, vdst, chunk_begin(c),
+                          chunk_begin(c + 1), p, chunks[c].counts);
+        });
+        std::swap(src, dst);
+        std::swap(vsrc, vdst);
+    }
+
+    if (src != data) {
+        radix_move_back(data, scratch, values, value_scratch, n);
+    }
+}
+
+template <typename T>
+struct is_radix_sortable {
+    static constexpr bool value =
+        std::is_arithmetic<T>::value && !std::is_same<T, bool>::value &&
+        (!std::is_floating_point<T>::value ||
+         (std::numeric_limits<T>::is_iec559 &&
+          (sizeof(T) == 4 || sizeof(T) == 8)));
+};
+
+} // namespace detail
+
+// Sorts data into ascending order, using scratch (which must be at least as
+// large as data) as temporary space. The sort is stable, and does not
+// allocate. Integers and IEEE floating-point types are supported; negative
+// zero sorts before positive zero, and NaNs sort before or after all other
+// values according to their sign bits.
+template <typename T, std::size_t Extent, std::size_t ScratchExtent>
+void radix_sort(span<T, Extent> data, span<T, ScratchExtent> scratch)
+{
+    static_assert(detail::is_radix_sortable<T>::value,
+                  "radix_sort() requires integer or floating-point keys");
+    TCB_SPAN_EXPECT(scratch.size() >= data.size());
+    detail::radix_sort_impl(data.data(), scratch.data(),
+                            static_cast<detail::radix_no_values*>(nullptr),
+                            static_cast<detail::radix_no_values*>(nullptr),
+                            data.size());
+}
+
+// Sorts keys as above, applying the same permutation to values (which must
+// be the same size as keys). Values are moved rather than copied.
+template <typename K, std::size_t KeysExtent, typename V,
+          std::size_t ValuesExtent, std::size_t KeyScratchExtent,
+          std::size_t ValueScratchExtent>
+void radix_sort(span<K, KeysExtent> keys, span<V, ValuesExtent> values,
+                span<K, KeyScratchExtent> key_scratch,
+                span<V, ValueScratchExtent> value_scratch)
+{
+    static_assert(detail::is_radix_sortable<K>::value,
+                  "radix_sort() requires integer or floating-point keys");
+    TCB_SPAN_EXPECT(values.size() == keys.size());
+    TCB_SPAN_EXPECT(key_scratch.size() >= keys.size());
+    TCB_SPAN_EXPECT(value_scratch.size() >= keys.size());
+    detail::radix_sort_impl(keys.data(), key_scratch.data(), values.data(),
+                            value_scratch.data(), keys.size());
+}
+
+// As radix_sort(), but splits each pass between up to the given number of
+// threads. Small inputs are sorted on the calling thread.
+template <typename T, std::size_t Extent, std::size_t ScratchExtent>
+void radix_sort_parallel(span<T, Extent> data, span<T, ScratchExtent> scratch,
+                         unsigned threads = std::thread::hardware_concurrency())
+{
+    static_assert(detail::is_radix_sortable<T>::value,
+                  "radix_sort_parallel() requires integer or floating-point "
+                  "keys");
+    TCB_SPAN_EXPECT(scratch.size() >= data.size());
+    detail::radix_sort_parallel_impl(
+        data.data(), scratch.data(),
+        static_cast<detail::radix_no_values*>(nullptr),
+        static_cast<detail::radix_no_values*>(nullptr), data.size(), threads);
+}
+
+template <typename K, std::size_t KeysExtent, typename V,
+          std::size_t ValuesExtent, std::size_t KeyScratchExtent,
+          std::size_t ValueScratchExtent>
+void radix_sort_parallel(
+    span<K, KeysExtent> keys, span<V, ValuesExtent> values,
+    span<K, KeyScratchExtent> key_scratch,
+    span<V, ValueScratchExtent> value_scratch,
+    unsigned threads = std::thread::hardware_concurrency())
+{
+    static_assert(detail::is_radix_sortable<K>::value,
+                  "radix_sort_parallel() requires integer or floating-point "
+                  "keys");
+    TCB_SPAN_EXPECT(values.size() == keys.size());
+    TCB_SPAN_EXPECT(key_scratch.size() >= keys.size());
+    TCB_SPAN_EXPECT(value_scratch.size() >= keys.size());
+    detail::radix_sort_parallel_impl(keys.data(), key_scratch.data(),
+                                     values.data(), value_scratch.data(),
+                                     keys.size(), threads);
+}
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_RADIX_SORT_HPP_INCLUDED
@@ -0,0 +1,435 @@
+
+/*
+Set operations and deduplication over sorted spans
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_SET_OPS_HPP_INCLUDED
+#define TCB_SET_OPS_HPP_INCLUDED
+
+#include "span_ext.hpp"
+
+#include <algorithm>
+#include <functional>
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+namespace detail {
+
+// When one input is this many times larger than the other, each element of
+// the smaller is located in the larger by galloping instead of merging
+constexpr std::size_t set_gallop_ratio = 32;
+
+// Finds the first element of [first, last) not less than key, examining
+// positions 1, 2, 4, ... before binary searching. This costs O(log d) for a
+// result d elements along, rather than O(log n).
+template <typename T, typename Compare>
+const T* gallop_lower_bound(const T* first, const T* last, const T& key,
+                            Compare& comp)
+{
+    const std::size_t n = static_cast<std::size_t>(last - first);
+    std::size_t bound = 1;
+    while (bound < n && comp(first[bound], key)) {
+        bound *= 2;
+    }
+    return std::lower_bound(first + bound / 2,
+                            first + (std::min)(bound + 1, n), key, comp);
+}
+
+template <typename T>
+struct set_output {
+    T* data;
+    std::size_t size;
+    std::size_t n;
+
+    void push(const T& t)
+    {
+        TCB_SPAN_EXPECT(n < size);
+        data[n++] = t;
+    }
+
+    template <typename It>
+    void append(It first, It last)
+    {
+        TCB_SPAN_EXPECT(static_cast<std::size_t>(last - first) <= size - n);
+        std::copy(first, last, data + n);
+        n += static_cast<std::size_t>(last - first);
+    }
+};
+
+template <typename T, typename U, typename Compare>
+void intersect_gallop(const T* a, const T* ea, const T* b, const T* eb,
+                      set_output<U>& out, Compare& comp)
+{
+    // a is the smaller input
+    for (; a != ea && b != eb; ++a) {
+        b = gallop_lower_bound(b, eb, *a, comp);
+        if (b != eb && !comp(*a, *b)) {
+            out.push(*a);
+            ++b;
+        }
+    }
+}
+
+template <typename T, typename U, typename Compare>
+void intersect_scalar(const T* a, const T* ea, const T* b, const T* eb,
+                      set_output<U>& out, Compare& comp)
+{
+    while (a != ea && b != eb) {
+        if (comp(*a, *b)) {
+            ++a;
+        } else if (comp(*b, *a)) {
+            ++b;
+        } else {
+            out.push(*a);
+            ++a;
+            ++b;
+        }
+    }
+}
+
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+
+// For each 4-bit mask, the pshufb control which moves the selected 32-bit
+// lanes to the front
+struct intersect_shuffle_table {
+    alignas(16) std::uint8_t shuffle[16][16];
+
+    intersect_shuffle_table() noexcept
+    {
+        for (unsigned m = 0; m < 16; m++) {
+            unsigned k = 0;
+            for (unsigned lane = 0; lane < 4; lane++) {
+                if ((m >> lane) & 1) {
+                    for (unsigned byte = 0; byte < 4; byte++) {
+                        shuffle[m][4 * k + byte] =
+                            static_cast<std::uint8_t>(4 * lane + byte);
+                    }
+                    ++k;
+                }
+            }
+            for (unsigned byte = 4 * k; byte < 16; byte++) {
+                shuffle[m][byte] = 0x80;
+            }
+        }
+    }
+};
+
+inline const intersect_shuffle_table& intersect_shuffles() noexcept
+{
+    static const intersect_shuffle_table table;
+    return table;
+}
+
+// Intersects blocks of four 32-bit keys by comparing each block of a against
+// every rotation of the current block of b, then compacting the matches with
+// a byte shuffle. Keys must be unique within each input. Advances a and b to
+// where the scalar code should continue.
+template <typename T>
+TCB_SPAN_TARGET("ssse3,popcnt")
+void intersect_ssse3(const T*& a, const T* ea, const T*& b, const T* eb,
+                     set_output<T>& out)
+{
+    const intersect_shuffle_table& table = intersect_shuffles();
+    while (ea - a >= 4 && eb - b >= 4 && out.size - out.n >= 4) {
+        const __m128i va =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+        const __m128i vb =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+        const __m128i r1 = _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1));
+        const __m128i r2 = _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2));
+        const __m128i r3 = _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3));
+        const __m128i eq =
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi32(va, vb),
+                                      _mm_cmpeq_epi32(va, r1)),
+                         _mm_or_si128(_mm_cmpeq_epi32(va, r2),
+                                      _mm_cmpeq_epi32(va, r3)));
+        const unsigned mask =
+            static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(eq)));
+        const __m128i control = _mm_load_si128(
+            reinterpret_cast<const __m128i*>(table.shuffle[mask]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out.data + out.n),
+                         _mm_shuffle_epi8(va, control));
+        out.n += static_cast<std::size_t>(_mm_popcnt_u32(mask));
+
+        // Advance past whichever block ends first (or both)
+        const T amax = a[3];
+        const T bmax = b[3];
+        a += amax <= bmax ? 4 : 0;
+        b += bmax <= amax ? 4 : 0;
+    }
+}
+
+#endif // TCB_SPAN_HAVE_X86_SIMD
+
+template <typename T>
+void intersect_simd(const T*& a, const T* ea, const T*& b, const T* eb,
+                    set_output<T>& out, std::true_type)
+{
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+    if (cpu().ssse3 && cpu().popcnt) {
+        intersect_ssse3(a, ea, b, eb, out);
+    }
+#else
+    (void) a, (void) ea, (void) b, (void) eb, (void) out;
+#endif
+}
+
+template <typename T, typename U>
+void intersect_simd(const T*&, const T*, const T*&, const T*, set_output<U>&,
+                    std::false_type)
+{}
+
+template <typename T, typename U, typename Compare>
+struct is_simd_intersectable {
+    static constexpr bool value =
+        std::is_same<T, U>::value &&
+        (std::is_same<T, std::int32_t>::value ||
+         std::is_same<T, std::uint32_t>::value) &&
+        std::is_same<Compare, std::less<T>>::value;
+};
+
+// Whether the smaller of two inputs is small enough to gallop through the
+// larger one
+inline bool set_should_gallop(std::size_t smaller, std::size_t larger)
+{
+    return smaller < larger / set_gallop_ratio;
+}
+
+template <typename T, std::size_t Extent, typename Compare>
+bool is_strictly_increasing(span<T, Extent> s, Compare& comp)
+{
+    for (std::size_t i = 1; i < s.size(); i++) {
+        if (!comp(s[i - 1], s[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Branch-free deduplication for trivially copyable types: each element is
+// written, but the output position only advances past those kept. Writes
+// never overtake reads, so out may alias in.
+template <typename T, typename Compare>
+std::size_t unique_impl(const T* in, std::size_t in_size, T* out,
+                        std::size_t out_size, Compare& comp, std::true_type)
+{
+    if (in_size == 0) {
+        return 0;
+    }
+    TCB_SPAN_EXPECT(out_size > 0);
+    T last = in[0];
+    out[0] = last;
+    std::size_t n = 1;
+    std::size_t i = 1;
+    for (; i < in_size && n < out_size; i++) {
+        const T t = in[i];
+        const bool keep = comp(last, t);
+        last = keep ? t : last;
+        out[n] = last;
+        n += keep;
+    }
+    // The output is full: nothing else may be kept
+    for (; i < in_size; i++) {
+        TCB_SPAN_EXPECT(!comp(last, in[i]));
+    }
+    return n;
+}
+
+template <typename T, typename Compare>
+std::size_t unique_impl(const T* in, std::size_t in_size, T* out,
+                        std::size_t out_size, Compare& comp, std::false_type)
+{
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < in_size; i++) {
+        if (n == 0 || comp(out[n - 1], in[i])) {
+            TCB_SPAN_EXPECT(n < out_size);
+            if (out + n != in + i) {
+                out[n] = in[i];
+            }
+            ++n;
+        }
+    }
+    (void) out_size;
+    return n;
+}
+
+} // namespace detail
+
+// These functions take sorted sets: spans whose elements are strictly
+// increasing according to comp (which is checked when contract checking is
+// enabled). Use unique() to turn a sorted span into a set. Each writes its
+// result to the start of out, which must be large enough to hold it, and
+// returns the written part of out.
+
+// Writes the elements present in both a and b. An output as large as the
+// smaller input always suffices.
+//
+// Inputs of very different sizes are intersected by galloping through the
+// larger one. For 32-bit integer keys with std::less, similar-sized inputs
+// are compared four elements against four using SSSE3.
+template <typename T1, std::size_t E1, typename T2, std::size_t E2,
+          typename U, std::size_t OutExtent, typename Compare = std::less<U>>
+span<U> set_intersection(span<T1, E1> a, span<T2, E2> b,
+                         span<U, OutExtent> out, Compare comp = Compare())
+{
+    static_assert(std::is_same<typename std::remove_cv<T1>::type, U>::value &&
+                      std::is_same<typename std::remove_cv<T2>::type, U>::value,
+                  "set_intersection() requires matching element types");
+    TCB_SPAN_EXPECT(detail::is_strictly_increasing(a, comp));
+    TCB_SPAN_EXPECT(detail::is_strictly_increasing(b, comp));
+
+    const U* pa = a.data();
+    const U* ea = pa + a.size();
+    const U* pb = b.data();
+    const U* eb = pb + b.size();
+    detail::set_output<U> res{out.data(), out.size(), 0};
+
+    if (detail::set_should_gallop(a.size(), b.size())) {
+        detail::intersect_gallop(pa, ea, pb, eb, res, comp);
+    } else if (detail::set_should_gallop(b.size(), a.size())) {
+        detail::intersect_gallop(pb, eb, pa, ea, res, comp);
+    } else {
+        detail::intersect_simd(
+            pa, ea, pb, eb, res,
+            std::integral_constant<bool, detail::is_simd_intersectable<
+                                             U, U, Compare>::value>{});
+        detail::intersect_scalar(pa, ea, pb, eb, res, comp);
+    }
+    return out.first(res.n);
+}
+
+// Writes the elements present in either a or b. An output as large as both
+// inputs together always suffices.
+template <typename T1, std::size_t E1, typename T2, std::size_t E2,
+          typename U, std::size_t OutExtent, typename Compare = std::less<U>>
+span<U> set_union(span<T1, E1> a, span<T2, E2> b, span<U, OutExtent> out,
+                  Compare comp = Compare())
+{
+    static_assert(std::is_same<typename std::remove_cv<T1>::type, U>::value &&
+                      std::is_same<typename std::remove_cv<T2>::type, U>::value,
+                  "set_union() requires matching element types");
+    TCB_SPAN_EXPECT(detail::is_strictly_increasing(a, comp));
+    TCB_SPAN_EXPECT(detail::is_strictly_increasing(b, comp));
+
+    const U* pa = a.data();
+    const U* ea = pa + a.size();
+    const U* pb = b.data();
+    const U* eb = pb + b.size();
+    detail::set_output<U> res{out.data(), out.size(), 0};
+
+    // Gallop through the larger input, copying the runs between the
+    // elements of the smaller one
+    const bool gallop_a = detail::set_should_gallop(b.size(), a.size());
+    const bool gallop_b = detail::set_should_gallop(a.size(), b.size());
+    if (gallop_a || gallop_b) {
+        const U* few = gallop_a ? pb : pa;
+        const U* few_end = gallop_a ? eb : ea;
+        const U* many = gallop_a ? pa : pb;
+        const U* many_end = gallop_a ? ea : eb;
+        for (; few != few_end; ++few) {
+            const U* pos = detail::gallop_lower_bound(many, many_end, *few,
+                                                      comp);
+            res.append(many, pos);
+            many = pos;
+            // Elements of a come first when equal
+            if (many != many_end && !comp(*few, *many)) {
+                res.push(gallop_a ? *many : *few);
+                ++many;
+            } else {
+                res.push(*few);
+            }
+        }
+        res.append(many, many_end);
+        return out.first(res.n);
+    }
+
+    while (pa != ea && pb != eb) {
+        if (comp(*pb, *pa)) {
+            res.push(*pb++);
+        } else {
+            pb += !comp(*pa, *pb);
+            res.push(*pa++);
+        }
+    }
+    res.append(pa, ea);
+    res.append(pb, eb);
+    return out.first(res.n);
+}
+
+// Writes the elements of a which are not present in b. An output as large as
+// a always suffices.
+template <typename T1, std::size_t E1, typename T2, std::size_t E2,
+          typename U, std::size_t OutExtent, typename Compare = std::less<U>>
+span<U> set_difference(span<T1, E1> a, span<T2, E2> b, span<U, OutExtent> out,
+                       Compare comp = Compare())
+{
+    static_assert(std::is_same<typename std::remove_cv<T1>::type, U>::value &&
+                      std::is_same<typename std::remove_cv<T2>::type, U>::value,
+                  "set_difference() requires matching element types");
+    TCB_SPAN_EXPECT(detail::is_strictly_increasing(a, comp));
+    TCB_SPAN_EXPECT(detail::is_strictly_increasing(b, comp));
+
+    const U* pa = a.data();
+    const U* ea = pa + a.size();
+    const U* pb = b.data();
+    const U* eb = pb + b.size();
+    detail::set_output<U> res{out.data(), out.size(), 0};
+
+    if (detail::set_should_gallop(a.size(), b.size())) {
+        // Look up each element of a in b
+        for (; pa != ea; ++pa) {
+            pb = detail::gallop_lower_bound(pb, eb, *pa, comp);
+            if (pb == eb || comp(*pa, *pb)) {
+                res.push(*pa);
+            }
+        }
+    } else if (detail::set_should_gallop(b.size(), a.size())) {
+        // Copy the runs of a between the elements of b
+        for (; pb != eb; ++pb) {
+            const U* pos = detail::gallop_lower_bound(pa, ea, *pb, comp);
+            res.append(pa, pos);
+            pa = pos;
+            if (pa != ea && !comp(*pb, *pa)) {
+                ++pa;
+            }
+        }
+    } else {
+        while (pa != ea && pb != eb) {
+            if (comp(*pa, *pb)) {
+                res.push(*pa++);
+            } else {
+                pa += !comp(*pb, *pa);
+                ++pb;
+            }
+        }
+    }
+    res.append(pa, ea);
+    return out.first(res.n);
+}
+
+// Copies the sorted span in to out, keeping only the first of each run of
+// equivalent elements, and returns the written part of out. out may be the
+// same span as in. Otherwise, elements of out beyond the returned part may
+// be overwritten, as for compress_if().
+template <typename T, std::size_t InExtent, typename U, std::size_t OutExtent,
+          typename Compare = std::less<U>>
+span<U> unique(span<T, InExtent> in, span<U, OutExtent> out,
+               Compare comp = Compare())
+{
+    static_assert(std::is_same<typename std::remove_cv<T>::type, U>::value,
+                  "unique() requires matching input and output types");
+    TCB_SPAN_EXPECT(std::is_sorted(in.begin(), in.end(), comp));
+
+    const std::size_t n = detail::unique_impl(
+        in.data(), in.size(), out.data(), out.size(), comp,
+        std::integral_constant<bool, std::is_trivially_copyable<U>::value>{});
+    return out.first(n);
+}
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_SET_OPS_HPP_INCLUDED
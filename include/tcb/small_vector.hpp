@@ -0,0 +1,493 @@
+
+/*
+A vector with inline storage for a small number of elements, designed to be
+viewed through tcb::span
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_SMALL_VECTOR_HPP_INCLUDED
+#define TCB_SMALL_VECTOR_HPP_INCLUDED
+
+#include "span.hpp"
+
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+
+// A sequence container which stores up to N elements in-place, only
+// allocating from the heap when it grows beyond that. It provides data() and
+// size(), so converts implicitly to span<T> and span<const T>.
+template <typename T, std::size_t N>
+class small_vector {
+    static_assert(N > 0, "A small_vector must have a non-zero inline capacity");
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using iterator = pointer;
+    using const_iterator = const_pointer;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    static constexpr size_type inline_capacity = N;
+
+    // construction, copy, assignment and destruction
+    small_vector() noexcept : data_(inline_data()) {}
+
+    explicit small_vector(size_type count) : small_vector() { resize(count); }
+
+    small_vector(size_type count, const T& value) : small_vector()
+    {
+        assign(count, value);
+    }
+
+    template <typename InputIt, typename = typename std::enable_if<
+                                    !std::is_integral<InputIt>::value>::type>
+    small_vector(InputIt first, InputIt last) : small_vector()
+    {
+        assign(first, last);
+    }
+
+    small_vector(std::initializer_list<T> il) : small_vector()
+    {
+        assign(il.begin(), il.end());
+    }
+
+    small_vector(const small_vector& other) : small_vector()
+    {
+        assign(other.begin(), other.end());
+    }
+
+    small_vector(small_vector&& other) noexcept(
+        std::is_nothrow_move_constructible<T>::value)
+        : small_vector()
+    {
+        take(other);
+    }
+
+    ~small_vector()
+    {
+        destroy(begin(), end());
+        deallocate();
+    }
+
+    small_vector& operator=(const small_vector& other)
+    {
+        if (this != &other) {
+            assign(other.begin(), other.end());
+        }
+        return *this;
+    }
+
+    small_vector& operator=(small_vector&& other) noexcept(
+        std::is_nothrow_move_constructible<T>::value)
+    {
+        if (this != &other) {
+            clear();
+            take(other);
+        }
+        return *this;
+    }
+
+    small_vector& operator=(std::initializer_list<T> il)
+    {
+        assign(il.begin(), il.end());
+        return *this;
+    }
+
+    void assign(size_type count, const T& value)
+    {
+        clear();
+        reserve(count);
+        std::uninitialized_fill_n(data_, count, value);
+        size_ = count;
+    }
+
+    template <typename InputIt, typename = typename std::enable_if<
+                                    !std::is_integral<InputIt>::value>::type>
+    void assign(InputIt first, InputIt last)
+    {
+        clear();
+        for (; first != last; ++first) {
+            emplace_back(*first);
+        }
+    }
+
+    void assign(std::initializer_list<T> il) { assign(il.begin(), il.end()); }
+
+    // element access
+    reference operator[](size_type idx)
+    {
+        TCB_SPAN_EXPECT(idx < size());
+        return data_[idx];
+    }
+
+    const_reference operator[](size_type idx) const
+    {
+        TCB_SPAN_EXPECT(idx < size());
+        return data_[idx];
+    }
+
+    reference front()
+    {
+        TCB_SPAN_EXPECT(!empty());
+        return data_[0];
+    }
+
+    const_reference front() const
+    {
+        TCB_SPAN_EXPECT(!empty());
+        return data_[0];
+    }
+
+    reference back()
+    {
+        TCB_SPAN_EXPECT(!empty());
+        return data_[size_ - 1];
+    }
+
+    const_reference back() const
+    {
+        TCB_SPAN_EXPECT(!empty());
+        return data_[size_ - 1];
+    }
+
+    pointer data() noexcept { return data_; }
+    const_pointer data() const noexcept { return data_; }
+
+    // Views the contents as a fixed-extent span. Only valid when the vector
+    // holds exactly N elements.
+    span<T, N> fixed_span()
+    {
+        TCB_SPAN_EXPECT(size() == N);
+        return span<T, N>(data_, N);
+    }
+
+    span<const T, N> fixed_span() const
+    {
+        TCB_SPAN_EXPECT(size() == N);
+        return span<const T, N>(data_, N);
+    }
+
+    // iterators
+    iterator begin() noexcept { return data_; }
+    const_iterator begin() const noexcept { return data_; }
+    const_iterator cbegin() const noexcept { return data_; }
+
+    iterator end() noexcept { return data_ + size_; }
+    const_iterator end() const noexcept { return data_ + size_; }
+    const_iterator cend() const noexcept { return data_ + size_; }
+
+    reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+    const_reverse_iterator rbegin() const noexcept
+    {
+        return const_reverse_iterator(end());
+    }
+
+    reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+    const_reverse_iterator rend() const noexcept
+    {
+        return const_reverse_iterator(begin());
+    }
+
+    // capacity
+    TCB_SPAN_NODISCARD bool empty() const noexcept { return size_ == 0; }
+
+    size_type size() const noexcept { return size_; }
+
+    size_type max_size() const noexcept
+    {
+        return std::allocator_traits<std::allocator<T>>::max_size(
+            std::allocator<T>());
+    }
+
+    size_type capacity() const noexcept { return capacity_; }
+
+    // True if the elements are currently stored in-place (no heap allocation)
+    bool is_inline() const noexcept { return data_ == inline_data(); }
+
+    void reserve(size_type new_cap)
+    {
+        if (new_cap > capacity_) {
+            reallocate(new_cap);
+        }
+    }
+
+    void shrink_to_fit()
+    {
+        if (!is_inline() && size_ < capacity_) {
+            reallocate(size_);
+        }
+    }
+
+    // modifiers
+    void clear() noexcept
+    {
+        destroy(begin(), end());
+        size_ = 0;
+    }
+
+    void push_back(const T& value) { emplace_back(value); }
+
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    template <typename... Args>
+    reference emplace_back(Args&&... args)
+    {
+        if (size_ == capacity_) {
+            return emplace_back_grow(std::forward<Args>(args)...);
+        }
+        ::new (static_cast<void*>(data_ + size_))
+            T(std::forward<Args>(args)...);
+        return data_[size_++];
+    }
+
+    void pop_back()
+    {
+        TCB_SPAN_EXPECT(!empty());
+        data_[--size_].~T();
+    }
+
+    template <typename... Args>
+    iterator emplace(const_iterator pos, Args&&... args)
+    {
+        TCB_SPAN_EXPECT(pos >= begin() && pos <= end());
+        const size_type idx = static_cast<size_type>(pos - begin());
+        if (idx == size_) {
+            emplace_back(std::forward<Args>(args)...);
+        } else {
+            // Construct first, in case args alias an existing element
+            T tmp(std::forward<Args>(args)...);
+            emplace_back(std::move(back()));
+            std::move_backward(begin() + idx, end() - 2, end() - 1);
+            data_[idx] = std::move(tmp);
+        }
+        return begin() + idx;
+    }
+
+    iterator insert(const_iterator pos, const T& value)
+    {
+        return emplace(pos, value);
+    }
+
+    iterator insert(const_iterator pos, T&& value)
+    {
+        return emplace(pos, std::move(value));
+    }
+
+    iterator erase(const_iterator pos)
+    {
+        TCB_SPAN_EXPECT(pos >= begin() && pos < end());
+        return erase(pos, pos + 1);
+    }
+
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        TCB_SPAN_EXPECT(first >= begin() && first <= last && last <= end());
+        const iterator f = begin() + (first - cbegin());
+        const iterator l = begin() + (last - cbegin());
+        if (f != l) {
+            const iterator new_end = std::move(l, end(), f);
+            destroy(new_end, end());
+            size_ = static_cast<size_type>(new_end - begin());
+        }
+        return f;
+    }
+
+    void resize(size_type count)
+    {
+        if (count < size_) {
+            destroy(begin() + count, end());
+            size_ = count;
+        } else {
+            reserve(count);
+            while (size_ < count) {
+                emplace_back();
+            }
+        }
+    }
+
+    void resize(size_type count, const T& value)
+    {
+        if (count < size_) {
+            destroy(begin() + count, end());
+            size_ = count;
+        } else {
+            reserve(count);
+            while (size_ < count) {
+                emplace_back(value);
+            }
+        }
+    }
+
+    void swap(small_vector& other) noexcept(
+        std::is_nothrow_move_constructible<T>::value)
+    {
+        small_vector tmp(std::move(other));
+        other = std::move(*this);
+        *this = std::move(tmp);
+    }
+
+private:
+    T* inline_data() noexcept { return reinterpret_cast<T*>(buffer_); }
+
+    const T* inline_data() const noexcept
+    {
+        return reinterpret_cast<const T*>(buffer_);
+    }
+
+    static void destroy(T* first, T* last) noexcept
+    {
+        for (; first != last; ++first) {
+            first->~T();
+        }
+    }
+
+    void deallocate() noexcept
+    {
+        if (!is_inline()) {
+            std::allocator<T>().deallocate(data_, capacity_);
+        }
+    }
+
+    // Cleans up after a constructor throws part-way through filling new
+    // storage, including an element already built beyond the constructed
+    // prefix. Does nothing once dismissed.
+    struct storage_guard {
+        T* data;
+        size_type capacity;
+        size_type constructed;
+        T* extra;
+
+        void dismiss() noexcept { data = nullptr; }
+
+        ~storage_guard()
+        {
+            if (data) {
+                destroy(data, data + constructed);
+                if (extra) {
+                    extra->~T();
+                }
+                if (capacity > N) {
+                    std::allocator<T>().deallocate(data, capacity);
+                }
+            }
+        }
+    };
+
+    // Moves the elements into new storage large enough for new_cap
+    // elements, which will be the inline buffer if possible
+    void reallocate(size_type new_cap)
+    {
+        T* new_data = new_cap <= N ? inline_data()
+                                   : std::allocator<T>().allocate(new_cap);
+        if (new_data == data_) {
+            return;
+        }
+        relocate(new_data, new_cap);
+    }
+
+    // extra, if not null, is an element already constructed in new_data,
+    // which is destroyed along with the rest if relocation fails
+    void relocate(T* new_data, size_type new_cap, T* extra = nullptr)
+    {
+        storage_guard guard{new_data, new_cap, 0, extra};
+        for (; guard.constructed < size_; ++guard.constructed) {
+            ::new (static_cast<void*>(new_data + guard.constructed))
+                T(std::move_if_noexcept(data_[guard.constructed]));
+        }
+        guard.dismiss();
+        destroy(begin(), end());
+        deallocate();
+        data_ = new_data;
+        capacity_ = new_cap < N ? N : new_cap;
+    }
+
+    template <typename... Args>
+    reference emplace_back_grow(Args&&... args)
+    {
+        const size_type new_cap = capacity_ * 2;
+        T* new_data = std::allocator<T>().allocate(new_cap);
+        // Construct the new element before moving the old ones, in case args
+        // refers to one of them
+        {
+            storage_guard guard{new_data, new_cap, 0, nullptr};
+            ::new (static_cast<void*>(new_data + size_))
+                T(std::forward<Args>(args)...);
+            guard.dismiss();
+        }
+        relocate(new_data, new_cap, new_data + size_);
+        return data_[size_++];
+    }
+
+    // Precondition: *this is empty
+    void take(small_vector& other)
+    {
+        if (other.is_inline()) {
+            reserve(other.size_);
+            std::uninitialized_copy(std::make_move_iterator(other.begin()),
+                                    std::make_move_iterator(other.end()),
+                                    data_);
+            size_ = other.size_;
+            other.clear();
+        } else {
+            deallocate();
+            data_ = other.data_;
+            size_ = other.size_;
+            capacity_ = other.capacity_;
+            other.data_ = other.inline_data();
+            other.size_ = 0;
+            other.capacity_ = N;
+        }
+    }
+
+    T* data_;
+    size_type size_ = 0;
+    size_type capacity_ = N;
+    alignas(T) unsigned char buffer_[N * sizeof(T)];
+};
+
+template <typename T, std::size_t N>
+bool operator==(const small_vector<T, N>& lhs, const small_vector<T, N>& rhs)
+{
+    return lhs.size() == rhs.size() &&
+           std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+template <typename T, std::size_t N>
+bool operator!=(const small_vector<T, N>& lhs, const small_vector<T, N>& rhs)
+{
+    return !(lhs == rhs);
+}
+
+template <typename T, std::size_t N>
+bool operator<(const small_vector<T, N>& lhs, const small_vector<T, N>& rhs)
+{
+    return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(),
+                                        rhs.end());
+}
+
+template <typename T, std::size_t N>
+void swap(small_vector<T, N>& lhs,
+          small_vector<T, N>& rhs) noexcept(noexcept(lhs.swap(rhs)))
+{
+    lhs.swap(rhs);
+}
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_SMALL_VECTOR_HPP_INCLUDED
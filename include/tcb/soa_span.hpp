@@ -0,0 +1,473 @@
+
+/*
+A structure-of-arrays view over several parallel spans of the same size
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_SOA_SPAN_HPP_INCLUDED
+#define TCB_SOA_SPAN_HPP_INCLUDED
+
+#include "gather.hpp"
+#include "radix_sort.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <numeric>
+#include <tuple>
+#include <vector>
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+namespace detail {
+
+// Evaluates an expression for each element of a pack, in order
+using swallow = int[];
+
+template <typename... Sizes>
+std::size_t first_size(std::size_t size, Sizes...)
+{
+    return size;
+}
+
+} // namespace detail
+
+// A view of the rows of several spans of the same size, one per column, as
+// in a structure of arrays. The size is checked once, on construction, and
+// slicing with first(), last() and subspan() applies to every column.
+// Elements are accessed through tuples of references, one per column;
+// individual columns are available as spans through column<I>().
+//
+// The rows can be sorted by one column with sort_by_column(), which permutes
+// every column in a single pass, and filtered with compress_if(), which
+// copies the selected rows of each column a batch at a time.
+template <typename... Ts>
+class soa_span {
+    static_assert(sizeof...(Ts) > 0, "soa_span requires at least one column");
+
+    using pointers = std::tuple<Ts*...>;
+    using indices = typename detail::make_index_list<sizeof...(Ts)>::type;
+
+public:
+    using size_type = std::size_t;
+    using value_type = std::tuple<typename std::remove_cv<Ts>::type...>;
+    using reference = std::tuple<Ts&...>;
+
+    template <std::size_t I>
+    using column_type = typename std::tuple_element<I, std::tuple<Ts...>>::type;
+
+    static constexpr size_type columns = sizeof...(Ts);
+
+    // A random-access iterator whose reference type is a tuple of references
+    class iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = soa_span::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference = soa_span::reference;
+        using pointer = void;
+
+        iterator() = default;
+
+        reference operator*() const { return soa_span::row(data_, index_); }
+
+        reference operator[](difference_type n) const
+        {
+            return soa_span::row(data_, index_ + static_cast<size_type>(n));
+        }
+
+        iterator& operator++()
+        {
+            ++index_;
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator tmp = *this;
+            ++index_;
+            return tmp;
+        }
+
+        iterator& operator--()
+        {
+            --index_;
+            return *this;
+        }
+
+        iterator operator--(int)
+        {
+            iterator tmp = *this;
+            --index_;
+            return tmp;
+        }
+
+        iterator& operator+=(difference_type n)
+        {
+            index_ += static_cast<size_type>(n);
+            return *this;
+        }
+
+        iterator& operator-=(difference_type n)
+        {
+            index_ -= static_cast<size_type>(n);
+            return *this;
+        }
+
+        friend iterator operator+(iterator it, difference_type n)
+        {
+            return it += n;
+        }
+
+        friend iterator operator+(difference_type n, iterator it)
+        {
+            return it += n;
+        }
+
+        friend iterator operator-(iterator it, difference_type n)
+        {
+            return it -= n;
+        }
+
+        friend difference_type operator-(const iterator& a, const iterator& b)
+        {
+            return static_cast<difference_type>(a.index_) -
+                   static_cast<difference_type>(b.index_);
+        }
+
+        friend bool operator==(const iterator& a, const iterator& b)
+        {
+            return a.index_ == b.index_;
+        }
+
+        friend bool operator!=(const iterator& a, const iterator& b)
+        {
+            return a.index_ != b.index_;
+        }
+
+        friend bool operator<(const iterator& a, const iterator& b)
+        {
+            return a.index_ < b.index_;
+        }
+
+        friend bool operator>(const iterator& a, const iterator& b)
+        {
+            return a.index_ > b.index_;
+        }
+
+        friend bool operator<=(const iterator& a, const iterator& b)
+        {
+            return a.index_ <= b.index_;
+        }
+
+        friend bool operator>=(const iterator& a, const iterator& b)
+        {
+            return a.index_ >= b.index_;
+        }
+
+    private:
+        friend class soa_span;
+
+        iterator(const pointers& data, size_type index)
+            : data_(data), index_(index)
+        {}
+
+        pointers data_{};
+        size_type index_ = 0;
+    };
+
+    soa_span() noexcept = default;
+
+    explicit soa_span(span<Ts>... columns)
+        : data_(columns.data()...),
+          size_(detail::first_size(columns.size()...))
+    {
+        TCB_SPAN_EXPECT(detail::all_equal(size_, {columns.size()...}));
+    }
+
+    template <typename... Us,
+              typename std::enable_if<
+                  sizeof...(Us) == sizeof...(Ts) &&
+                      std::is_convertible<std::tuple<Us*...>, pointers>::value,
+                  int>::type = 0>
+    soa_span(const soa_span<Us...>& other) noexcept
+        : soa_span(other.data_, other.size_)
+    {}
+
+    // observers
+    size_type size() const noexcept { return size_; }
+    TCB_SPAN_NODISCARD bool empty() const noexcept { return size_ == 0; }
+
+    template <std::size_t I>
+    span<column_type<I>> column() const noexcept
+    {
+        return span<column_type<I>>(std::get<I>(data_), size_);
+    }
+
+    // element access
+    reference operator[](size_type idx) const
+    {
+        TCB_SPAN_EXPECT(idx < size_);
+        return row(data_, idx);
+    }
+
+    iterator begin() const noexcept { return iterator(data_, 0); }
+    iterator end() const noexcept { return iterator(data_, size_); }
+
+    // subviews, of every column at once
+    soa_span first(size_type count) const
+    {
+        TCB_SPAN_EXPECT(count <= size_);
+        return soa_span(data_, count);
+    }
+
+    soa_span last(size_type count) const
+    {
+        TCB_SPAN_EXPECT(count <= size_);
+        return soa_span(advance(data_, size_ - count, indices{}), count);
+    }
+
+    soa_span subspan(size_type offset, size_type count = dynamic_extent) const
+    {
+        TCB_SPAN_EXPECT(offset <= size_ &&
+                        (count == dynamic_extent || count <= size_ - offset));
+        return soa_span(advance(data_, offset, indices{}),
+                        count == dynamic_extent ? size_ - offset : count);
+    }
+
+private:
+    template <typename...>
+    friend class soa_span;
+
+    soa_span(const pointers& data, size_type size) noexcept
+        : data_(data), size_(size)
+    {}
+
+    static reference row(const pointers& data, size_type idx)
+    {
+        return row(data, idx, indices{});
+    }
+
+    template <std::size_t... Is>
+    static reference row(const pointers& data, size_type idx,
+                         detail::index_list<Is...>)
+    {
+        return reference(std::get<Is>(data)[idx]...);
+    }
+
+    template <std::size_t... Is>
+    static pointers advance(const pointers& data, size_type count,
+                           detail::index_list<Is...>)
+    {
+        return pointers((std::get<Is>(data) + count)...);
+    }
+
+    pointers data_{};
+    size_type size_ = 0;
+};
+
+template <typename... Ts>
+constexpr std::size_t soa_span<Ts...>::columns;
+
+// Makes a soa_span from spans of the same size
+template <typename... Ts, std::size_t... Extents>
+soa_span<Ts...> make_soa_span(span<Ts, Extents>... columns)
+{
+    return soa_span<Ts...>(span<Ts>(columns)...);
+}
+
+namespace detail {
+
+// Rearranges column so that its element i is the previous element order[i]
+template <typename T, typename Index>
+void soa_permute_column(span<T> column, const Index* order,
+                        std::true_type /* trivially copyable */)
+{
+    std::vector<T> scratch(column.size());
+    gather(column, span<const Index>(order, column.size()),
+           span<T>(scratch.data(), scratch.size()));
+    std::copy(scratch.begin(), scratch.end(), column.begin());
+}
+
+template <typename T, typename Index>
+void soa_permute_column(span<T> column, const Index* order,
+                        std::false_type /* trivially copyable */)
+{
+    std::vector<T> scratch;
+    scratch.reserve(column.size());
+    for (std::size_t i = 0; i < column.size(); i++) {
+        scratch.push_back(std::move(column[order[i]]));
+    }
+    std::move(scratch.begin(), scratch.end(), column.begin());
+}
+
+template <typename Index, typename... Ts, std::size_t... Is>
+void soa_permute(const soa_span<Ts...>& s, const Index* order,
+                 index_list<Is...>)
+{
+    (void) swallow{
+        0, (soa_permute_column(
+                s.template column<Is>(), order,
+                std::is_trivially_copyable<
+                    typename soa_span<Ts...>::template column_type<Is>>{}),
+            0)...};
+}
+
+// Sorting by a comparison of the keys
+template <std::size_t I, typename Index, typename... Ts, typename Compare>
+void soa_sort(const soa_span<Ts...>& s, Compare& comp, std::false_type)
+{
+    const auto* keys = s.template column<I>().data();
+    std::vector<Index> order(s.size());
+    std::iota(order.begin(), order.end(), Index(0));
+    std::stable_sort(order.begin(), order.end(), [&](Index a, Index b) {
+        return comp(keys[a], keys[b]);
+    });
+    soa_permute(s, order.data(),
+                typename make_index_list<sizeof...(Ts)>::type{});
+}
+
+// Radix sorting a copy of the keys, carrying the row numbers along
+template <std::size_t I, typename Index, typename... Ts, typename Compare>
+void soa_sort(const soa_span<Ts...>& s, Compare&, std::true_type)
+{
+    using key_type = typename std::remove_cv<
+        typename soa_span<Ts...>::template column_type<I>>::type;
+    const auto column = s.template column<I>();
+    const std::size_t n = s.size();
+    std::vector<key_type> keys(column.begin(), column.end());
+    std::vector<key_type> key_scratch(n);
+    std::vector<Index> order(n);
+    std::vector<Index> order_scratch(n);
+    std::iota(order.begin(), order.end(), Index(0));
+    radix_sort(span<key_type>(keys.data(), n), span<Index>(order.data(), n),
+               span<key_type>(key_scratch.data(), n),
+               span<Index>(order_scratch.data(), n));
+    soa_permute(s, order.data(),
+                typename make_index_list<sizeof...(Ts)>::type{});
+}
+
+// Row numbers are held in 32 bits where possible
+template <std::size_t I, typename... Ts, typename Compare, typename Radix>
+void soa_sort_rows(const soa_span<Ts...>& s, Compare& comp, Radix radix)
+{
+    if (s.size() <= UINT32_MAX) {
+        soa_sort<I, std::uint32_t>(s, comp, radix);
+    } else {
+        soa_sort<I, std::size_t>(s, comp, radix);
+    }
+}
+
+template <typename... Ts>
+struct soa_is_mutable;
+
+template <>
+struct soa_is_mutable<> : std::true_type {};
+
+template <typename T, typename... Ts>
+struct soa_is_mutable<T, Ts...>
+    : std::integral_constant<bool, !std::is_const<T>::value &&
+                                       soa_is_mutable<Ts...>::value> {};
+
+// The rows compress_if() selects at a time, kept on the stack
+constexpr std::size_t soa_compress_batch = 256;
+
+// Copying forwards, which is safe in place as selected[k] >= k
+template <typename T, typename U>
+void soa_compress_column(span<T> in, span<U> out,
+                         const std::size_t* selected, std::size_t count)
+{
+    const T* src = in.data();
+    U* dst = out.data();
+    for (std::size_t k = 0; k < count; k++) {
+        dst[k] = src[selected[k]];
+    }
+}
+
+template <typename... Ts, typename... Us, std::size_t... Is>
+void soa_compress(const soa_span<Ts...>& in, const soa_span<Us...>& out,
+                  const std::size_t* selected, std::size_t count,
+                  index_list<Is...>)
+{
+    (void) swallow{0, (soa_compress_column(in.template column<Is>(),
+                                           out.template column<Is>(),
+                                           selected, count),
+                       0)...};
+}
+
+} // namespace detail
+
+// Sorts the rows of s by the values in column I, according to comp, keeping
+// rows with equivalent keys in their original order. The row order is
+// found from the keys alone, then each column is permuted once. Allocates
+// temporary storage for the row order and for one column at a time.
+template <std::size_t I, typename... Ts, typename Compare>
+void sort_by_column(soa_span<Ts...> s, Compare comp)
+{
+    static_assert(detail::soa_is_mutable<Ts...>::value,
+                  "sort_by_column() requires columns of mutable elements");
+    detail::soa_sort_rows<I>(s, comp, std::false_type{});
+}
+
+// Sorts the rows of s into ascending order of column I, stably. Integer and
+// floating-point keys are radix sorted, with the same ordering as
+// radix_sort(); other keys are compared with operator<. Allocates as the
+// overload taking a comparison does, plus a copy of the keys when radix
+// sorting.
+template <std::size_t I, typename... Ts>
+void sort_by_column(soa_span<Ts...> s)
+{
+    static_assert(detail::soa_is_mutable<Ts...>::value,
+                  "sort_by_column() requires columns of mutable elements");
+    using key_type = typename std::remove_cv<
+        typename soa_span<Ts...>::template column_type<I>>::type;
+    std::less<key_type> comp;
+    detail::soa_sort_rows<I>(
+        s, comp,
+        std::integral_constant<bool,
+                               detail::is_radix_sortable<key_type>::value>{});
+}
+
+// Copies the rows of in for which pred returns true to the start of out,
+// preserving their order, and returns the filled prefix of out. pred is
+// called with each row of in, as a tuple of references. out must be large
+// enough to hold every selected row; it may also be the same as in, to
+// filter the rows in place. Does not allocate.
+template <typename... Ts, typename... Us, typename Pred>
+soa_span<Us...> compress_if(soa_span<Ts...> in, soa_span<Us...> out,
+                            Pred pred)
+{
+    static_assert(
+        std::is_same<std::tuple<typename std::remove_cv<Ts>::type...>,
+                     std::tuple<Us...>>::value,
+        "compress_if() requires matching input and output column types");
+
+    using indices = typename detail::make_index_list<sizeof...(Ts)>::type;
+    const std::size_t n = in.size();
+    std::size_t count = 0;
+    for (std::size_t first = 0; first < n;
+         first += detail::soa_compress_batch) {
+        const std::size_t last =
+            (std::min)(n - first, detail::soa_compress_batch) + first;
+        // The selected row numbers, found without branching on pred
+        std::size_t selected[detail::soa_compress_batch];
+        std::size_t k = 0;
+        for (std::size_t i = first; i < last; i++) {
+            selected[k] = i;
+            k += static_cast<bool>(pred(in[i])) ? 1 : 0;
+        }
+        TCB_SPAN_EXPECT(k <= out.size() - count);
+        detail::soa_compress(in, out.subspan(count, k), selected, k,
+                             indices{});
+        count += k;
+    }
+    return out.first(count);
+}
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_SOA_SPAN_HPP_INCLUDED
@@ -0,0 +1,330 @@
+
+/*
+A view of a sorted span, providing fast branch-free searching
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_SORTED_SPAN_HPP_INCLUDED
+#define TCB_SORTED_SPAN_HPP_INCLUDED
+
+#include "prefetch.hpp"
+#include "span_ext.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+namespace detail {
+
+// Searches with fewer candidates than this finish with a linear scan
+constexpr std::size_t sorted_span_linear_threshold = 16;
+
+// Counts the elements of [first, first + n) which compare less than (or, if
+// OrEqual, not greater than) key. Specialised below to use SIMD comparisons
+// for common key types.
+template <typename T, typename Compare>
+struct linear_counter {
+    template <bool OrEqual>
+    static std::size_t count(const T* first, std::size_t n, const T& key,
+                             const Compare& comp)
+    {
+        std::size_t c = 0;
+        for (std::size_t i = 0; i < n; i++) {
+            c += OrEqual ? !comp(key, first[i]) : comp(first[i], key);
+        }
+        return c;
+    }
+};
+
+#if defined(TCB_SPAN_HAVE_SSE2)
+
+// Helpers for counting 32-bit lanes: cmp_lt(x, key) and cmp_gt(x, key)
+// return all-ones in each lane where the comparison holds
+struct sse2_int32_ops {
+    using type = std::int32_t;
+    static __m128i load(const type* p)
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
+    static __m128i splat(type v) { return _mm_set1_epi32(v); }
+    static __m128i cmp_lt(__m128i x, __m128i k)
+    {
+        return _mm_cmplt_epi32(x, k);
+    }
+    static __m128i cmp_gt(__m128i x, __m128i k)
+    {
+        return _mm_cmpgt_epi32(x, k);
+    }
+};
+
+struct sse2_uint32_ops {
+    using type = std::uint32_t;
+    // SSE2 only has signed comparisons: flip the sign bits
+    static __m128i bias(__m128i x)
+    {
+        return _mm_xor_si128(x, _mm_set1_epi32(INT32_MIN));
+    }
+    static __m128i load(const type* p)
+    {
+        return bias(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    }
+    static __m128i splat(type v)
+    {
+        return bias(_mm_set1_epi32(static_cast<int>(v)));
+    }
+    static __m128i cmp_lt(__m128i x, __m128i k)
+    {
+        return _mm_cmplt_epi32(x, k);
+    }
+    static __m128i cmp_gt(__m128i x, __m128i k)
+    {
+        return _mm_cmpgt_epi32(x, k);
+    }
+};
+
+struct sse2_float_ops {
+    using type = float;
+    static __m128i load(const type* p)
+    {
+        return _mm_castps_si128(_mm_loadu_ps(p));
+    }
+    static __m128i splat(type v) { return _mm_castps_si128(_mm_set1_ps(v)); }
+    static __m128i cmp_lt(__m128i x, __m128i k)
+    {
+        return _mm_castps_si128(
+            _mm_cmplt_ps(_mm_castsi128_ps(x), _mm_castsi128_ps(k)));
+    }
+    static __m128i cmp_gt(__m128i x, __m128i k)
+    {
+        return _mm_castps_si128(
+            _mm_cmpgt_ps(_mm_castsi128_ps(x), _mm_castsi128_ps(k)));
+    }
+};
+
+template <typename Ops>
+struct sse2_linear_counter {
+    using T = typename Ops::type;
+
+    template <bool OrEqual, typename Compare>
+    static std::size_t count(const T* first, std::size_t n, const T& key,
+                             const Compare&)
+    {
+        const __m128i k = Ops::splat(key);
+        std::size_t c = 0;
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            const __m128i x = Ops::load(first + i);
+            // x <= key is counted as !(x > key)
+            const __m128i m = OrEqual ? Ops::cmp_gt(x, k) : Ops::cmp_lt(x, k);
+            const int bits = popcount64(static_cast<std::uint64_t>(
+                _mm_movemask_ps(_mm_castsi128_ps(m))));
+            c += static_cast<std::size_t>(OrEqual ? 4 - bits : bits);
+        }
+        for (; i < n; i++) {
+            c += OrEqual ? !(key < first[i]) : first[i] < key;
+        }
+        return c;
+    }
+};
+
+template <>
+struct linear_counter<std::int32_t, std::less<std::int32_t>>
+    : sse2_linear_counter<sse2_int32_ops> {};
+
+template <>
+struct linear_counter<std::uint32_t, std::less<std::uint32_t>>
+    : sse2_linear_counter<sse2_uint32_ops> {};
+
+template <>
+struct linear_counter<float, std::less<float>>
+    : sse2_linear_counter<sse2_float_ops> {};
+
+#endif // TCB_SPAN_HAVE_SSE2
+
+// Branch-free binary search over [first, first + n), returning the first
+// element which is not less than (or if OrEqual, which is greater than) key.
+template <bool OrEqual, typename T, typename Compare>
+const T* sorted_search(const T* first, std::size_t n, const T& key,
+                       const Compare& comp)
+{
+    using counter = linear_counter<T, Compare>;
+    // Invariant: the result lies in [first, first + n]
+    while (n > sorted_span_linear_threshold) {
+        const std::size_t half = n / 2;
+        const bool before =
+            OrEqual ? !comp(key, first[half]) : comp(first[half], key);
+        first = before ? first + half : first;
+        n -= half;
+    }
+    return first + counter::template count<OrEqual>(first, n, key, comp);
+}
+
+// Performs keys.size() searches in lock-step. Each step of a search depends
+// on the previous one, so interleaving independent searches (and prefetching
+// their next probes) lets the CPU overlap their cache misses.
+template <bool OrEqual, typename T, typename Compare>
+void sorted_search_batch(const T* data, std::size_t size, const T* keys,
+                         std::size_t* out, std::size_t count,
+                         const Compare& comp)
+{
+    using counter = linear_counter<T, Compare>;
+    constexpr std::size_t group = 16;
+
+    for (std::size_t g = 0; g < count; g += group) {
+        const std::size_t m = (std::min)(group, count - g);
+        const T* base[group];
+        for (std::size_t j = 0; j < m; j++) {
+            base[j] = data;
+        }
+
+        std::size_t n = size;
+        while (n > sorted_span_linear_threshold) {
+            const std::size_t half = n / 2;
+            const std::size_t next_half = (n - half) / 2;
+            for (std::size_t j = 0; j < m; j++) {
+                const T& key = keys[g + j];
+                const bool before = OrEqual ? !comp(key, base[j][half])
+                                            : comp(base[j][half], key);
+                base[j] = before ? base[j] + half : base[j];
+                prefetch_line<0, 3>(
+                    reinterpret_cast<std::uintptr_t>(base[j] + next_half));
+            }
+            n -= half;
+        }
+
+        for (std::size_t j = 0; j < m; j++) {
+            const std::size_t c = counter::template count<OrEqual>(
+                base[j], n, keys[g + j], comp);
+            out[g + j] = static_cast<std::size_t>(base[j] - data) + c;
+        }
+    }
+}
+
+} // namespace detail
+
+// A span whose elements are known to be sorted according to Compare.
+// Searches use branch-free binary search, finishing with a (SIMD, where
+// possible) linear scan, and can be batched to overlap their memory accesses.
+template <typename ElementType,
+          typename Compare =
+              std::less<typename std::remove_cv<ElementType>::type>>
+class sorted_span {
+public:
+    using element_type = ElementType;
+    using value_type = typename std::remove_cv<ElementType>::type;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using pointer = element_type*;
+    using reference = element_type&;
+    using iterator = pointer;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using value_compare = Compare;
+
+    constexpr sorted_span() noexcept = default;
+
+    // The caller promises that s is sorted. This is checked (in linear time)
+    // when contract checking is enabled.
+    explicit sorted_span(span<element_type> s, Compare comp = Compare())
+        : span_(s), comp_(std::move(comp))
+    {
+        TCB_SPAN_EXPECT(std::is_sorted(s.begin(), s.end(), comp_));
+    }
+
+    // observers
+    constexpr span<element_type> as_span() const noexcept { return span_; }
+    constexpr size_type size() const noexcept { return span_.size(); }
+    TCB_SPAN_NODISCARD constexpr bool empty() const noexcept
+    {
+        return span_.empty();
+    }
+    constexpr pointer data() const noexcept { return span_.data(); }
+    value_compare value_comp() const { return comp_; }
+
+    TCB_SPAN_CONSTEXPR11 reference operator[](size_type idx) const
+    {
+        return span_[idx];
+    }
+
+    constexpr iterator begin() const noexcept { return span_.begin(); }
+    constexpr iterator end() const noexcept { return span_.end(); }
+    reverse_iterator rbegin() const noexcept { return span_.rbegin(); }
+    reverse_iterator rend() const noexcept { return span_.rend(); }
+
+    // searching
+    iterator lower_bound(const value_type& key) const
+    {
+        return search<false>(key);
+    }
+
+    iterator upper_bound(const value_type& key) const
+    {
+        return search<true>(key);
+    }
+
+    std::pair<iterator, iterator> equal_range(const value_type& key) const
+    {
+        const iterator first = lower_bound(key);
+        const value_type* last = detail::sorted_search<true>(
+            static_cast<const value_type*>(first),
+            static_cast<std::size_t>(end() - first), key, comp_);
+        return {first, first + (last - first)};
+    }
+
+    bool contains(const value_type& key) const
+    {
+        const iterator it = lower_bound(key);
+        return it != end() && !comp_(key, *it);
+    }
+
+    // Batched searches: sets out[i] to the index of lower_bound(keys[i]) (or
+    // upper_bound(keys[i])), and returns the written part of out.
+    template <typename K, std::size_t KeysExtent, std::size_t OutExtent>
+    span<std::size_t> lower_bound(span<K, KeysExtent> keys,
+                                  span<std::size_t, OutExtent> out) const
+    {
+        return search_batch<false>(keys, out);
+    }
+
+    template <typename K, std::size_t KeysExtent, std::size_t OutExtent>
+    span<std::size_t> upper_bound(span<K, KeysExtent> keys,
+                                  span<std::size_t, OutExtent> out) const
+    {
+        return search_batch<true>(keys, out);
+    }
+
+private:
+    template <bool OrEqual>
+    iterator search(const value_type& key) const
+    {
+        const value_type* p = detail::sorted_search<OrEqual>(
+            static_cast<const value_type*>(data()), size(), key, comp_);
+        return begin() + (p - data());
+    }
+
+    template <bool OrEqual, typename K, std::size_t KeysExtent,
+              std::size_t OutExtent>
+    span<std::size_t> search_batch(span<K, KeysExtent> keys,
+                                   span<std::size_t, OutExtent> out) const
+    {
+        static_assert(
+            std::is_same<typename std::remove_cv<K>::type, value_type>::value,
+            "Batched search keys must have the same type as the elements");
+        TCB_SPAN_EXPECT(keys.size() <= out.size());
+        detail::sorted_search_batch<OrEqual>(
+            static_cast<const value_type*>(data()), size(), keys.data(),
+            out.data(), keys.size(), comp_);
+        return out.first(keys.size());
+    }
+
+    span<element_type> span_{};
+    Compare comp_{};
+};
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_SORTED_SPAN_HPP_INCLUDED
@@ -0,0 +1,318 @@
+
+/*
+Common support code for the span extension headers: instruction set
+detection, runtime dispatch and some low-level helpers
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_SPAN_EXT_HPP_INCLUDED
+#define TCB_SPAN_EXT_HPP_INCLUDED
+
+#include "span.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <thread>
+#include <vector>
+
+// SIMD code paths are only provided for x86. Define TCB_SPAN_NO_SIMD to
+// disable them entirely and use the portable fallbacks.
+#if !defined(TCB_SPAN_NO_SIMD) &&                                              \
+    (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||            \
+     defined(_M_IX86))
+#define TCB_SPAN_HAVE_X86_SIMD
+#endif
+
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <immintrin.h>
+#endif
+
+// SSE2 is part of the x86-64 baseline, so it is used without dispatching
+#if defined(TCB_SPAN_HAVE_X86_SIMD) &&                                         \
+    (defined(__SSE2__) || defined(_M_X64) ||                                   \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define TCB_SPAN_HAVE_SSE2
+#endif
+
+// Functions using instruction sets beyond the compiler's baseline are marked
+// with TCB_SPAN_TARGET, and only called after checking detail::cpu().
+// MSVC allows any intrinsic to be used anywhere, so needs no annotation.
+#if defined(TCB_SPAN_HAVE_X86_SIMD) && (defined(__GNUC__) || defined(__clang__))
+#define TCB_SPAN_TARGET(isa) __attribute__((target(isa)))
+#else
+#define TCB_SPAN_TARGET(isa)
+#endif
+
+// Byte order of the target. Everything other than GCC-compatible compilers
+// reporting a big-endian target is assumed to be little-endian.
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) &&               \
+    __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define TCB_SPAN_BIG_ENDIAN
+#endif
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+namespace detail {
+
+struct cpu_features {
+    bool sse2 = false;
+    bool ssse3 = false;
+    bool sse41 = false;
+    bool sse42 = false;
+    bool pclmul = false;
+    bool popcnt = false;
+    bool avx = false;
+    bool avx2 = false;
+    bool bmi2 = false;
+    bool f16c = false;
+    bool avx512f = false;
+    bool avx512bw = false;
+    bool avx512vl = false;
+    bool avx512vbmi = false;
+};
+
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+
+inline void cpuid(unsigned leaf, unsigned subleaf, unsigned (&regs)[4])
+{
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuidex(r, static_cast<int>(leaf), static_cast<int>(subleaf));
+    for (int i = 0; i < 4; i++) {
+        regs[i] = static_cast<unsigned>(r[i]);
+    }
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// Which register states the OS saves on a context switch
+inline std::uint64_t xgetbv0()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned eax = 0;
+    unsigned edx = 0;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<std::uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+inline cpu_features detect_cpu_features()
+{
+    cpu_features f;
+    unsigned r[4] = {};
+    cpuid(0, 0, r);
+    const unsigned max_leaf = r[0];
+    if (max_leaf < 1) {
+        return f;
+    }
+
+    cpuid(1, 0, r);
+    const unsigned ecx1 = r[2];
+    const unsigned edx1 = r[3];
+    f.sse2 = (edx1 >> 26) & 1;
+    f.ssse3 = (ecx1 >> 9) & 1;
+    f.sse41 = (ecx1 >> 19) & 1;
+    f.sse42 = (ecx1 >> 20) & 1;
+    f.pclmul = (ecx1 >> 1) & 1;
+    f.popcnt = (ecx1 >> 23) & 1;
+
+    const bool osxsave = (ecx1 >> 27) & 1;
+    const std::uint64_t xcr0 = osxsave ? xgetbv0() : 0;
+    const bool ymm_state = (xcr0 & 0x6) == 0x6;
+    const bool zmm_state = (xcr0 & 0xe6) == 0xe6;
+
+    f.avx = ymm_state && ((ecx1 >> 28) & 1);
+    f.f16c = f.avx && ((ecx1 >> 29) & 1);
+
+    if (max_leaf >= 7) {
+        cpuid(7, 0, r);
+        const unsigned ebx7 = r[1];
+        const unsigned ecx7 = r[2];
+        f.avx2 = f.avx && ((ebx7 >> 5) & 1);
+        f.bmi2 = (ebx7 >> 8) & 1;
+        f.avx512f = zmm_state && ((ebx7 >> 16) & 1);
+        f.avx512bw = f.avx512f && ((ebx7 >> 30) & 1);
+        f.avx512vl = f.avx512f && ((ebx7 >> 31) & 1);
+        f.avx512vbmi = f.avx512f && ((ecx7 >> 1) & 1);
+    }
+    return f;
+}
+
+#else
+
+inline cpu_features detect_cpu_features() { return cpu_features{}; }
+
+#endif // TCB_SPAN_HAVE_X86_SIMD
+
+// The instruction sets available on the running CPU, detected on first use
+inline const cpu_features& cpu()
+{
+    static const cpu_features features = detect_cpu_features();
+    return features;
+}
+
+// Portable bit manipulation helpers
+
+inline int popcount64(std::uint64_t x) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555u);
+    x = (x & 0x3333333333333333u) + ((x >> 2) & 0x3333333333333333u);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fu;
+    return static_cast<int>((x * 0x0101010101010101u) >> 56);
+#endif
+}
+
+// Count trailing zeros. x must not be zero.
+inline int ctz64(std::uint64_t x) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long idx;
+    _BitScanForward64(&idx, x);
+    return static_cast<int>(idx);
+#else
+    int n = 0;
+    while ((x & 1) == 0) {
+        x >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+// Count leading zeros. x must not be zero.
+inline int clz64(std::uint64_t x) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_clzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long idx;
+    _BitScanReverse64(&idx, x);
+    return 63 - static_cast<int>(idx);
+#else
+    int n = 0;
+    while ((x >> 63) == 0) {
+        x <<= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+// Loads of little-endian integers from possibly unaligned memory
+
+inline std::uint32_t load_le32(const unsigned char* p) noexcept
+{
+#if defined(TCB_SPAN_BIG_ENDIAN)
+    return static_cast<std::uint32_t>(p[0]) |
+           static_cast<std::uint32_t>(p[1]) << 8 |
+           static_cast<std::uint32_t>(p[2]) << 16 |
+           static_cast<std::uint32_t>(p[3]) << 24;
+#else
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+#endif
+}
+
+inline std::uint64_t load_le64(const unsigned char* p) noexcept
+{
+#if defined(TCB_SPAN_BIG_ENDIAN)
+    return static_cast<std::uint64_t>(load_le32(p)) |
+           static_cast<std::uint64_t>(load_le32(p + 4)) << 32;
+#else
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+#endif
+}
+
+// std::index_sequence, which is not available in C++11
+template <std::size_t... Is>
+struct index_list {};
+
+template <std::size_t N, std::size_t... Is>
+struct make_index_list : make_index_list<N - 1, N - 1, Is...> {};
+
+template <std::size_t... Is>
+struct make_index_list<0, Is...> {
+    using type = index_list<Is...>;
+};
+
+// An element size as a type, for choosing overloads by sizeof(T)
+template <std::size_t Size>
+using byte_size_constant = std::integral_constant<std::size_t, Size>;
+
+// Whether all of sizes equal size, so that several spans can be checked
+// against each other with a single contract check
+inline bool all_equal(std::size_t size,
+                      std::initializer_list<std::size_t> sizes)
+{
+    for (std::size_t s : sizes) {
+        if (s != size) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Threading helpers for the parallel algorithms
+
+// Joins a set of threads on scope exit
+struct thread_joiner {
+    std::vector<std::thread>& threads;
+
+    ~thread_joiner()
+    {
+        for (std::thread& t : threads) {
+            if (t.joinable()) {
+                t.join();
+            }
+        }
+    }
+};
+
+// Calls f(0), ..., f(count - 1) concurrently, with f(0) on the calling thread
+template <typename F>
+void run_concurrently(unsigned count, const F& f)
+{
+    std::vector<std::thread> threads;
+    threads.reserve(count - 1);
+    thread_joiner joiner{threads};
+    for (unsigned c = 1; c < count; c++) {
+        threads.emplace_back(f, c);
+    }
+    f(0u);
+}
+
+} // namespace detail
+
+// The result of an encoding or decoding step: the prefix of the input which
+// was consumed, and the prefix of the output which was produced. Codecs stop
+// early rather than failing when the output is full, so that they can be
+// driven with fixed-size buffers.
+template <typename In, typename Out>
+struct codec_result {
+    span<In> consumed;
+    span<Out> produced;
+};
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_SPAN_EXT_HPP_INCLUDED
@@ -0,0 +1,300 @@
+
+/*
+Lazy splitting of spans on a delimiter, and iteration over lines of text
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_SPLIT_HPP_INCLUDED
+#define TCB_SPLIT_HPP_INCLUDED
+
+#include "span_ext.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+namespace detail {
+
+// Byte-sized elements which compare equal exactly when their bytes do are
+// searched with SIMD comparisons
+template <typename T, typename U = typename std::remove_cv<T>::type>
+struct is_byte_like
+    : std::integral_constant<bool, (std::is_integral<U>::value &&
+                                    sizeof(U) == 1) ||
+                                       std::is_same<U, byte>::value> {};
+
+// A bitmask of the bytes of [p, p + n), for n <= 64, equal to c
+inline std::uint64_t match_mask_scalar(const unsigned char* p, std::size_t n,
+                                       unsigned char c) noexcept
+{
+    std::uint64_t mask = 0;
+    for (std::size_t i = 0; i < n; i++) {
+        mask |= static_cast<std::uint64_t>(p[i] == c) << i;
+    }
+    return mask;
+}
+
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+
+TCB_SPAN_TARGET("avx2")
+inline std::uint64_t match_mask_avx2(const unsigned char* p,
+                                     unsigned char c) noexcept
+{
+    const __m256i v = _mm256_set1_epi8(static_cast<char>(c));
+    const __m256i* q = reinterpret_cast<const __m256i*>(p);
+    const auto lo = static_cast<std::uint32_t>(_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_loadu_si256(q), v)));
+    const auto hi = static_cast<std::uint32_t>(_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_loadu_si256(q + 1), v)));
+    return static_cast<std::uint64_t>(hi) << 32 | lo;
+}
+
+#endif // TCB_SPAN_HAVE_X86_SIMD
+
+#if defined(TCB_SPAN_HAVE_SSE2)
+
+inline std::uint64_t match_mask_sse2(const unsigned char* p,
+                                     unsigned char c) noexcept
+{
+    const __m128i v = _mm_set1_epi8(static_cast<char>(c));
+    std::uint64_t mask = 0;
+    for (unsigned j = 0; j < 4; j++) {
+        const __m128i b =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * j));
+        mask |= static_cast<std::uint64_t>(
+                    _mm_movemask_epi8(_mm_cmpeq_epi8(b, v)))
+                << (16 * j);
+    }
+    return mask;
+}
+
+#endif // TCB_SPAN_HAVE_SSE2
+
+// Finds successive occurrences of a delimiter. The matches within a 64-byte
+// block are found at once as a bitmask, which is kept for the following
+// searches, so that short tokens cost a bit scan rather than a fresh search.
+template <typename T, bool = is_byte_like<T>::value>
+class delimiter_finder {
+public:
+    delimiter_finder() = default;
+
+    delimiter_finder(const T* data, std::size_t size, T delim) noexcept
+        : data_(reinterpret_cast<const unsigned char*>(data)), size_(size),
+          delim_(static_cast<unsigned char>(delim))
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+          ,
+          avx2_(cpu().avx2)
+#endif
+    {
+        mask_ = load(0);
+    }
+
+    // The index of the first delimiter at or after from, or size
+    std::size_t find(std::size_t from) noexcept
+    {
+        if (from >= size_) {
+            return size_;
+        }
+        if (from < block_ || from - block_ >= 64) {
+            block_ = from;
+            mask_ = load(from);
+        } else {
+            mask_ &= ~std::uint64_t{0} << (from - block_);
+        }
+        while (mask_ == 0) {
+            block_ += 64;
+            if (block_ >= size_) {
+                return size_;
+            }
+            mask_ = load(block_);
+        }
+        return block_ + static_cast<std::size_t>(ctz64(mask_));
+    }
+
+private:
+    std::uint64_t load(std::size_t pos) const noexcept
+    {
+        const unsigned char* p = data_ + pos;
+        const std::size_t n = size_ - pos;
+        if (n < 64) {
+            return match_mask_scalar(p, n, delim_);
+        }
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+        if (avx2_) {
+            return match_mask_avx2(p, delim_);
+        }
+#endif
+#if defined(TCB_SPAN_HAVE_SSE2)
+        return match_mask_sse2(p, delim_);
+#else
+        return match_mask_scalar(p, 64, delim_);
+#endif
+    }
+
+    const unsigned char* data_ = nullptr;
+    std::size_t size_ = 0;
+    unsigned char delim_ = 0;
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+    bool avx2_ = false;
+#endif
+    std::size_t block_ = 0;
+    std::uint64_t mask_ = 0;
+};
+
+template <typename T>
+class delimiter_finder<T, false> {
+public:
+    using value_type = typename std::remove_cv<T>::type;
+
+    delimiter_finder() = default;
+
+    delimiter_finder(T* data, std::size_t size, const value_type& delim)
+        : data_(data), size_(size), delim_(delim)
+    {}
+
+    std::size_t find(std::size_t from)
+    {
+        if (from >= size_) {
+            return size_;
+        }
+        return static_cast<std::size_t>(
+            std::find(data_ + from, data_ + size_, delim_) - data_);
+    }
+
+private:
+    T* data_ = nullptr;
+    std::size_t size_ = 0;
+    value_type delim_{};
+};
+
+enum class split_mode { fields, lines };
+
+} // namespace detail
+
+// A lazily evaluated range of the subspans of a span separated by a
+// delimiter, as returned by split() and lines()
+template <typename T>
+class split_view {
+public:
+    using delimiter_type = typename std::remove_cv<T>::type;
+
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = span<T>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const span<T>*;
+        using reference = span<T>;
+
+        iterator() = default;
+
+        reference operator*() const
+        {
+            span<T> token = data_.subspan(pos_, end_ - pos_);
+            if (mode_ == detail::split_mode::lines && !token.empty() &&
+                token[token.size() - 1] == static_cast<T>('\r')) {
+                token = token.first(token.size() - 1);
+            }
+            return token;
+        }
+
+        iterator& operator++()
+        {
+            if (end_ == data_.size() ||
+                (mode_ == detail::split_mode::lines &&
+                 end_ + 1 == data_.size())) {
+                pos_ = end_ = data_.size() + 1;
+            } else {
+                pos_ = end_ + 1;
+                end_ = finder_.find(pos_);
+            }
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        friend bool operator==(const iterator& a, const iterator& b)
+        {
+            return a.pos_ == b.pos_;
+        }
+
+        friend bool operator!=(const iterator& a, const iterator& b)
+        {
+            return !(a == b);
+        }
+
+    private:
+        friend class split_view;
+
+        iterator(span<T> data, const delimiter_type& delim,
+                 detail::split_mode mode)
+            : data_(data), finder_(data.data(), data.size(), delim),
+              mode_(mode)
+        {
+            if (data.empty()) {
+                pos_ = end_ = 1;
+            } else {
+                end_ = finder_.find(0);
+            }
+        }
+
+        // The end iterator
+        explicit iterator(span<T> data)
+            : data_(data), pos_(data.size() + 1), end_(data.size() + 1)
+        {}
+
+        span<T> data_{};
+        detail::delimiter_finder<T> finder_{};
+        detail::split_mode mode_ = detail::split_mode::fields;
+        std::size_t pos_ = 0;
+        std::size_t end_ = 0;
+    };
+
+    split_view(span<T> data, const delimiter_type& delim,
+               detail::split_mode mode = detail::split_mode::fields)
+        : data_(data), delim_(delim), mode_(mode)
+    {}
+
+    iterator begin() const { return iterator(data_, delim_, mode_); }
+    iterator end() const { return iterator(data_); }
+
+private:
+    span<T> data_;
+    delimiter_type delim_;
+    detail::split_mode mode_;
+};
+
+// Splits data on every occurrence of delim, yielding the subspans between
+// them without copying or allocating. As with std::views::split, n
+// delimiters give n + 1 (possibly empty) subspans, and an empty span gives
+// none. Delimiters of byte-sized element types are found 64 bytes at a time
+// with SIMD comparisons.
+template <typename T, std::size_t Extent>
+split_view<T> split(span<T, Extent> data,
+                    const typename std::remove_cv<T>::type& delim)
+{
+    return split_view<T>(data, delim);
+}
+
+// Splits text into lines, which may end in "\n" or "\r\n". The line endings
+// are not included, and there is no empty line after a final line ending.
+template <typename C, std::size_t Extent>
+split_view<C> lines(span<C, Extent> text)
+{
+    static_assert(std::is_same<typename std::remove_cv<C>::type, char>::value,
+                  "lines() requires a span of char");
+    return split_view<C>(text, '\n', detail::split_mode::lines);
+}
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_SPLIT_HPP_INCLUDED
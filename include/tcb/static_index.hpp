@@ -0,0 +1,164 @@
+
+/*
+A read-only search index over a sorted span, laid out as an implicit B+ tree
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_STATIC_INDEX_HPP_INCLUDED
+#define TCB_STATIC_INDEX_HPP_INCLUDED
+
+#include "sorted_span.hpp"
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+
+// A static search tree (an "S+ tree") over a sorted span of keys.
+//
+// The keys themselves form the leaves of the tree, in blocks of node_size
+// elements. The internal levels are built into a separate storage span: each
+// node is node_size keys (one cache line, for small T) which separate its
+// node_size + 1 children, and nodes are addressed arithmetically rather than
+// through pointers. A search therefore touches one cache line per level,
+// rather than one per comparison as in a binary search, and each node is
+// scanned with SIMD comparisons where possible.
+//
+// Searches return indices into the original span of keys. The index does not
+// own any memory: both the keys and the storage must outlive it.
+template <typename T, typename Compare = std::less<T>>
+class static_index {
+    static_assert(!std::is_const<T>::value,
+                  "static_index requires a non-const key type");
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using value_compare = Compare;
+
+    static constexpr size_type node_size =
+        sizeof(T) > cache_line_size / 4 ? 4 : cache_line_size / sizeof(T);
+
+    // The number of elements of storage needed to index size keys
+    static size_type storage_size(size_type size) noexcept
+    {
+        size_type total = 0;
+        size_type nodes = (size + node_size - 1) / node_size;
+        while (nodes > 1) {
+            nodes = (nodes + node_size) / (node_size + 1);
+            total += nodes * node_size;
+        }
+        return total;
+    }
+
+    static_index() noexcept = default;
+
+    // Builds the index for keys into storage, which must have at least
+    // storage_size(keys.size()) elements. keys must be sorted according to
+    // comp; this is checked when contract checking is enabled.
+    static_index(span<const T> keys, span<T> storage, Compare comp = Compare())
+        : keys_(keys), comp_(std::move(comp))
+    {
+        TCB_SPAN_EXPECT(std::is_sorted(keys.begin(), keys.end(), comp_));
+        TCB_SPAN_EXPECT(storage_size(keys.size()) <= storage.size());
+
+        if (keys.empty()) {
+            return;
+        }
+
+        // Level 0 is the keys themselves; find the size of each level above
+        nodes_[0] = (keys.size() + node_size - 1) / node_size;
+        while (nodes_[height_] > 1) {
+            nodes_[height_ + 1] =
+                (nodes_[height_] + node_size) / (node_size + 1);
+            ++height_;
+        }
+
+        // Store the root first, so that the top levels share cache lines
+        size_type offset = 0;
+        for (size_type h = height_; h > 0; --h) {
+            offsets_[h] = offset;
+            offset += nodes_[h] * node_size;
+        }
+        storage_ = storage.first(offset);
+
+        // Each key of an internal node is the first key under its right-hand
+        // child. Keys for children past the end repeat the last key; searches
+        // which would descend into such a child are clamped to the last one.
+        size_type stride = node_size;
+        for (size_type h = 1; h <= height_; h++) {
+            T* node = storage.data() + offsets_[h];
+            for (size_type k = 0; k < nodes_[h]; k++) {
+                for (size_type i = 0; i < node_size; i++) {
+                    const size_type first =
+                        (k * (node_size + 1) + i + 1) * stride;
+                    *node++ = first < keys.size() ? keys[first] : keys.back();
+                }
+            }
+            stride *= node_size + 1;
+        }
+    }
+
+    // observers
+    span<const T> keys() const noexcept { return keys_; }
+    span<const T> storage() const noexcept { return storage_; }
+    size_type size() const noexcept { return keys_.size(); }
+    TCB_SPAN_NODISCARD bool empty() const noexcept { return keys_.empty(); }
+    value_compare value_comp() const { return comp_; }
+
+    // searching: each returns an index into keys()
+    size_type lower_bound(const T& key) const { return search<false>(key); }
+
+    size_type upper_bound(const T& key) const { return search<true>(key); }
+
+    std::pair<size_type, size_type> equal_range(const T& key) const
+    {
+        return {lower_bound(key), upper_bound(key)};
+    }
+
+    bool contains(const T& key) const
+    {
+        const size_type i = lower_bound(key);
+        return i != size() && !comp_(key, keys_[i]);
+    }
+
+private:
+    using counter = detail::linear_counter<T, Compare>;
+
+    template <bool OrEqual>
+    size_type search(const T& key) const
+    {
+        if (keys_.empty()) {
+            return 0;
+        }
+
+        size_type k = 0;
+        for (size_type h = height_; h > 0; --h) {
+            const T* node = storage_.data() + offsets_[h] + k * node_size;
+            const size_type child = k * (node_size + 1) +
+                counter::template count<OrEqual>(node, node_size, key, comp_);
+            k = (std::min)(child, nodes_[h - 1] - 1);
+        }
+
+        const size_type first = k * node_size;
+        const size_type rest = size() - first;
+        const size_type n = rest < node_size ? rest : node_size;
+        return first + counter::template count<OrEqual>(keys_.data() + first,
+                                                        n, key, comp_);
+    }
+
+    // Enough levels for any size_type number of keys
+    static constexpr size_type max_height = 8 * sizeof(size_type) / 2;
+
+    span<const T> keys_{};
+    span<const T> storage_{};
+    size_type height_ = 0;
+    size_type nodes_[max_height + 1] = {};
+    size_type offsets_[max_height + 1] = {};
+    Compare comp_{};
+};
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_STATIC_INDEX_HPP_INCLUDED
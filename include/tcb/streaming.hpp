@@ -0,0 +1,260 @@
+
+/*
+Cache-bypassing copy and fill operations for large spans
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_STREAMING_HPP_INCLUDED
+#define TCB_STREAMING_HPP_INCLUDED
+
+#include "span_ext.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+// Below this many bytes, copy_streaming() and fill_streaming() use ordinary
+// (cached) stores
+#ifndef TCB_SPAN_STREAMING_THRESHOLD
+#define TCB_SPAN_STREAMING_THRESHOLD (std::size_t{1} << 20)
+#endif
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+
+TCB_SPAN_INLINE_VAR constexpr std::size_t default_streaming_threshold =
+    TCB_SPAN_STREAMING_THRESHOLD;
+
+namespace detail {
+
+// Width of the widest non-temporal store, and so the alignment we aim for
+constexpr std::size_t stream_block = 64;
+
+// The kernels below require dst to be aligned to stream_block, and n to be
+// a multiple of it
+#if defined(TCB_SPAN_HAVE_SSE2)
+
+inline void stream_copy_sse2(unsigned char* dst, const unsigned char* src,
+                             std::size_t n)
+{
+    for (std::size_t i = 0; i < n; i += stream_block) {
+        const __m128i a = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(src + i));
+        const __m128i b = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(src + i + 16));
+        const __m128i c = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(src + i + 32));
+        const __m128i d = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(src + i + 48));
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i), a);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 16), b);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 32), c);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 48), d);
+    }
+}
+
+TCB_SPAN_TARGET("avx")
+inline void stream_copy_avx(unsigned char* dst, const unsigned char* src,
+                            std::size_t n)
+{
+    for (std::size_t i = 0; i < n; i += stream_block) {
+        const __m256i a = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(src + i));
+        const __m256i b = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(src + i + 32));
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i), a);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i + 32), b);
+    }
+}
+
+TCB_SPAN_TARGET("avx512f")
+inline void stream_copy_avx512(unsigned char* dst, const unsigned char* src,
+                               std::size_t n)
+{
+    for (std::size_t i = 0; i < n; i += stream_block) {
+        const __m512i a = _mm512_loadu_si512(src + i);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + i), a);
+    }
+}
+
+inline void stream_fill_sse2(unsigned char* dst, const unsigned char* pattern,
+                             std::size_t n)
+{
+    const __m128i* p = reinterpret_cast<const __m128i*>(pattern);
+    const __m128i a = _mm_loadu_si128(p);
+    const __m128i b = _mm_loadu_si128(p + 1);
+    const __m128i c = _mm_loadu_si128(p + 2);
+    const __m128i d = _mm_loadu_si128(p + 3);
+    for (std::size_t i = 0; i < n; i += stream_block) {
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i), a);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 16), b);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 32), c);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 48), d);
+    }
+}
+
+TCB_SPAN_TARGET("avx")
+inline void stream_fill_avx(unsigned char* dst, const unsigned char* pattern,
+                            std::size_t n)
+{
+    const __m256i a =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pattern));
+    const __m256i b =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pattern + 32));
+    for (std::size_t i = 0; i < n; i += stream_block) {
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i), a);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i + 32), b);
+    }
+}
+
+TCB_SPAN_TARGET("avx512f")
+inline void stream_fill_avx512(unsigned char* dst,
+                               const unsigned char* pattern, std::size_t n)
+{
+    const __m512i a = _mm512_loadu_si512(pattern);
+    for (std::size_t i = 0; i < n; i += stream_block) {
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + i), a);
+    }
+}
+
+#endif // TCB_SPAN_HAVE_SSE2
+
+inline void stream_copy_aligned(unsigned char* dst, const unsigned char* src,
+                                std::size_t n)
+{
+#if defined(TCB_SPAN_HAVE_SSE2)
+    const cpu_features& features = cpu();
+    if (features.avx512f) {
+        stream_copy_avx512(dst, src, n);
+    } else if (features.avx) {
+        stream_copy_avx(dst, src, n);
+    } else {
+        stream_copy_sse2(dst, src, n);
+    }
+    // Non-temporal stores are weakly ordered: make them visible before
+    // anything we write afterwards
+    _mm_sfence();
+#else
+    std::memcpy(dst, src, n);
+#endif
+}
+
+// pattern holds stream_block bytes, to be repeated throughout dst
+inline void stream_fill_aligned(unsigned char* dst,
+                                const unsigned char* pattern, std::size_t n)
+{
+#if defined(TCB_SPAN_HAVE_SSE2)
+    const cpu_features& features = cpu();
+    if (features.avx512f) {
+        stream_fill_avx512(dst, pattern, n);
+    } else if (features.avx) {
+        stream_fill_avx(dst, pattern, n);
+    } else {
+        stream_fill_sse2(dst, pattern, n);
+    }
+    _mm_sfence();
+#else
+    for (std::size_t i = 0; i < n; i += stream_block) {
+        std::memcpy(dst + i, pattern, stream_block);
+    }
+#endif
+}
+
+// The number of leading elements of a span starting at p which must be
+// handled separately so that the remainder starts on a stream_block boundary
+template <typename T>
+std::size_t stream_head_size(const T* p)
+{
+    const std::size_t misalign =
+        reinterpret_cast<std::uintptr_t>(p) % stream_block;
+    return ((stream_block - misalign) % stream_block) / sizeof(T);
+}
+
+} // namespace detail
+
+// Copies the contents of src into the start of dst, which must not overlap,
+// and returns the written part of dst. If the data is at least threshold
+// bytes long, non-temporal stores are used so that the destination does not
+// displace the existing contents of the cache.
+template <typename T, std::size_t SrcExtent, typename U, std::size_t DstExtent>
+span<U> copy_streaming(span<T, SrcExtent> src, span<U, DstExtent> dst,
+                       std::size_t threshold = default_streaming_threshold)
+{
+    static_assert(std::is_same<typename std::remove_cv<T>::type, U>::value,
+                  "copy_streaming() requires matching element types");
+    static_assert(std::is_trivially_copyable<U>::value,
+                  "copy_streaming() requires a trivially copyable type");
+    TCB_SPAN_EXPECT(src.size() <= dst.size());
+
+    const span<U> out = dst.first(src.size());
+    if (out.empty()) {
+        return out;
+    }
+    if (out.size_bytes() < threshold) {
+        std::memcpy(out.data(), src.data(), out.size_bytes());
+        return out;
+    }
+
+    const span<const byte> from = as_bytes(src);
+    const span<byte> to = as_writable_bytes(out);
+    const std::size_t head =
+        (std::min)(detail::stream_head_size(to.data()), to.size());
+    const std::size_t body =
+        (to.size() - head) / detail::stream_block * detail::stream_block;
+
+    std::memcpy(to.data(), from.data(), head);
+    detail::stream_copy_aligned(
+        reinterpret_cast<unsigned char*>(to.subspan(head, body).data()),
+        reinterpret_cast<const unsigned char*>(from.subspan(head).data()),
+        body);
+    const span<byte> tail = to.subspan(head + body);
+    std::memcpy(tail.data(), from.subspan(head + body).data(), tail.size());
+    return out;
+}
+
+// Sets every element of dst to value. As with copy_streaming(), spans of at
+// least threshold bytes are written with non-temporal stores. This requires
+// the element size to be a power of two no larger than 64 bytes; other
+// element types are always filled using ordinary stores.
+template <typename T, std::size_t Extent>
+span<T, Extent>
+fill_streaming(span<T, Extent> dst,
+               const typename span<T, Extent>::value_type& value,
+               std::size_t threshold = default_streaming_threshold)
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "fill_streaming() requires a trivially copyable type");
+
+    constexpr bool can_stream = sizeof(T) <= detail::stream_block &&
+                                detail::stream_block % sizeof(T) == 0;
+    if (!can_stream || dst.size_bytes() < threshold ||
+        reinterpret_cast<std::uintptr_t>(dst.data()) % sizeof(T) != 0) {
+        std::fill(dst.begin(), dst.end(), value);
+        return dst;
+    }
+
+    unsigned char pattern[detail::stream_block];
+    for (std::size_t i = 0; i < detail::stream_block; i += sizeof(T)) {
+        std::memcpy(pattern + i, &value, sizeof(T));
+    }
+
+    const std::size_t head =
+        (std::min)(detail::stream_head_size(dst.data()), dst.size());
+    const std::size_t per_block = detail::stream_block / sizeof(T);
+    const std::size_t body = (dst.size() - head) / per_block * per_block;
+
+    const span<T> head_span = dst.first(head);
+    std::fill(head_span.begin(), head_span.end(), value);
+    detail::stream_fill_aligned(
+        reinterpret_cast<unsigned char*>(dst.subspan(head, body).data()),
+        pattern, body * sizeof(T));
+    const span<T> tail_span = dst.subspan(head + body);
+    std::fill(tail_span.begin(), tail_span.end(), value);
+    return dst;
+}
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_STREAMING_HPP_INCLUDED
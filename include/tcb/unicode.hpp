@@ -0,0 +1,653 @@
+
+/*
+UTF-8 validation, and transcoding between UTF-8, UTF-16 and UTF-32 spans
+*/
+
+//          Copyright Tristan Brindle 2019.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file ../../LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TCB_UNICODE_HPP_INCLUDED
+#define TCB_UNICODE_HPP_INCLUDED
+
+#include "span_ext.hpp"
+
+namespace TCB_SPAN_NAMESPACE_NAME {
+namespace detail {
+
+// The element types which may hold UTF-8
+template <typename T>
+struct is_utf8_char : std::false_type {};
+template <>
+struct is_utf8_char<char> : std::true_type {};
+template <>
+struct is_utf8_char<unsigned char> : std::true_type {};
+#if defined(__cpp_char8_t)
+template <>
+struct is_utf8_char<char8_t> : std::true_type {};
+#endif
+
+template <typename C>
+const unsigned char* utf8_bytes(span<C> s) noexcept
+{
+    static_assert(is_utf8_char<typename std::remove_cv<C>::type>::value,
+                  "UTF-8 text must be a span of char, unsigned char or "
+                  "char8_t");
+    return reinterpret_cast<const unsigned char*>(s.data());
+}
+
+// Decodes the sequence at the start of [p, p + n), for n > 0. Returns its
+// length, or 0 if it is invalid or incomplete: overlong forms, surrogates
+// and values beyond U+10FFFF are all rejected.
+inline unsigned utf8_decode(const unsigned char* p, std::size_t n,
+                            std::uint32_t& cp) noexcept
+{
+    const unsigned b0 = p[0];
+    if (b0 < 0x80) {
+        cp = b0;
+        return 1;
+    }
+    const auto cont = [](unsigned char b) { return (b & 0xc0) == 0x80; };
+    if (b0 < 0xc2) {
+        return 0;
+    }
+    if (b0 < 0xe0) {
+        if (n < 2 || !cont(p[1])) {
+            return 0;
+        }
+        cp = (b0 & 0x1f) << 6 | (p[1] & 0x3fu);
+        return 2;
+    }
+    if (b0 < 0xf0) {
+        // The second byte range excludes overlong forms and surrogates
+        const unsigned lo = b0 == 0xe0 ? 0xa0 : 0x80;
+        const unsigned hi = b0 == 0xed ? 0x9f : 0xbf;
+        if (n < 3 || p[1] < lo || p[1] > hi || !cont(p[2])) {
+            return 0;
+        }
+        cp = (b0 & 0x0f) << 12 | (p[1] & 0x3fu) << 6 | (p[2] & 0x3fu);
+        return 3;
+    }
+    if (b0 < 0xf5) {
+        const unsigned lo = b0 == 0xf0 ? 0x90 : 0x80;
+        const unsigned hi = b0 == 0xf4 ? 0x8f : 0xbf;
+        if (n < 4 || p[1] < lo || p[1] > hi || !cont(p[2]) || !cont(p[3])) {
+            return 0;
+        }
+        cp = (b0 & 0x07) << 18 | (p[1] & 0x3fu) << 12 | (p[2] & 0x3fu) << 6 |
+             (p[3] & 0x3fu);
+        return 4;
+    }
+    return 0;
+}
+
+// Encodes a valid code point, returning its length
+inline unsigned utf8_encode(std::uint32_t cp, unsigned char* out) noexcept
+{
+    if (cp < 0x80) {
+        out[0] = static_cast<unsigned char>(cp);
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = static_cast<unsigned char>(0xc0 | cp >> 6);
+        out[1] = static_cast<unsigned char>(0x80 | (cp & 0x3f));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = static_cast<unsigned char>(0xe0 | cp >> 12);
+        out[1] = static_cast<unsigned char>(0x80 | (cp >> 6 & 0x3f));
+        out[2] = static_cast<unsigned char>(0x80 | (cp & 0x3f));
+        return 3;
+    }
+    out[0] = static_cast<unsigned char>(0xf0 | cp >> 18);
+    out[1] = static_cast<unsigned char>(0x80 | (cp >> 12 & 0x3f));
+    out[2] = static_cast<unsigned char>(0x80 | (cp >> 6 & 0x3f));
+    out[3] = static_cast<unsigned char>(0x80 | (cp & 0x3f));
+    return 4;
+}
+
+inline unsigned utf8_length(std::uint32_t cp) noexcept
+{
+    return cp < 0x80 ? 1 : cp < 0x800 ? 2 : cp < 0x10000 ? 3 : 4;
+}
+
+inline bool utf8_valid_scalar(const unsigned char* p, std::size_t n) noexcept
+{
+    std::size_t i = 0;
+    while (i < n) {
+        // Skip ASCII a word at a time
+        std::uint64_t w;
+        if (n - i >= 8 &&
+            (std::memcpy(&w, p + i, 8), (w & 0x8080808080808080u) == 0)) {
+            i += 8;
+            continue;
+        }
+        std::uint32_t cp;
+        const unsigned len = utf8_decode(p + i, n - i, cp);
+        if (len == 0) {
+            return false;
+        }
+        i += len;
+    }
+    return true;
+}
+
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+
+// Validation by lookup tables, after Keiser and Lemire, "Validating UTF-8 In
+// Less Than One Instruction Per Byte". Every error in a sequence shows up in
+// some pair of adjacent bytes: the high and low nibbles of the first byte
+// and the high nibble of the second are each looked up in a table of the
+// errors they are consistent with, and an error is present wherever all
+// three agree. The remaining condition, that third and fourth bytes of
+// longer sequences are continuations, is checked from the bytes two and
+// three positions back.
+constexpr unsigned char utf8_too_short = 1 << 0;
+constexpr unsigned char utf8_too_long = 1 << 1;
+constexpr unsigned char utf8_overlong_3 = 1 << 2;
+constexpr unsigned char utf8_too_large = 1 << 3;
+constexpr unsigned char utf8_surrogate = 1 << 4;
+constexpr unsigned char utf8_overlong_2 = 1 << 5;
+constexpr unsigned char utf8_too_large_1000 = 1 << 6;
+constexpr unsigned char utf8_overlong_4 = 1 << 6;
+constexpr unsigned char utf8_two_conts = 1 << 7;
+constexpr unsigned char utf8_carry =
+    utf8_too_short | utf8_too_long | utf8_two_conts;
+
+struct utf8_tables {
+    unsigned char byte1_high[16];
+    unsigned char byte1_low[16];
+    unsigned char byte2_high[16];
+    // Subtracting this with saturation leaves non-zero bytes where a
+    // sequence at the end of a block is incomplete
+    unsigned char max_complete[32];
+};
+
+inline const utf8_tables& utf8_lookup() noexcept
+{
+    constexpr unsigned char l = utf8_too_long, c = utf8_two_conts,
+                            s = utf8_too_short;
+    constexpr unsigned char cl = utf8_carry | utf8_too_large,
+                            cl1 = cl | utf8_too_large_1000;
+    constexpr unsigned char b2 = utf8_too_long | utf8_overlong_2 |
+                                 utf8_two_conts;
+    static const utf8_tables tables = {
+        {l, l, l, l, l, l, l, l, c, c, c, c,
+         static_cast<unsigned char>(s | utf8_overlong_2), s,
+         static_cast<unsigned char>(s | utf8_overlong_3 | utf8_surrogate),
+         static_cast<unsigned char>(s | utf8_too_large |
+                                    utf8_too_large_1000 | utf8_overlong_4)},
+        {static_cast<unsigned char>(utf8_carry | utf8_overlong_3 |
+                                    utf8_overlong_2 | utf8_overlong_4),
+         static_cast<unsigned char>(utf8_carry | utf8_overlong_2), utf8_carry,
+         utf8_carry, cl, cl1, cl1, cl1, cl1, cl1, cl1, cl1, cl1,
+         static_cast<unsigned char>(cl1 | utf8_surrogate), cl1, cl1},
+        {s, s, s, s, s, s, s, s,
+         static_cast<unsigned char>(b2 | utf8_overlong_3 |
+                                    utf8_too_large_1000 | utf8_overlong_4),
+         static_cast<unsigned char>(b2 | utf8_overlong_3 | utf8_too_large),
+         static_cast<unsigned char>(b2 | utf8_surrogate | utf8_too_large),
+         static_cast<unsigned char>(b2 | utf8_surrogate | utf8_too_large), s,
+         s, s, s},
+        {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+         0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+         0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xf0 - 1, 0xe0 - 1,
+         0xc0 - 1}};
+    return tables;
+}
+
+struct utf8_state_ssse3 {
+    __m128i prev;
+    __m128i prev_incomplete;
+    __m128i error;
+};
+
+TCB_SPAN_TARGET("ssse3")
+inline void utf8_check_ssse3(__m128i in, utf8_state_ssse3& st,
+                             const __m128i (&t)[4]) noexcept
+{
+    if (_mm_movemask_epi8(in) == 0) {
+        st.error = _mm_or_si128(st.error, st.prev_incomplete);
+        st.prev_incomplete = _mm_setzero_si128();
+        st.prev = in;
+        return;
+    }
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    const __m128i prev1 = _mm_alignr_epi8(in, st.prev, 15);
+    const __m128i sc = _mm_and_si128(
+        _mm_and_si128(
+            _mm_shuffle_epi8(
+                t[0], _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+            _mm_shuffle_epi8(t[1], _mm_and_si128(prev1, nibble))),
+        _mm_shuffle_epi8(t[2],
+                         _mm_and_si128(_mm_srli_epi16(in, 4), nibble)));
+    const __m128i prev2 = _mm_alignr_epi8(in, st.prev, 14);
+    const __m128i prev3 = _mm_alignr_epi8(in, st.prev, 13);
+    const __m128i must23 =
+        _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(0xe0 - 0x80)),
+                     _mm_subs_epu8(prev3, _mm_set1_epi8(0xf0 - 0x80)));
+    const __m128i must23_80 =
+        _mm_and_si128(must23, _mm_set1_epi8(static_cast<char>(0x80)));
+    st.error = _mm_or_si128(st.error, _mm_xor_si128(must23_80, sc));
+    st.prev_incomplete = _mm_subs_epu8(in, t[3]);
+    st.prev = in;
+}
+
+TCB_SPAN_TARGET("ssse3")
+inline __m128i utf8_load_ssse3(const unsigned char* p) noexcept
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+TCB_SPAN_TARGET("ssse3")
+inline bool utf8_valid_ssse3(const unsigned char* p, std::size_t n) noexcept
+{
+    const utf8_tables& tables = utf8_lookup();
+    const __m128i t[4] = {utf8_load_ssse3(tables.byte1_high),
+                          utf8_load_ssse3(tables.byte1_low),
+                          utf8_load_ssse3(tables.byte2_high),
+                          utf8_load_ssse3(tables.max_complete + 16)};
+    utf8_state_ssse3 st{_mm_setzero_si128(), _mm_setzero_si128(),
+                        _mm_setzero_si128()};
+    for (; n >= 16; p += 16, n -= 16) {
+        utf8_check_ssse3(utf8_load_ssse3(p), st, t);
+    }
+    if (n > 0) {
+        unsigned char tail[16] = {};
+        std::memcpy(tail, p, n);
+        utf8_check_ssse3(utf8_load_ssse3(tail), st, t);
+    }
+    const __m128i error = _mm_or_si128(st.error, st.prev_incomplete);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) ==
+           0xffff;
+}
+
+struct utf8_state_avx2 {
+    __m256i prev;
+    __m256i prev_incomplete;
+    __m256i error;
+};
+
+TCB_SPAN_TARGET("avx2")
+inline void utf8_check_avx2(__m256i in, utf8_state_avx2& st,
+                            const __m256i (&t)[4]) noexcept
+{
+    if (_mm256_movemask_epi8(in) == 0) {
+        st.error = _mm256_or_si256(st.error, st.prev_incomplete);
+        st.prev_incomplete = _mm256_setzero_si256();
+        st.prev = in;
+        return;
+    }
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    // The previous 32 bytes shifted in across the lanes
+    const __m256i shifted = _mm256_permute2x128_si256(st.prev, in, 0x21);
+    const __m256i prev1 = _mm256_alignr_epi8(in, shifted, 15);
+    const __m256i sc = _mm256_and_si256(
+        _mm256_and_si256(
+            _mm256_shuffle_epi8(
+                t[0], _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+            _mm256_shuffle_epi8(t[1], _mm256_and_si256(prev1, nibble))),
+        _mm256_shuffle_epi8(
+            t[2], _mm256_and_si256(_mm256_srli_epi16(in, 4), nibble)));
+    const __m256i prev2 = _mm256_alignr_epi8(in, shifted, 14);
+    const __m256i prev3 = _mm256_alignr_epi8(in, shifted, 13);
+    const __m256i must23 = _mm256_or_si256(
+        _mm256_subs_epu8(prev2, _mm256_set1_epi8(0xe0 - 0x80)),
+        _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xf0 - 0x80)));
+    const __m256i must23_80 = _mm256_and_si256(
+        must23, _mm256_set1_epi8(static_cast<char>(0x80)));
+    st.error = _mm256_or_si256(st.error, _mm256_xor_si256(must23_80, sc));
+    st.prev_incomplete = _mm256_subs_epu8(in, t[3]);
+    st.prev = in;
+}
+
+TCB_SPAN_TARGET("avx2")
+inline bool utf8_valid_avx2(const unsigned char* p, std::size_t n) noexcept
+{
+    const utf8_tables& tables = utf8_lookup();
+    const __m256i t[4] = {
+        _mm256_broadcastsi128_si256(utf8_load_ssse3(tables.byte1_high)),
+        _mm256_broadcastsi128_si256(utf8_load_ssse3(tables.byte1_low)),
+        _mm256_broadcastsi128_si256(utf8_load_ssse3(tables.byte2_high)),
+        _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(tables.max_complete))};
+    utf8_state_avx2 st{_mm256_setzero_si256(), _mm256_setzero_si256(),
+                       _mm256_setzero_si256()};
+    for (; n >= 32; p += 32, n -= 32) {
+        utf8_check_avx2(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), st, t);
+    }
+    if (n > 0) {
+        unsigned char tail[32] = {};
+        std::memcpy(tail, p, n);
+        utf8_check_avx2(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tail)), st,
+            t);
+    }
+    const __m256i error = _mm256_or_si256(st.error, st.prev_incomplete);
+    return _mm256_testz_si256(error, error) != 0;
+}
+
+#endif // TCB_SPAN_HAVE_X86_SIMD
+
+inline bool utf8_valid(const unsigned char* p, std::size_t n) noexcept
+{
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+    if (cpu().avx2) {
+        return utf8_valid_avx2(p, n);
+    }
+    if (cpu().ssse3) {
+        return utf8_valid_ssse3(p, n);
+    }
+#endif
+    return utf8_valid_scalar(p, n);
+}
+
+// How far a conversion got through its input and output
+struct utf_progress {
+    std::size_t read;
+    std::size_t written;
+};
+
+// The transcoders copy runs of ASCII sixteen characters at a time, and
+// convert everything else one character at a time, stopping at the first
+// invalid or incomplete character or when the output is full.
+
+inline utf_progress utf8_to_utf16(const unsigned char* in, std::size_t n,
+                                  char16_t* out, std::size_t m) noexcept
+{
+    std::size_t i = 0;
+    std::size_t j = 0;
+    while (i < n) {
+#if defined(TCB_SPAN_HAVE_SSE2)
+        while (n - i >= 16 && m - j >= 16) {
+            const __m128i v =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            if (_mm_movemask_epi8(v) != 0) {
+                break;
+            }
+            const __m128i zero = _mm_setzero_si128();
+            __m128i* o = reinterpret_cast<__m128i*>(out + j);
+            _mm_storeu_si128(o, _mm_unpacklo_epi8(v, zero));
+            _mm_storeu_si128(o + 1, _mm_unpackhi_epi8(v, zero));
+            i += 16;
+            j += 16;
+        }
+        if (i == n) {
+            break;
+        }
+#endif
+        std::uint32_t cp;
+        const unsigned len = utf8_decode(in + i, n - i, cp);
+        if (len == 0) {
+            break;
+        }
+        if (cp < 0x10000) {
+            if (j == m) {
+                break;
+            }
+            out[j++] = static_cast<char16_t>(cp);
+        } else {
+            if (m - j < 2) {
+                break;
+            }
+            cp -= 0x10000;
+            out[j++] = static_cast<char16_t>(0xd800 | cp >> 10);
+            out[j++] = static_cast<char16_t>(0xdc00 | (cp & 0x3ff));
+        }
+        i += len;
+    }
+    return {i, j};
+}
+
+inline utf_progress utf8_to_utf32(const unsigned char* in, std::size_t n,
+                                  char32_t* out, std::size_t m) noexcept
+{
+    std::size_t i = 0;
+    std::size_t j = 0;
+    while (i < n) {
+#if defined(TCB_SPAN_HAVE_SSE2)
+        while (n - i >= 16 && m - j >= 16) {
+            const __m128i v =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            if (_mm_movemask_epi8(v) != 0) {
+                break;
+            }
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i lo = _mm_unpacklo_epi8(v, zero);
+            const __m128i hi = _mm_unpackhi_epi8(v, zero);
+            __m128i* o = reinterpret_cast<__m128i*>(out + j);
+            _mm_storeu_si128(o, _mm_unpacklo_epi16(lo, zero));
+            _mm_storeu_si128(o + 1, _mm_unpackhi_epi16(lo, zero));
+            _mm_storeu_si128(o + 2, _mm_unpacklo_epi16(hi, zero));
+            _mm_storeu_si128(o + 3, _mm_unpackhi_epi16(hi, zero));
+            i += 16;
+            j += 16;
+        }
+        if (i == n) {
+            break;
+        }
+#endif
+        std::uint32_t cp;
+        const unsigned len = utf8_decode(in + i, n - i, cp);
+        if (len == 0 || j == m) {
+            break;
+        }
+        out[j++] = static_cast<char32_t>(cp);
+        i += len;
+    }
+    return {i, j};
+}
+
+inline utf_progress utf16_to_utf8(const char16_t* in, std::size_t n,
+                                  unsigned char* out, std::size_t m) noexcept
+{
+    std::size_t i = 0;
+    std::size_t j = 0;
+    while (i < n) {
+#if defined(TCB_SPAN_HAVE_SSE2)
+        while (n - i >= 16 && m - j >= 16) {
+            const __m128i* p = reinterpret_cast<const __m128i*>(in + i);
+            const __m128i a = _mm_loadu_si128(p);
+            const __m128i b = _mm_loadu_si128(p + 1);
+            const __m128i high = _mm_and_si128(
+                _mm_or_si128(a, b),
+                _mm_set1_epi16(static_cast<short>(0xff80)));
+            if (_mm_movemask_epi8(
+                    _mm_cmpeq_epi16(high, _mm_setzero_si128())) != 0xffff) {
+                break;
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j),
+                             _mm_packus_epi16(a, b));
+            i += 16;
+            j += 16;
+        }
+        if (i == n) {
+            break;
+        }
+#endif
+        std::uint32_t cp = in[i];
+        unsigned units = 1;
+        if (cp >= 0xd800 && cp < 0xe000) {
+            // A high surrogate followed by a low one
+            if (cp >= 0xdc00 || n - i < 2 || in[i + 1] < 0xdc00 ||
+                in[i + 1] >= 0xe000) {
+                break;
+            }
+            cp = 0x10000 + ((cp - 0xd800) << 10 | (in[i + 1] - 0xdc00u));
+            units = 2;
+        }
+        if (m - j < utf8_length(cp)) {
+            break;
+        }
+        j += utf8_encode(cp, out + j);
+        i += units;
+    }
+    return {i, j};
+}
+
+inline utf_progress utf32_to_utf8(const char32_t* in, std::size_t n,
+                                  unsigned char* out, std::size_t m) noexcept
+{
+    std::size_t i = 0;
+    std::size_t j = 0;
+    while (i < n) {
+#if defined(TCB_SPAN_HAVE_SSE2)
+        while (n - i >= 16 && m - j >= 16) {
+            const __m128i* p = reinterpret_cast<const __m128i*>(in + i);
+            const __m128i a = _mm_loadu_si128(p);
+            const __m128i b = _mm_loadu_si128(p + 1);
+            const __m128i c = _mm_loadu_si128(p + 2);
+            const __m128i d = _mm_loadu_si128(p + 3);
+            const __m128i high = _mm_and_si128(
+                _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)),
+                _mm_set1_epi32(static_cast<int>(0xffffff80u)));
+            if (_mm_movemask_epi8(
+                    _mm_cmpeq_epi32(high, _mm_setzero_si128())) != 0xffff) {
+                break;
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j),
+                             _mm_packus_epi16(_mm_packs_epi32(a, b),
+                                              _mm_packs_epi32(c, d)));
+            i += 16;
+            j += 16;
+        }
+        if (i == n) {
+            break;
+        }
+#endif
+        const std::uint32_t cp = in[i];
+        if (cp > 0x10ffff || (cp >= 0xd800 && cp < 0xe000) ||
+            m - j < utf8_length(cp)) {
+            break;
+        }
+        j += utf8_encode(cp, out + j);
+        i++;
+    }
+    return {i, j};
+}
+
+} // namespace detail
+
+// Returns whether s is valid UTF-8: every sequence complete and of the
+// shortest form, and no surrogates or code points beyond U+10FFFF. Input is
+// checked 32 bytes at a time using vector table lookups, with runs of ASCII
+// skipped at a single test per block.
+template <typename C, std::size_t Extent>
+bool validate_utf8(span<C, Extent> s) noexcept
+{
+    return detail::utf8_valid(detail::utf8_bytes(span<C>(s)), s.size());
+}
+
+// The transcoding functions convert as much of their input as possible,
+// returning the prefixes of the input consumed and the output produced. They
+// stop before an invalid sequence, an incomplete one at the end of the input
+// (so that streams can be converted in pieces), or a character for which
+// there is no room in the output. If the output was given the length
+// computed by the matching *_length_from_* function below, then any
+// unconsumed input is invalid or incomplete.
+
+template <typename C, std::size_t Extent>
+codec_result<C, char16_t> utf8_to_utf16(span<C, Extent> in,
+                                        span<char16_t> out) noexcept
+{
+    const detail::utf_progress r = detail::utf8_to_utf16(
+        detail::utf8_bytes(span<C>(in)), in.size(), out.data(), out.size());
+    return {span<C>(in).first(r.read), out.first(r.written)};
+}
+
+template <typename C, std::size_t Extent>
+codec_result<C, char32_t> utf8_to_utf32(span<C, Extent> in,
+                                        span<char32_t> out) noexcept
+{
+    const detail::utf_progress r = detail::utf8_to_utf32(
+        detail::utf8_bytes(span<C>(in)), in.size(), out.data(), out.size());
+    return {span<C>(in).first(r.read), out.first(r.written)};
+}
+
+// An unpaired surrogate is invalid; a high surrogate at the end of the
+// input is left unconsumed.
+template <typename C, std::size_t Extent>
+codec_result<const char16_t, C> utf16_to_utf8(span<const char16_t> in,
+                                              span<C, Extent> out) noexcept
+{
+    static_assert(detail::is_utf8_char<C>::value,
+                  "UTF-8 output must be a span of char, unsigned char or "
+                  "char8_t");
+    const detail::utf_progress r = detail::utf16_to_utf8(
+        in.data(), in.size(), reinterpret_cast<unsigned char*>(out.data()),
+        out.size());
+    return {in.first(r.read), span<C>(out).first(r.written)};
+}
+
+// Surrogates and values beyond U+10FFFF are invalid
+template <typename C, std::size_t Extent>
+codec_result<const char32_t, C> utf32_to_utf8(span<const char32_t> in,
+                                              span<C, Extent> out) noexcept
+{
+    static_assert(detail::is_utf8_char<C>::value,
+                  "UTF-8 output must be a span of char, unsigned char or "
+                  "char8_t");
+    const detail::utf_progress r = detail::utf32_to_utf8(
+        in.data(), in.size(), reinterpret_cast<unsigned char*>(out.data()),
+        out.size());
+    return {in.first(r.read), span<C>(out).first(r.written)};
+}
+
+// The lengths of the conversions of valid input. For invalid input these
+// are still enough for everything which will be converted.
+
+template <typename C, std::size_t Extent>
+std::size_t utf16_length_from_utf8(span<C, Extent> s) noexcept
+{
+    const unsigned char* p = detail::utf8_bytes(span<C>(s));
+    std::size_t length = 0;
+    for (std::size_t i = 0; i < s.size(); i++) {
+        // Every byte other than a continuation starts a character, and
+        // those of four bytes need a surrogate pair
+        length += static_cast<std::size_t>((p[i] & 0xc0) != 0x80) +
+                  static_cast<std::size_t>(p[i] >= 0xf0);
+    }
+    return length;
+}
+
+template <typename C, std::size_t Extent>
+std::size_t utf32_length_from_utf8(span<C, Extent> s) noexcept
+{
+    const unsigned char* p = detail::utf8_bytes(span<C>(s));
+    std::size_t length = 0;
+    for (std::size_t i = 0; i < s.size(); i++) {
+        length += static_cast<std::size_t>((p[i] & 0xc0) != 0x80);
+    }
+    return length;
+}
+
+inline std::size_t utf8_length_from_utf16(span<const char16_t> s) noexcept
+{
+    std::size_t length = 0;
+    for (const char16_t c : s) {
+        // Each half of a surrogate pair contributes two bytes
+        if (c < 0x80) {
+            length += 1;
+        } else if (c < 0x800 || (c & 0xf800) == 0xd800) {
+            length += 2;
+        } else {
+            length += 3;
+        }
+    }
+    return length;
+}
+
+inline std::size_t utf8_length_from_utf32(span<const char32_t> s) noexcept
+{
+    std::size_t length = 0;
+    for (const char32_t c : s) {
+        length += detail::utf8_length(c);
+    }
+    return length;
+}
+
+} // namespace TCB_SPAN_NAMESPACE_NAME
+
+#endif // TCB_UNICODE_HPP_INCLUDED
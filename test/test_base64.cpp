@@ -0,0 +1,183 @@
+
+#include <tcb/base64.hpp>
+
+#include "catch.hpp"
+
+#include <cctype>
+#include <random>
+#include <string>
+#include <vector>
+
+using tcb::byte;
+using tcb::make_span;
+
+namespace {
+
+std::vector<byte> bytes(const std::string& s)
+{
+    std::vector<byte> v(s.size());
+    for (std::size_t i = 0; i < s.size(); i++) {
+        v[i] = static_cast<byte>(s[i]);
+    }
+    return v;
+}
+
+std::vector<byte> random_bytes(std::mt19937& gen, std::size_t size)
+{
+    std::vector<byte> v(size);
+    for (auto& b : v) {
+        b = static_cast<byte>(gen());
+    }
+    return v;
+}
+
+tcb::span<const char> text(const std::string& s)
+{
+    return tcb::span<const char>(s.data(), s.size());
+}
+
+std::string base64(const std::vector<byte>& data)
+{
+    std::string s(tcb::base64_encoded_size(make_span(data)), '?');
+    auto r = tcb::base64_encode(make_span(data),
+                                tcb::span<char>(&s[0], s.size()));
+    REQUIRE(r.consumed.size() == data.size());
+    REQUIRE(r.produced.size() == s.size());
+    return s;
+}
+
+std::string hex(const std::vector<byte>& data)
+{
+    std::string s(tcb::hex_encoded_size(make_span(data)), '?');
+    auto r =
+        tcb::hex_encode(make_span(data), tcb::span<char>(&s[0], s.size()));
+    REQUIRE(r.consumed.size() == data.size());
+    REQUIRE(r.produced.size() == s.size());
+    return s;
+}
+
+} // namespace
+
+TEST_CASE("base64")
+{
+    SECTION("RFC 4648 test vectors")
+    {
+        const std::pair<const char*, const char*> vectors[] = {
+            {"", ""},           {"f", "Zg=="},         {"fo", "Zm8="},
+            {"foo", "Zm9v"},    {"foob", "Zm9vYg=="},  {"fooba", "Zm9vYmE="},
+            {"foobar", "Zm9vYmFy"}};
+        for (const auto& v : vectors) {
+            REQUIRE(base64(bytes(v.first)) == v.second);
+
+            const std::string encoded = v.second;
+            std::vector<byte> out(tcb::base64_decoded_size(text(encoded)));
+            auto r = tcb::base64_decode(text(encoded), make_span(out));
+            REQUIRE(r.consumed.size() == encoded.size());
+            REQUIRE(out == bytes(v.first));
+        }
+    }
+
+    SECTION("round trips")
+    {
+        std::mt19937 gen(1);
+        for (std::size_t size = 0; size < 300; size += 1 + size / 8) {
+            const auto data = random_bytes(gen, size);
+            const std::string encoded = base64(data);
+            std::vector<byte> decoded(tcb::base64_decoded_size(text(encoded)));
+            REQUIRE(decoded.size() == data.size());
+            auto r = tcb::base64_decode(text(encoded), make_span(decoded));
+            REQUIRE(r.consumed.size() == encoded.size());
+            REQUIRE(r.produced.size() == data.size());
+            REQUIRE(decoded == data);
+        }
+    }
+
+    SECTION("decoding stops at invalid characters")
+    {
+        std::mt19937 gen(2);
+        const std::string encoded = base64(random_bytes(gen, 300));
+        for (std::size_t pos = 0; pos < encoded.size(); pos += 7) {
+            for (char bad : {'=', '-', ' ', '\x80', '\0'}) {
+                std::string s = encoded;
+                s[pos] = bad;
+                std::vector<byte> out(300);
+                auto r = tcb::base64_decode(text(s), make_span(out));
+                // A padded group is accepted, and ends the decoding
+                const std::size_t group = pos / 4 * 4;
+                const bool padded = bad == '=' && pos % 4 == 3;
+                REQUIRE(r.consumed.size() == (padded ? group + 4 : group));
+            }
+        }
+    }
+
+    SECTION("encoding and decoding stop when the output is full")
+    {
+        std::mt19937 gen(3);
+        const auto data = random_bytes(gen, 200);
+        std::string s(101, '?');
+        auto r = tcb::base64_encode(make_span(data),
+                                    tcb::span<char>(&s[0], s.size()));
+        REQUIRE(r.consumed.size() == 75);
+        REQUIRE(r.produced.size() == 100);
+
+        const std::string encoded = base64(data);
+        std::vector<byte> out(100);
+        auto d = tcb::base64_decode(text(encoded), make_span(out));
+        REQUIRE(d.consumed.size() == 132);
+        REQUIRE(d.produced.size() == 99);
+
+        // An incomplete group is left for later
+        auto partial = tcb::base64_decode(text(encoded).first(130),
+                                          make_span(out));
+        REQUIRE(partial.consumed.size() == 128);
+        REQUIRE(partial.produced.size() == 96);
+    }
+}
+
+TEST_CASE("hex")
+{
+    SECTION("known encodings")
+    {
+        REQUIRE(hex(bytes("")) == "");
+        REQUIRE(hex(bytes("\x01\xab\xff\x10")) == "01abff10");
+    }
+
+    SECTION("round trips")
+    {
+        std::mt19937 gen(4);
+        for (std::size_t size = 0; size < 300; size += 1 + size / 8) {
+            const auto data = random_bytes(gen, size);
+            std::string encoded = hex(data);
+            // Either case decodes
+            if (size % 2 == 1) {
+                for (char& c : encoded) {
+                    c = static_cast<char>(std::toupper(c));
+                }
+            }
+            std::vector<byte> decoded(tcb::hex_decoded_size(text(encoded)));
+            auto r = tcb::hex_decode(text(encoded), make_span(decoded));
+            REQUIRE(r.consumed.size() == encoded.size());
+            REQUIRE(decoded == data);
+        }
+    }
+
+    SECTION("decoding stops at invalid digits")
+    {
+        std::mt19937 gen(5);
+        const std::string encoded = hex(random_bytes(gen, 200));
+        for (std::size_t pos = 0; pos < encoded.size(); pos += 5) {
+            for (char bad : {'g', 'G', '/', ':', '@', '`', ' '}) {
+                std::string s = encoded;
+                s[pos] = bad;
+                std::vector<byte> out(200);
+                auto r = tcb::hex_decode(text(s), make_span(out));
+                REQUIRE(r.consumed.size() == pos / 2 * 2);
+                REQUIRE(r.produced.size() == pos / 2);
+            }
+        }
+
+        std::vector<byte> out(2);
+        auto r = tcb::hex_decode(text("abc"), make_span(out));
+        REQUIRE(r.consumed.size() == 2);
+    }
+}
@@ -0,0 +1,210 @@
+
+#include <tcb/bit_span.hpp>
+
+#include "catch.hpp"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using tcb::bit_rank_index;
+using tcb::bit_span;
+using tcb::make_span;
+
+namespace {
+
+std::vector<bool> random_bits(std::size_t size, double density, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::bernoulli_distribution dist(density);
+    std::vector<bool> bits(size);
+    for (std::size_t i = 0; i < size; i++) {
+        bits[i] = dist(gen);
+    }
+    return bits;
+}
+
+// Fills words beyond the first size bits with ones, to check that they are
+// ignored and preserved
+std::vector<std::uint64_t> to_words(const std::vector<bool>& bits)
+{
+    std::vector<std::uint64_t> words(bit_span<>::words_needed(bits.size()),
+                                     ~std::uint64_t{0});
+    const bit_span<> b(make_span(words), bits.size());
+    for (std::size_t i = 0; i < bits.size(); i++) {
+        b[i] = bits[i];
+    }
+    return words;
+}
+
+void check_queries(const std::vector<bool>& bits)
+{
+    auto words = to_words(bits);
+    const bit_span<const std::uint64_t> b(make_span(words), bits.size());
+
+    std::size_t expected = 0;
+    for (bool bit : bits) {
+        expected += bit;
+    }
+    REQUIRE(b.count() == expected);
+    REQUIRE(b.any() == (expected > 0));
+
+    std::vector<std::size_t> set_bits;
+    for (std::size_t i = b.find_first(); i < b.size(); i = b.find_next(i)) {
+        set_bits.push_back(i);
+    }
+    REQUIRE(set_bits.size() == expected);
+    for (std::size_t i : set_bits) {
+        REQUIRE(bits[i]);
+    }
+
+    std::vector<std::uint64_t> storage(
+        bit_rank_index::storage_size(bits.size()));
+    const bit_rank_index index(b, make_span(storage));
+    REQUIRE(index.count() == expected);
+    std::size_t rank = 0;
+    for (std::size_t i = 0; i < bits.size(); i++) {
+        REQUIRE(index.rank(i) == rank);
+        rank += bits[i];
+    }
+    REQUIRE(index.rank(bits.size()) == expected);
+    for (std::size_t k = 0; k < set_bits.size(); k++) {
+        REQUIRE(index.select(k) == set_bits[k]);
+    }
+}
+
+template <typename Op>
+void check_combine(std::size_t size, Op op)
+{
+    const auto abits = random_bits(size, 0.5, 1);
+    const auto bbits = random_bits(size, 0.5, 2);
+    auto awords = to_words(abits);
+    auto bwords = to_words(bbits);
+    const bit_span<> a(make_span(awords), size);
+    const bit_span<const std::uint64_t> b(make_span(bwords), size);
+
+    std::vector<std::uint64_t> dwords(bit_span<>::words_needed(size) + 1,
+                                      0x5555555555555555u);
+    const auto before = dwords;
+    const bit_span<> dst(make_span(dwords), 64 * dwords.size());
+
+    auto res = op(a, b, dst);
+    REQUIRE(res.size() == size);
+    REQUIRE(res.words().data() == dwords.data());
+    for (std::size_t i = 0; i < size; i++) {
+        REQUIRE(dst.test(i) == op(abits[i], bbits[i]));
+    }
+    for (std::size_t i = size; i < dst.size(); i++) {
+        REQUIRE(dst.test(i) == bit_span<const std::uint64_t>(
+                                   make_span(before))
+                                   .test(i));
+    }
+
+    // Writing in place gives the same result
+    op(a, b, a);
+    for (std::size_t i = 0; i < size; i++) {
+        REQUIRE(a.test(i) == dst.test(i));
+    }
+}
+
+struct and_op {
+    bit_span<> operator()(bit_span<> a, bit_span<const std::uint64_t> b,
+                          bit_span<> dst) const
+    {
+        return tcb::bit_and(a, b, dst);
+    }
+    bool operator()(bool a, bool b) const { return a && b; }
+};
+
+struct or_op {
+    bit_span<> operator()(bit_span<> a, bit_span<const std::uint64_t> b,
+                          bit_span<> dst) const
+    {
+        return tcb::bit_or(a, b, dst);
+    }
+    bool operator()(bool a, bool b) const { return a || b; }
+};
+
+struct xor_op {
+    bit_span<> operator()(bit_span<> a, bit_span<const std::uint64_t> b,
+                          bit_span<> dst) const
+    {
+        return tcb::bit_xor(a, b, dst);
+    }
+    bool operator()(bool a, bool b) const { return a != b; }
+};
+
+struct andnot_op {
+    bit_span<> operator()(bit_span<> a, bit_span<const std::uint64_t> b,
+                          bit_span<> dst) const
+    {
+        return tcb::bit_andnot(a, b, dst);
+    }
+    bool operator()(bool a, bool b) const { return a && !b; }
+};
+
+} // namespace
+
+TEST_CASE("bit_span")
+{
+    SECTION("element access")
+    {
+        std::vector<std::uint64_t> words(2);
+        const bit_span<> b(make_span(words), 100);
+        REQUIRE(b.size() == 100);
+        REQUIRE(b.none());
+        REQUIRE(b.find_first() == 100);
+
+        b.set(3);
+        b[70] = true;
+        b[71] = b[70];
+        REQUIRE(words[0] == 0x8u);
+        REQUIRE(words[1] == 0xc0u);
+        REQUIRE(b.test(71));
+        REQUIRE(~b[72]);
+
+        b.flip(3);
+        b.reset(70);
+        b[71].flip();
+        REQUIRE(b.none());
+
+        const bit_span<const std::uint64_t> c = b;
+        REQUIRE(c.words().data() == words.data());
+        REQUIRE_FALSE(c[99]);
+        REQUIRE(bit_span<>(make_span(words)).size() == 128);
+        REQUIRE(b.first(10).size() == 10);
+    }
+
+    SECTION("fill")
+    {
+        std::vector<std::uint64_t> words(2);
+        const bit_span<> b(make_span(words), 70);
+        b.fill(true);
+        REQUIRE(words[0] == ~std::uint64_t{0});
+        REQUIRE(words[1] == 0x3fu);
+        REQUIRE(b.count() == 70);
+        b.fill(false);
+        REQUIRE(words[1] == 0);
+    }
+
+    SECTION("queries")
+    {
+        for (std::size_t size : {0u, 1u, 63u, 64u, 65u, 511u, 512u, 513u,
+                                 1000u, 5000u}) {
+            for (double density : {0.0, 0.01, 0.5, 0.99, 1.0}) {
+                check_queries(random_bits(
+                    size, density, static_cast<unsigned>(size)));
+            }
+        }
+    }
+
+    SECTION("bulk operations")
+    {
+        for (std::size_t size : {0u, 1u, 64u, 200u, 256u, 300u, 1000u}) {
+            check_combine(size, and_op{});
+            check_combine(size, or_op{});
+            check_combine(size, xor_op{});
+            check_combine(size, andnot_op{});
+        }
+    }
+}
@@ -0,0 +1,141 @@
+
+#include <tcb/cdc.hpp>
+
+#include "catch.hpp"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using tcb::byte;
+using tcb::make_span;
+
+namespace {
+
+std::vector<byte> random_bytes(std::size_t size, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::vector<byte> bytes(size);
+    for (auto& b : bytes) {
+        b = static_cast<byte>(gen());
+    }
+    return bytes;
+}
+
+std::vector<std::size_t> chunk_sizes(tcb::span<const byte> data,
+                                     const tcb::cdc_params& params)
+{
+    std::vector<std::size_t> sizes;
+    const byte* expected = data.data();
+    for (tcb::span<const byte> chunk :
+         tcb::content_defined_chunks(data, params)) {
+        REQUIRE(chunk.data() == expected);
+        expected += chunk.size();
+        sizes.push_back(chunk.size());
+    }
+    REQUIRE(expected == data.data() + data.size());
+    return sizes;
+}
+
+void check_sizes(const std::vector<std::size_t>& sizes,
+                 const tcb::cdc_params& params)
+{
+    for (std::size_t i = 0; i < sizes.size(); i++) {
+        REQUIRE(sizes[i] > 0);
+        REQUIRE(sizes[i] <= params.max_size);
+        if (i + 1 < sizes.size()) {
+            REQUIRE(sizes[i] >= params.min_size);
+        }
+    }
+}
+
+} // namespace
+
+TEST_CASE("content-defined chunking")
+{
+    const tcb::cdc_params params;
+    const auto data = random_bytes(1 << 20, 1);
+
+    SECTION("chunks cover the input")
+    {
+        const auto sizes = chunk_sizes(make_span(data), params);
+        check_sizes(sizes, params);
+        const double mean = static_cast<double>(data.size()) / sizes.size();
+        REQUIRE(mean > params.avg_size / 2);
+        REQUIRE(mean < params.avg_size * 2);
+
+        REQUIRE(chunk_sizes(make_span(data).first(0), params).empty());
+        REQUIRE(chunk_sizes(make_span(data).first(100), params) ==
+                std::vector<std::size_t>{100});
+    }
+
+    SECTION("boundaries are forced on uniform input")
+    {
+        const std::vector<byte> zeros(300000);
+        const auto sizes = chunk_sizes(make_span(zeros), params);
+        check_sizes(sizes, params);
+    }
+
+    SECTION("other parameters")
+    {
+        tcb::cdc_params p;
+        p.min_size = 256;
+        p.avg_size = 1000;
+        p.max_size = 4000;
+        p.normalization = 1;
+        check_sizes(chunk_sizes(make_span(data), p), p);
+
+        p.min_size = p.avg_size = p.max_size = 512;
+        const auto sizes = chunk_sizes(make_span(data), p);
+        check_sizes(sizes, p);
+        REQUIRE(sizes.size() == data.size() / 512);
+    }
+
+    SECTION("edits only affect nearby chunks")
+    {
+        auto edited = data;
+        edited.insert(edited.begin() + 500000, 10, static_cast<byte>(1));
+        const auto a = chunk_sizes(make_span(data), params);
+        const auto b = chunk_sizes(make_span(edited), params);
+        std::size_t same_prefix = 0;
+        while (a[same_prefix] == b[same_prefix]) {
+            ++same_prefix;
+        }
+        std::size_t same_suffix = 0;
+        while (a[a.size() - 1 - same_suffix] == b[b.size() - 1 - same_suffix]) {
+            ++same_suffix;
+        }
+        REQUIRE(same_prefix + same_suffix + 3 >= a.size());
+    }
+
+    SECTION("streaming finds the same boundaries")
+    {
+        const auto expected = chunk_sizes(make_span(data), params);
+        std::mt19937 gen(2);
+        for (std::size_t max_piece : {1000u, 10000u, 100000u}) {
+            tcb::cdc_chunker chunker(params);
+            std::vector<std::size_t> sizes;
+            std::size_t current = 0;
+            tcb::span<const byte> rest = make_span(data);
+            while (!rest.empty()) {
+                auto piece = rest.first(
+                    (std::min)(rest.size(), std::size_t{gen() % max_piece}));
+                rest = rest.subspan(piece.size());
+                while (!piece.empty()) {
+                    const auto r = chunker.next_boundary(piece);
+                    current += r.length;
+                    piece = piece.subspan(r.length);
+                    if (r.boundary) {
+                        sizes.push_back(current);
+                        current = 0;
+                    }
+                }
+                REQUIRE(chunker.chunk_size() == current);
+            }
+            if (current > 0) {
+                sizes.push_back(current);
+            }
+            REQUIRE(sizes == expected);
+        }
+    }
+}
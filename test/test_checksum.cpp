@@ -0,0 +1,128 @@
+
+#include <tcb/checksum.hpp>
+
+#include "catch.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using tcb::make_span;
+
+namespace {
+
+tcb::span<const char> text(const char* s)
+{
+    return tcb::span<const char>(s, std::strlen(s));
+}
+
+std::vector<unsigned char> random_bytes(std::size_t size, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::vector<unsigned char> bytes(size);
+    for (auto& b : bytes) {
+        b = static_cast<unsigned char>(gen());
+    }
+    return bytes;
+}
+
+// Bit-at-a-time references
+std::uint32_t reference_crc32c(const std::vector<unsigned char>& bytes)
+{
+    std::uint32_t crc = 0xffffffffu;
+    for (unsigned char b : bytes) {
+        crc ^= b;
+        for (int k = 0; k < 8; k++) {
+            crc = crc & 1 ? (crc >> 1) ^ 0x82f63b78u : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+std::uint32_t reference_adler32(const std::vector<unsigned char>& bytes)
+{
+    std::uint32_t a = 1;
+    std::uint32_t b = 0;
+    for (unsigned char c : bytes) {
+        a = (a + c) % 65521;
+        b = (b + a) % 65521;
+    }
+    return b << 16 | a;
+}
+
+} // namespace
+
+TEST_CASE("checksums")
+{
+    SECTION("known values")
+    {
+        REQUIRE(tcb::crc32c(text("")) == 0);
+        REQUIRE(tcb::crc32c(text("123456789")) == 0xe3069283u);
+        REQUIRE(tcb::adler32(text("")) == 1);
+        REQUIRE(tcb::adler32(text("Wikipedia")) == 0x11e60398u);
+        REQUIRE(tcb::xxh64(text("")) == 0xef46db3751d8e999u);
+        REQUIRE(tcb::xxh64(text("a")) == 0xd24ec4f1a98c6e5bu);
+        REQUIRE(tcb::xxh64(text("abc")) == 0x44bc2cf5ad770999u);
+    }
+
+    SECTION("agree with reference implementations")
+    {
+        const auto bytes = random_bytes(100003, 1);
+        for (std::size_t len : {1u, 7u, 8u, 9u, 100u, 767u, 768u, 769u,
+                                5552u, 24576u, 24600u, 100000u}) {
+            for (std::size_t offset : {0u, 3u}) {
+                const std::vector<unsigned char> data(
+                    bytes.begin() + static_cast<std::ptrdiff_t>(offset),
+                    bytes.begin() + static_cast<std::ptrdiff_t>(offset + len));
+                REQUIRE(tcb::crc32c(make_span(data)) ==
+                        reference_crc32c(data));
+                REQUIRE(tcb::adler32(make_span(data)) ==
+                        reference_adler32(data));
+            }
+        }
+
+        // Adler-32 with every byte at its maximum, to check for overflow
+        const std::vector<unsigned char> ones(20000, 0xff);
+        REQUIRE(tcb::adler32(make_span(ones)) == reference_adler32(ones));
+    }
+
+    SECTION("continuation and combination")
+    {
+        const auto bytes = random_bytes(70000, 2);
+        const auto all = make_span(bytes);
+        const std::uint32_t crc = tcb::crc32c(all);
+        const std::uint32_t adler = tcb::adler32(all);
+        for (std::size_t split : {0u, 1u, 1000u, 30000u, 70000u}) {
+            const auto a = all.first(split);
+            const auto b = all.subspan(split);
+            REQUIRE(tcb::crc32c(b, tcb::crc32c(a)) == crc);
+            REQUIRE(tcb::adler32(b, tcb::adler32(a)) == adler);
+            REQUIRE(tcb::crc32c_combine(tcb::crc32c(a), tcb::crc32c(b),
+                                        b.size()) == crc);
+        }
+    }
+
+    SECTION("parallel CRC-32C")
+    {
+        const auto bytes = random_bytes((3u << 20) + 12345, 3);
+        const auto all = make_span(bytes);
+        REQUIRE(tcb::crc32c_parallel(all, 0, 3) == tcb::crc32c(all));
+        REQUIRE(tcb::crc32c_parallel(all.subspan(1), 7, 4) ==
+                tcb::crc32c(all.subspan(1), 7));
+        REQUIRE(tcb::crc32c_parallel(all.first(100)) ==
+                tcb::crc32c(all.first(100)));
+    }
+
+    SECTION("xxh64 lengths")
+    {
+        // Every tail length, through both the short and long paths
+        const auto bytes = random_bytes(100, 4);
+        std::vector<std::uint64_t> hashes;
+        for (std::size_t len = 0; len <= bytes.size(); len++) {
+            hashes.push_back(tcb::xxh64(make_span(bytes).first(len), 5));
+        }
+        std::sort(hashes.begin(), hashes.end());
+        REQUIRE(std::unique(hashes.begin(), hashes.end()) == hashes.end());
+    }
+}
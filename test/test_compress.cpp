@@ -0,0 +1,117 @@
+
+#include <tcb/compress.hpp>
+
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+using tcb::make_span;
+using tcb::span;
+
+namespace {
+
+template <typename T>
+struct is_odd {
+    bool operator()(const T& t) const
+    {
+        return static_cast<long long>(t) % 2 != 0;
+    }
+};
+
+template <typename T>
+void check_compress(std::size_t size)
+{
+    std::mt19937 gen(static_cast<unsigned>(size));
+    std::uniform_int_distribution<int> dist(-1000, 1000);
+    std::vector<T> in(size);
+    for (auto& t : in) {
+        t = static_cast<T>(dist(gen));
+    }
+
+    std::vector<T> expected;
+    std::copy_if(in.begin(), in.end(), std::back_inserter(expected),
+                 is_odd<T>{});
+
+    // Output as large as the input
+    std::vector<T> out(size);
+    auto res = tcb::compress_if(span<const T>(in), make_span(out), is_odd<T>{});
+    REQUIRE(res.data() == out.data());
+    REQUIRE(std::vector<T>(res.begin(), res.end()) == expected);
+
+    // Output exactly large enough
+    std::vector<T> exact(expected.size());
+    res = tcb::compress_if(make_span(in), make_span(exact), is_odd<T>{});
+    REQUIRE(res.size() == expected.size());
+    REQUIRE(exact == expected);
+}
+
+} // namespace
+
+TEST_CASE("compress_if()")
+{
+    for (std::size_t size : {0u, 1u, 7u, 8u, 31u, 100u, 1000u}) {
+        check_compress<float>(size);
+        check_compress<double>(size);
+        check_compress<std::int32_t>(size);
+        check_compress<std::uint64_t>(size);
+        check_compress<std::int16_t>(size);
+    }
+
+    SECTION("non-trivial types")
+    {
+        const std::vector<std::string> in{"a", "bb", "ccc", "dddd", "e"};
+        std::vector<std::string> out(2);
+        auto res = tcb::compress_if(make_span(in), make_span(out),
+                                    [](const std::string& s) {
+                                        return s.size() % 2 == 0;
+                                    });
+        REQUIRE(res.size() == 2);
+        REQUIRE(out[0] == "bb");
+        REQUIRE(out[1] == "dddd");
+    }
+}
+
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+TEST_CASE("compress_if() AVX2 kernels")
+{
+    const auto& cpu = tcb::detail::cpu();
+    if (!cpu.avx2 || !cpu.popcnt) {
+        return;
+    }
+
+    std::vector<std::uint32_t> in32(64);
+    std::vector<std::uint64_t> in64(64);
+    for (std::uint32_t i = 0; i < 64; i++) {
+        in32[i] = i * i;
+        in64[i] = std::uint64_t{i} << 40 | i;
+    }
+    auto pred = [](std::uint64_t x) { return (x * 2654435761u) % 3 == 0; };
+
+    std::vector<std::uint32_t> out32(64);
+    std::size_t i = 0, n = 0;
+    tcb::detail::compress_avx2(in32.data(), in32.size(), out32.data(),
+                                 out32.size(), i, n, pred);
+    std::vector<std::uint32_t> expected32;
+    std::copy_if(in32.begin(), in32.begin() + i,
+                 std::back_inserter(expected32), pred);
+    REQUIRE(i > 0);
+    REQUIRE(std::equal(expected32.begin(), expected32.end(), out32.begin()));
+    REQUIRE(n == expected32.size());
+
+    std::vector<std::uint64_t> out64(64);
+    i = 0;
+    n = 0;
+    tcb::detail::compress_avx2(in64.data(), in64.size(), out64.data(),
+                                 out64.size(), i, n, pred);
+    std::vector<std::uint64_t> expected64;
+    std::copy_if(in64.begin(), in64.begin() + i,
+                 std::back_inserter(expected64), pred);
+    REQUIRE(i > 0);
+    REQUIRE(std::equal(expected64.begin(), expected64.end(), out64.begin()));
+    REQUIRE(n == expected64.size());
+}
+#endif
@@ -2,9 +2,15 @@
 #define TCB_SPAN_NO_DEPRECATION_WARNINGS
 #define TCB_SPAN_THROW_ON_CONTRACT_VIOLATION
 #include <tcb/span.hpp>
+#include <tcb/convert.hpp>
+#include <tcb/endian.hpp>
+#include <tcb/gather.hpp>
+#include <tcb/set_ops.hpp>
+#include <tcb/sorted_span.hpp>
 
 #include "catch.hpp"
 
+#include <cstdint>
 #include <vector>
 
 using tcb::make_span;
@@ -111,4 +117,61 @@ TEST_CASE("front() and back()")
 
     TEST(s.front());
     TEST(s.back());
-}
\ No newline at end of file
+}
+
+TEST_CASE("numeric conversion sizes")
+{
+    int in[2] = {};
+    float out[3] = {};
+
+    TEST(tcb::convert(span<int>(in, 2), span<float>(out, 3)));
+    TEST(tcb::convert(span<int>(in, 2), span<float>(out, 1)));
+}
+
+TEST_CASE("byte order conversion sizes")
+{
+    std::vector<tcb::byte> bytes(7);
+    std::vector<std::uint32_t> values(2);
+
+    TEST(tcb::load_be(span<const tcb::byte>(bytes), make_span(values)));
+    TEST(tcb::load_le(span<const tcb::byte>(bytes), make_span(values)));
+    TEST(tcb::store_be(make_span(values), make_span(bytes)));
+    TEST(tcb::store_le(make_span(values), make_span(bytes)));
+}
+
+TEST_CASE("gather() and scatter() index checking")
+{
+    std::vector<int> src{1, 2, 3};
+    std::vector<unsigned> idx{0, 1, 2, 3};
+    std::vector<int> dst(4);
+
+    TEST(tcb::gather(make_span(src), make_span(idx), make_span(dst)));
+    TEST(tcb::gather(make_span(src), make_span(idx).first(3),
+                     make_span(dst).first(2)));
+    TEST(tcb::scatter(make_span(dst), make_span(idx), make_span(src)));
+}
+
+TEST_CASE("set operation preconditions")
+{
+    std::vector<int> sorted{1, 2, 3};
+    std::vector<int> repeated{1, 2, 2};
+    std::vector<int> out(2);
+
+    TEST(tcb::set_intersection(make_span(repeated), make_span(sorted),
+                               make_span(out)));
+    TEST(tcb::set_union(make_span(sorted), make_span(sorted), make_span(out)));
+    TEST(tcb::unique(make_span(sorted), make_span(out)));
+}
+
+TEST_CASE("sorted_span preconditions")
+{
+    std::vector<int> unsorted{1, 3, 2};
+    std::vector<int> sorted{1, 2, 3};
+    std::vector<std::size_t> out(2);
+
+    TEST(tcb::sorted_span<int>(make_span(unsorted)));
+
+    const tcb::sorted_span<int> s(make_span(sorted));
+    TEST(s.lower_bound(make_span(sorted), make_span(out)));
+    TEST(s.upper_bound(make_span(sorted), make_span(out)));
+}
@@ -0,0 +1,238 @@
+
+#include <tcb/convert.hpp>
+
+#include "catch.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+using tcb::make_span;
+
+namespace {
+
+template <typename T>
+std::vector<T> random_values(std::mt19937_64& gen, std::size_t size)
+{
+    std::vector<T> v(size);
+    for (T& x : v) {
+        const std::uint64_t bits = gen();
+        std::memcpy(&x, &bits, sizeof(T));
+    }
+    return v;
+}
+
+// Checks a conversion against the expected value of each element, at sizes
+// which exercise both the SIMD kernels and the scalar tails
+template <typename From, typename To, typename F>
+void check_conversion(const F& expected)
+{
+    std::mt19937_64 gen(sizeof(From) * 8 + sizeof(To));
+    for (std::size_t size : {0u, 1u, 7u, 8u, 15u, 16u, 31u, 32u, 33u, 100u}) {
+        const auto in = random_values<From>(gen, size);
+        std::vector<To> out(size);
+        tcb::convert(make_span(in), make_span(out));
+        for (std::size_t i = 0; i < size; i++) {
+            REQUIRE(out[i] == expected(in[i]));
+        }
+    }
+}
+
+template <typename To>
+To clamp(long long x)
+{
+    using limits = std::numeric_limits<To>;
+    return x < static_cast<long long>(limits::min())
+               ? limits::min()
+               : x > static_cast<long long>(limits::max())
+                     ? limits::max()
+                     : static_cast<To>(x);
+}
+
+template <typename From, typename To>
+void check_narrowing()
+{
+    check_conversion<From, To>(
+        [](From x) { return clamp<To>(static_cast<long long>(x)); });
+}
+
+template <typename From>
+void check_int_to_float()
+{
+    check_conversion<From, float>(
+        [](From x) { return static_cast<float>(x); });
+}
+
+float as_float(std::uint32_t bits)
+{
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+// Reference conversions for the 16-bit formats, through double
+double half_value(std::uint16_t h)
+{
+    const int exponent = h >> 10 & 0x1f;
+    const double mantissa = h & 0x3ff;
+    const double sign = (h & 0x8000) != 0 ? -1.0 : 1.0;
+    if (exponent == 0) {
+        return sign * std::ldexp(mantissa, -24);
+    }
+    return sign * std::ldexp(1024 + mantissa, exponent - 25);
+}
+
+} // namespace
+
+TEST_CASE("integer conversions")
+{
+    check_narrowing<std::int32_t, std::int16_t>();
+    check_narrowing<std::int32_t, std::uint16_t>();
+    check_narrowing<std::int32_t, std::int8_t>();
+    check_narrowing<std::int32_t, std::uint8_t>();
+    check_narrowing<std::int16_t, std::int8_t>();
+    check_narrowing<std::int16_t, std::uint8_t>();
+    check_narrowing<std::uint32_t, std::int16_t>();
+    check_narrowing<std::int64_t, std::int32_t>();
+    check_narrowing<std::int8_t, std::uint32_t>();
+    check_narrowing<std::uint16_t, std::int64_t>();
+
+    const std::uint64_t big[] = {0, 1, 0xffffffffffffffff};
+    std::int64_t out[3];
+    tcb::convert(make_span(big), make_span(out));
+    REQUIRE(out[2] == std::numeric_limits<std::int64_t>::max());
+}
+
+TEST_CASE("integer to floating-point conversions")
+{
+    check_int_to_float<std::int8_t>();
+    check_int_to_float<std::uint8_t>();
+    check_int_to_float<std::int16_t>();
+    check_int_to_float<std::uint16_t>();
+    check_int_to_float<std::int32_t>();
+    check_conversion<std::int64_t, double>(
+        [](std::int64_t x) { return static_cast<double>(x); });
+}
+
+TEST_CASE("floating-point to integer conversions")
+{
+    const float in[] = {1.9f,   -1.9f, 1e10f, -1e10f,
+                        40000,  -0.0f, std::numeric_limits<float>::infinity(),
+                        std::numeric_limits<float>::quiet_NaN()};
+    std::int16_t out16[8];
+    tcb::convert(make_span(in), make_span(out16));
+    const std::int16_t expected16[] = {1,     -1, 32767, -32768,
+                                       32767, 0,  32767, 0};
+    REQUIRE(std::equal(out16, out16 + 8, expected16));
+
+    std::uint32_t out32[8];
+    tcb::convert(make_span(in), make_span(out32));
+    const std::uint32_t expected32[] = {1, 0, 4294967295u, 0,
+                                        40000, 0, 4294967295u, 0};
+    REQUIRE(std::equal(out32, out32 + 8, expected32));
+}
+
+TEST_CASE("float16 conversions")
+{
+    SECTION("every float16 converts to float exactly")
+    {
+        std::vector<tcb::float16> halves(65536);
+        for (std::size_t i = 0; i < halves.size(); i++) {
+            halves[i].bits = static_cast<std::uint16_t>(i);
+        }
+        std::vector<float> floats(halves.size());
+        tcb::convert(make_span(halves), make_span(floats));
+        for (std::size_t i = 0; i < halves.size(); i++) {
+            if ((i & 0x7c00) == 0x7c00) {
+                REQUIRE(std::isnan(floats[i]) == ((i & 0x3ff) != 0));
+            } else {
+                REQUIRE(floats[i] == half_value(static_cast<std::uint16_t>(i)));
+            }
+        }
+
+        // and back again
+        std::vector<tcb::float16> back(halves.size());
+        tcb::convert(make_span(floats), make_span(back));
+        for (std::size_t i = 0; i < halves.size(); i++) {
+            if (!std::isnan(floats[i])) {
+                REQUIRE(back[i].bits == i);
+            }
+        }
+    }
+
+    SECTION("rounding to nearest even")
+    {
+        const float in[] = {
+            1.0f + 1.0f / 2048,     // halfway, rounds down to even
+            1.0f + 3.0f / 2048,     // halfway, rounds up to even
+            1.0f + 1.0f / 2048 + 1.0f / 65536,
+            65504.0f,  65519.0f, 65520.0f, 1e10f, -1e10f,
+            as_float(0x33000000),   // 2^-25, halfway to the least subnormal
+            as_float(0x33000001),
+            std::numeric_limits<float>::quiet_NaN(),
+            -0.0f,
+            1e-10f,
+            6.1e-5f,
+            0.1f,
+            -2.5f};
+        const std::uint16_t expected[] = {0x3c00, 0x3c02, 0x3c01, 0x7bff,
+                                          0x7bff, 0x7c00, 0x7c00, 0xfc00,
+                                          0x0000, 0x0001, 0x7e00, 0x8000,
+                                          0x0000, 0x03ff, 0x2e66, 0xc100};
+        std::vector<tcb::float16> out(16);
+        tcb::convert(make_span(in), make_span(out));
+        for (std::size_t i = 0; i < 16; i++) {
+            REQUIRE(out[i].bits == expected[i]);
+        }
+        // The same values through the scalar tail
+        for (std::size_t i = 0; i < 16; i++) {
+            tcb::float16 one[1];
+            tcb::convert(make_span(in).subspan(i, 1), make_span(one));
+            REQUIRE(one[0].bits == expected[i]);
+        }
+    }
+}
+
+TEST_CASE("bfloat16 conversions")
+{
+    std::mt19937_64 gen(7);
+    const auto floats = random_values<float>(gen, 1001);
+    std::vector<tcb::bfloat16> out(floats.size());
+    tcb::convert(make_span(floats), make_span(out));
+    std::vector<float> back(floats.size());
+    tcb::convert(make_span(out), make_span(back));
+    for (std::size_t i = 0; i < floats.size(); i++) {
+        if (std::isnan(floats[i])) {
+            REQUIRE(std::isnan(back[i]));
+            continue;
+        }
+        if (std::isinf(floats[i])) {
+            REQUIRE(back[i] == floats[i]);
+            continue;
+        }
+        // The nearest bfloat16, found by truncating and trying the next
+        // value up, with ties going to the even one
+        std::uint32_t bits;
+        std::memcpy(&bits, &floats[i], sizeof(bits));
+        const float down = as_float(bits & 0xffff0000);
+        const float up = as_float((bits & 0xffff0000) + 0x10000);
+        const double d_down = std::fabs(double(floats[i]) - double(down));
+        const double d_up = std::fabs(double(up) - double(floats[i]));
+        const float expected =
+            d_down < d_up || (d_down == d_up && (bits & 0x10000) == 0)
+                ? down
+                : up;
+        REQUIRE(back[i] == expected);
+    }
+
+    const float in[] = {1.0f, -2.0f, 1.0f + 1.0f / 256,
+                        std::numeric_limits<float>::infinity()};
+    tcb::bfloat16 b[4];
+    tcb::convert(make_span(in), make_span(b));
+    REQUIRE(b[0].bits == 0x3f80);
+    REQUIRE(b[1].bits == 0xc000);
+    REQUIRE(b[2].bits == 0x3f80);
+    REQUIRE(b[3].bits == 0x7f80);
+}
@@ -0,0 +1,153 @@
+
+#include <tcb/csv.hpp>
+
+#include "catch.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using table = std::vector<std::vector<std::string>>;
+
+tcb::span<const char> text(const std::string& s)
+{
+    return tcb::span<const char>(s.data(), s.size());
+}
+
+table parse(const std::string& s, tcb::csv_dialect dialect = {},
+            unsigned threads = 0)
+{
+    std::vector<std::uint32_t> index(tcb::max_csv_index_size(s.size()));
+    const auto entries =
+        threads == 0
+            ? tcb::index_csv(text(s), tcb::make_span(index), dialect)
+            : tcb::index_csv_parallel(text(s), tcb::make_span(index),
+                                      dialect, threads);
+    table result;
+    for (tcb::csv_table::row r : tcb::csv_table(text(s), entries)) {
+        std::vector<std::string> fields;
+        for (std::size_t i = 0; i < r.size(); i++) {
+            fields.emplace_back(r[i].data(), r[i].size());
+        }
+        result.push_back(fields);
+    }
+    return result;
+}
+
+// A straightforward reference implementation, for comparison
+table reference_parse(const std::string& s)
+{
+    table result;
+    if (s.empty()) {
+        return result;
+    }
+    std::vector<std::string> fields(1);
+    bool quoted = false;
+    for (char c : s) {
+        if (c == '"') {
+            quoted = !quoted;
+        }
+        if (!quoted && c == ',') {
+            fields.emplace_back();
+        } else if (!quoted && c == '\n') {
+            if (!fields.back().empty() && fields.back().back() == '\r') {
+                fields.back().pop_back();
+            }
+            result.push_back(fields);
+            fields.assign(1, std::string());
+        } else {
+            fields.back() += c;
+        }
+    }
+    if (s.back() != '\n' || quoted) {
+        result.push_back(fields);
+    }
+    return result;
+}
+
+std::string random_csv(std::mt19937& gen, std::size_t size)
+{
+    const char chars[] = {'a', 'b', ',', ',', '"', '\n', '\r'};
+    std::string s(size, 'x');
+    for (char& c : s) {
+        if (gen() % 4 == 0) {
+            c = chars[gen() % sizeof(chars)];
+        }
+    }
+    return s;
+}
+
+} // namespace
+
+TEST_CASE("CSV indexing")
+{
+    SECTION("simple tables")
+    {
+        REQUIRE(parse("a,b,c\n1,2,3\n") ==
+                (table{{"a", "b", "c"}, {"1", "2", "3"}}));
+        REQUIRE(parse("a,b\r\n,\r\nlast") ==
+                (table{{"a", "b"}, {"", ""}, {"last"}}));
+        REQUIRE(parse("x,") == (table{{"x", ""}}));
+        REQUIRE(parse("\n\n") == (table{{""}, {""}}));
+        REQUIRE(parse("").empty());
+    }
+
+    SECTION("quoted fields")
+    {
+        REQUIRE(parse("\"a,b\",\"say \"\"hi\"\"\"\n\"x\ny\",z\n") ==
+                (table{{"\"a,b\"", "\"say \"\"hi\"\"\""},
+                       {"\"x\ny\"", "z"}}));
+        // An unterminated quote runs to the end of the text
+        REQUIRE(parse("a,\"b\nc,d\n") == (table{{"a", "\"b\nc,d\n"}}));
+    }
+
+    SECTION("TSV")
+    {
+        REQUIRE(parse("a\tb,c\n\"d\te\"\tf\n", tcb::csv_dialect('\t')) ==
+                (table{{"a", "b,c"}, {"\"d\te\"", "f"}}));
+    }
+
+    SECTION("fields refer to the original text")
+    {
+        const std::string s = "ab,cd\nef";
+        std::vector<std::uint32_t> index(tcb::max_csv_index_size(s.size()));
+        const auto entries = tcb::index_csv(text(s), tcb::make_span(index));
+        REQUIRE(entries.size() == 3);
+        tcb::csv_table t(text(s), entries);
+        auto it = t.begin();
+        REQUIRE((*it)[1].data() == s.data() + 3);
+        ++it;
+        REQUIRE((*it)[0].data() == s.data() + 6);
+        REQUIRE(++it == t.end());
+    }
+
+    SECTION("matches a reference implementation")
+    {
+        std::mt19937 gen(17);
+        for (unsigned iter = 0; iter < 300; iter++) {
+            const std::string s = random_csv(gen, gen() % 700);
+            REQUIRE(parse(s) == reference_parse(s));
+        }
+    }
+
+    SECTION("parallel indexing")
+    {
+        std::mt19937 gen(5);
+        const std::string s = random_csv(gen, (std::size_t{5} << 20) + 37);
+        std::vector<std::uint32_t> expected(
+            tcb::max_csv_index_size(s.size()));
+        const auto serial = tcb::index_csv(text(s), tcb::make_span(expected));
+        for (unsigned threads : {2u, 3u, 8u}) {
+            std::vector<std::uint32_t> index(
+                tcb::max_csv_index_size(s.size()));
+            const auto parallel = tcb::index_csv_parallel(
+                text(s), tcb::make_span(index), {}, threads);
+            REQUIRE(parallel.size() == serial.size());
+            REQUIRE(std::equal(parallel.begin(), parallel.end(),
+                               serial.begin()));
+        }
+        REQUIRE(parse(s, {}, 4) == reference_parse(s));
+    }
+}
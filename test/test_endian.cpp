@@ -0,0 +1,138 @@
+
+#include <tcb/endian.hpp>
+
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using tcb::byte;
+using tcb::make_span;
+
+namespace {
+
+// The expected result of reversing the bytes of each element, computed a
+// byte at a time
+template <typename T>
+std::vector<T> reversed_bytes(const std::vector<T>& v)
+{
+    std::vector<T> result(v.size());
+    for (std::size_t i = 0; i < v.size(); i++) {
+        unsigned char b[sizeof(T)];
+        std::memcpy(b, &v[i], sizeof(T));
+        for (std::size_t k = 0; k < sizeof(T) / 2; k++) {
+            std::swap(b[k], b[sizeof(T) - 1 - k]);
+        }
+        std::memcpy(&result[i], b, sizeof(T));
+    }
+    return result;
+}
+
+template <typename T>
+std::vector<T> random_values(std::mt19937_64& gen, std::size_t size)
+{
+    std::vector<T> v(size);
+    for (T& x : v) {
+        const std::uint64_t bits = gen();
+        std::memcpy(&x, &bits, sizeof(T));
+    }
+    return v;
+}
+
+template <typename T>
+void check_byteswap()
+{
+    std::mt19937_64 gen(sizeof(T));
+    for (std::size_t size : {0u, 1u, 3u, 7u, 8u, 15u, 16u, 17u, 33u, 100u}) {
+        const auto values = random_values<T>(gen, size);
+        auto swapped = values;
+        tcb::byteswap_inplace(make_span(swapped));
+        // Compared as bytes, so that NaN patterns compare equal
+        const auto expected = reversed_bytes(values);
+        const auto actual = tcb::as_bytes(make_span(swapped));
+        const auto wanted = tcb::as_bytes(make_span(expected));
+        REQUIRE(actual.size() == wanted.size());
+        REQUIRE(std::equal(actual.begin(), actual.end(), wanted.begin()));
+    }
+}
+
+} // namespace
+
+TEST_CASE("byteswap_inplace")
+{
+    check_byteswap<std::uint16_t>();
+    check_byteswap<std::int32_t>();
+    check_byteswap<std::uint64_t>();
+    check_byteswap<float>();
+    check_byteswap<double>();
+
+    std::uint32_t words[] = {0x01020304, 0xa0b0c0d0};
+    tcb::byteswap_inplace(make_span(words));
+    REQUIRE(words[0] == 0x04030201);
+    REQUIRE(words[1] == 0xd0c0b0a0);
+
+    // A subspan is swapped without touching its neighbours
+    std::uint16_t halves[] = {0x0102, 0x0304, 0x0506};
+    tcb::byteswap_inplace(make_span(halves).subspan(1, 1));
+    REQUIRE(halves[0] == 0x0102);
+    REQUIRE(halves[1] == 0x0403);
+    REQUIRE(halves[2] == 0x0506);
+}
+
+TEST_CASE("big- and little-endian loads and stores")
+{
+    SECTION("known representations")
+    {
+        const unsigned char raw[] = {0x12, 0x34, 0x56, 0x78,
+                                     0x9a, 0xbc, 0xde, 0xf0};
+        const auto bytes = tcb::as_bytes(make_span(raw));
+
+        std::uint32_t be[2];
+        tcb::load_be(bytes, make_span(be));
+        REQUIRE(be[0] == 0x12345678);
+        REQUIRE(be[1] == 0x9abcdef0);
+
+        std::uint16_t le[4];
+        tcb::load_le(bytes, make_span(le));
+        REQUIRE(le[0] == 0x3412);
+        REQUIRE(le[3] == 0xf0de);
+
+        std::uint64_t be64;
+        tcb::load_be(bytes, tcb::span<std::uint64_t, 1>(&be64, 1));
+        REQUIRE(be64 == 0x123456789abcdef0);
+
+        byte out[8];
+        tcb::store_be(make_span(be), make_span(out));
+        REQUIRE(std::memcmp(out, raw, 8) == 0);
+        tcb::store_le(make_span(le), make_span(out));
+        REQUIRE(std::memcmp(out, raw, 8) == 0);
+
+        // Single bytes are copied unchanged
+        unsigned char copy[8];
+        tcb::load_be(bytes, make_span(copy));
+        REQUIRE(std::memcmp(copy, raw, 8) == 0);
+    }
+
+    SECTION("floating-point round trips")
+    {
+        std::mt19937_64 gen(1);
+        std::vector<double> values(101);
+        for (double& d : values) {
+            d = std::uniform_real_distribution<double>(-1e6, 1e6)(gen);
+        }
+        std::vector<byte> bytes(values.size() * sizeof(double));
+        tcb::store_be(make_span(values), make_span(bytes));
+        // The first byte of a big-endian double holds the sign
+        REQUIRE((static_cast<unsigned char>(bytes[0]) >> 7) ==
+                (values[0] < 0 ? 1u : 0u));
+
+        std::vector<double> back(values.size());
+        tcb::load_be(make_span(bytes), make_span(back));
+        REQUIRE(back == values);
+        tcb::store_le(make_span(values), make_span(bytes));
+        tcb::load_le(make_span(bytes), make_span(back));
+        REQUIRE(back == values);
+    }
+}
@@ -0,0 +1,127 @@
+
+#include <tcb/gather.hpp>
+
+#include "catch.hpp"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using tcb::make_span;
+using tcb::span;
+
+namespace {
+
+template <typename T, typename I>
+void check_gather_scatter(std::size_t src_size, std::size_t n)
+{
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<std::uint64_t> index_dist(0, src_size - 1);
+
+    std::vector<T> src(src_size);
+    for (std::size_t i = 0; i < src.size(); i++) {
+        src[i] = static_cast<T>(i * 3 + 1);
+    }
+    std::vector<I> idx(n);
+    for (auto& i : idx) {
+        i = static_cast<I>(index_dist(gen));
+    }
+
+    std::vector<T> dst(n + 5, T(-1));
+    auto out = tcb::gather(make_span(src), make_span(idx), make_span(dst));
+    REQUIRE(out.data() == dst.data());
+    REQUIRE(out.size() == n);
+    for (std::size_t i = 0; i < n; i++) {
+        REQUIRE(dst[i] == src[idx[i]]);
+    }
+    REQUIRE(dst[n] == T(-1));
+
+    // Scatter back into a fresh buffer, comparing against the obvious loop
+    // (which defines the result for repeated indices)
+    std::vector<T> expected(src_size, T(0));
+    std::vector<T> actual(src_size, T(0));
+    for (std::size_t i = 0; i < n; i++) {
+        expected[idx[i]] = out[i] + T(1);
+        out[i] += T(1);
+    }
+    tcb::scatter(span<const T>(out), span<const I>(idx), make_span(actual));
+    REQUIRE(actual == expected);
+}
+
+} // namespace
+
+TEST_CASE("gather() and scatter()")
+{
+    SECTION("32-bit values, 32-bit indices")
+    {
+        check_gather_scatter<float, std::uint32_t>(1000, 333);
+        check_gather_scatter<std::int32_t, std::int32_t>(50, 1000);
+    }
+
+    SECTION("64-bit values, 32-bit indices")
+    {
+        check_gather_scatter<double, std::uint32_t>(1000, 333);
+        check_gather_scatter<std::uint64_t, std::uint32_t>(7, 100);
+    }
+
+    SECTION("other types")
+    {
+        check_gather_scatter<std::uint16_t, std::uint64_t>(1000, 333);
+        check_gather_scatter<double, std::uint8_t>(200, 17);
+    }
+
+    SECTION("empty")
+    {
+        std::vector<float> src;
+        std::vector<std::uint32_t> idx;
+        std::vector<float> dst;
+        REQUIRE(tcb::gather(make_span(src), make_span(idx), make_span(dst))
+                    .empty());
+    }
+}
+
+TEST_CASE("max_index()")
+{
+    std::vector<std::uint32_t> idx(100, 5);
+    idx[77] = 0xFFFFFFF0u;
+    REQUIRE(tcb::detail::max_index(idx.data(), idx.size()) == 0xFFFFFFF0u);
+
+    std::vector<std::int32_t> sidx(37, 5);
+    sidx[36] = -1;
+    REQUIRE(tcb::detail::max_index(sidx.data(), sidx.size()) == 0xFFFFFFFFu);
+}
+
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+TEST_CASE("gather kernels")
+{
+    // The dispatcher prefers the widest kernel available, so test the
+    // others directly
+    std::vector<std::uint64_t> src(100);
+    for (std::size_t i = 0; i < src.size(); i++) {
+        src[i] = i * 0x100000001u;
+    }
+    std::vector<std::uint32_t> idx(37);
+    for (std::size_t i = 0; i < idx.size(); i++) {
+        idx[i] = static_cast<std::uint32_t>((i * 7) % 100);
+    }
+
+    if (tcb::detail::cpu().avx2) {
+        std::vector<std::uint64_t> dst64(idx.size());
+        std::size_t n = tcb::detail::gather64_avx2(src.data(), idx.data(),
+                                                   dst64.data(), idx.size());
+        REQUIRE(n == 36);
+        for (std::size_t i = 0; i < n; i++) {
+            REQUIRE(dst64[i] == src[idx[i]]);
+        }
+
+        const auto* src32 = reinterpret_cast<const std::uint32_t*>(src.data());
+        std::vector<std::uint32_t> dst32(idx.size());
+        n = tcb::detail::gather32_avx2(src32, idx.data(), dst32.data(),
+                                       idx.size());
+        REQUIRE(n == 32);
+        for (std::size_t i = 0; i < n; i++) {
+            REQUIRE(dst32[i] == src32[idx[i]]);
+        }
+    }
+}
+#endif
@@ -0,0 +1,113 @@
+
+#include <tcb/hash.hpp>
+
+#include "catch.hpp"
+
+#include <cstdint>
+#include <random>
+#include <set>
+#include <vector>
+
+using tcb::make_span;
+
+namespace {
+
+std::vector<unsigned char> random_bytes(std::size_t size, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::vector<unsigned char> bytes(size);
+    for (auto& b : bytes) {
+        b = static_cast<unsigned char>(gen());
+    }
+    return bytes;
+}
+
+template <std::size_t N>
+void check_fixed_extent()
+{
+    for (unsigned seed = 0; seed < 20; seed++) {
+        const auto bytes = random_bytes(N, seed);
+        const tcb::span<const unsigned char, N> fixed(bytes.data(), N);
+        REQUIRE(tcb::hash(fixed, seed) == tcb::hash(make_span(bytes), seed));
+    }
+}
+
+} // namespace
+
+TEST_CASE("hash")
+{
+    SECTION("depends only on the bytes")
+    {
+        const std::uint32_t words[] = {1, 2, 3, 4};
+        REQUIRE(tcb::hash(make_span(words)) ==
+                tcb::hash(tcb::as_bytes(make_span(words))));
+        REQUIRE(tcb::hash(make_span(words)) ==
+                tcb::hash(make_span(words).first(4)));
+    }
+
+    SECTION("static extents")
+    {
+        check_fixed_extent<8>();
+        check_fixed_extent<16>();
+        check_fixed_extent<32>();
+        check_fixed_extent<5>();
+        check_fixed_extent<100>();
+
+        const std::uint64_t keys[] = {1, 2};
+        REQUIRE(tcb::hash(tcb::span<const std::uint64_t, 2>(keys)) ==
+                tcb::hash(tcb::span<const std::uint64_t>(keys, 2)));
+    }
+
+    SECTION("seeds and lengths change the hash")
+    {
+        const auto bytes = random_bytes(300, 1);
+        std::set<std::uint64_t> hashes;
+        for (std::size_t len = 0; len <= bytes.size(); len++) {
+            hashes.insert(tcb::hash(make_span(bytes).first(len)));
+            hashes.insert(tcb::hash(make_span(bytes).first(len), 1));
+        }
+        REQUIRE(hashes.size() == 2 * (bytes.size() + 1));
+    }
+
+    SECTION("single bit flips change the hash")
+    {
+        for (std::size_t len : {1u, 3u, 4u, 8u, 16u, 17u, 48u, 49u, 200u}) {
+            auto bytes = random_bytes(len, static_cast<unsigned>(len));
+            const auto h = tcb::hash(make_span(bytes));
+            for (std::size_t bit = 0; bit < 8 * len; bit++) {
+                bytes[bit / 8] ^= static_cast<unsigned char>(1u << bit % 8);
+                REQUIRE(tcb::hash(make_span(bytes)) != h);
+                bytes[bit / 8] ^= static_cast<unsigned char>(1u << bit % 8);
+            }
+        }
+    }
+
+    SECTION("streaming matches the one-shot hash")
+    {
+        const auto bytes = random_bytes(1000, 2);
+        std::mt19937 gen(3);
+        for (std::size_t len : {0u, 1u, 16u, 17u, 47u, 48u, 49u, 64u, 96u,
+                                97u, 150u, 1000u}) {
+            const auto data = make_span(bytes).first(len);
+            const std::uint64_t expected = tcb::hash(data, 42);
+            for (unsigned trial = 0; trial < 20; trial++) {
+                tcb::hasher h(42);
+                std::size_t pos = 0;
+                while (pos < len) {
+                    const std::size_t n =
+                        (std::min)(len - pos, std::size_t{gen() % 70});
+                    h.update(data.subspan(pos, n));
+                    pos += n;
+                }
+                REQUIRE(h.digest() == expected);
+            }
+        }
+
+        // digest() does not end the stream
+        tcb::hasher h;
+        h.update(make_span(bytes).first(10));
+        REQUIRE(h.digest() == tcb::hash(make_span(bytes).first(10)));
+        h.update(make_span(bytes).subspan(10, 90));
+        REQUIRE(h.digest() == tcb::hash(make_span(bytes).first(100)));
+    }
+}
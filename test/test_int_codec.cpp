@@ -0,0 +1,334 @@
+
+#include <tcb/int_codec.hpp>
+
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+using tcb::byte;
+using tcb::make_span;
+
+namespace {
+
+template <typename T>
+std::vector<T> random_values(std::size_t size, T range, unsigned seed)
+{
+    std::mt19937_64 gen(seed);
+    std::uniform_int_distribution<T> dist(0, range);
+    std::vector<T> values(size);
+    for (auto& v : values) {
+        v = dist(gen);
+    }
+    return values;
+}
+
+struct for_codec {
+    template <typename In, typename Out>
+    auto encode(In in, Out out) const -> decltype(tcb::encode_for(in, out))
+    {
+        return tcb::encode_for(in, out);
+    }
+    template <typename In, typename Out>
+    auto decode(In in, Out out) const -> decltype(tcb::decode_for(in, out))
+    {
+        return tcb::decode_for(in, out);
+    }
+};
+
+struct delta_codec {
+    template <typename In, typename Out>
+    auto encode(In in, Out out) const -> decltype(tcb::encode_delta(in, out))
+    {
+        return tcb::encode_delta(in, out);
+    }
+    template <typename In, typename Out>
+    auto decode(In in, Out out) const -> decltype(tcb::decode_delta(in, out))
+    {
+        return tcb::decode_delta(in, out);
+    }
+};
+
+template <typename T, typename Codec>
+void check_round_trip(const std::vector<T>& values, Codec codec)
+{
+    std::vector<byte> encoded(
+        tcb::max_block_encoded_size<T>(values.size()));
+    auto enc = codec.encode(make_span(values), make_span(encoded));
+    REQUIRE(enc.consumed.size() == values.size());
+    REQUIRE(enc.produced.data() == encoded.data());
+    encoded.resize(enc.produced.size());
+
+    std::vector<T> decoded(values.size());
+    auto dec = codec.decode(make_span(encoded), make_span(decoded));
+    REQUIRE(dec.consumed.size() == encoded.size());
+    REQUIRE(dec.produced.size() == values.size());
+    REQUIRE(decoded == values);
+
+    // Encoding through a buffer with room for about one block produces the
+    // same stream
+    std::vector<byte> streamed;
+    std::vector<byte> buffer(tcb::max_block_encoded_size<T>(1) + 100);
+    tcb::span<const T> rest = make_span(values);
+    while (!rest.empty()) {
+        auto r = codec.encode(rest, make_span(buffer));
+        REQUIRE(!r.consumed.empty());
+        streamed.insert(streamed.end(), r.produced.begin(), r.produced.end());
+        rest = rest.subspan(r.consumed.size());
+    }
+    REQUIRE(streamed == encoded);
+
+    // Decoding into a small buffer, with the input arriving 300 bytes at a time
+    std::vector<T> out_buffer(200);
+    std::vector<T> result;
+    std::size_t pos = 0;
+    std::size_t avail = 0;
+    while (result.size() < values.size()) {
+        avail = (std::min)(avail + 300, encoded.size());
+        auto r = codec.decode(make_span(encoded).subspan(pos, avail - pos),
+                              make_span(out_buffer));
+        result.insert(result.end(), r.produced.begin(), r.produced.end());
+        pos += r.consumed.size();
+    }
+    REQUIRE(pos == encoded.size());
+    REQUIRE(result == values);
+}
+
+template <typename T>
+void check_type()
+{
+    constexpr T max_value = (std::numeric_limits<T>::max)();
+    for (std::size_t size : {0u, 1u, 5u, 127u, 128u, 129u, 1000u}) {
+        for (T range : {T{0}, T{1}, T{1000}, T{max_value / 3}, max_value}) {
+            auto values = random_values<T>(size, range, 7);
+            check_round_trip(values, for_codec{});
+            check_round_trip(values, delta_codec{});
+
+            std::sort(values.begin(), values.end());
+            check_round_trip(values, for_codec{});
+            check_round_trip(values, delta_codec{});
+        }
+    }
+}
+
+} // namespace
+
+TEST_CASE("block integer codecs")
+{
+    SECTION("round trips")
+    {
+        check_type<std::uint32_t>();
+        check_type<std::uint64_t>();
+    }
+
+    SECTION("sorted values compress")
+    {
+        std::vector<std::uint32_t> ids(1280);
+        for (std::size_t i = 0; i < ids.size(); i++) {
+            ids[i] = static_cast<std::uint32_t>(1000000 + 3 * i);
+        }
+        std::vector<byte> out(tcb::max_block_encoded_size<std::uint32_t>(
+            ids.size()));
+        // Deltas of 3 need two bits each
+        auto r = tcb::encode_delta(make_span(ids), make_span(out));
+        REQUIRE(r.produced.size() == 10 * (6 + 32));
+    }
+
+    SECTION("encoding stops when the output is full")
+    {
+        const auto values = random_values<std::uint32_t>(300, 100, 3);
+        std::vector<byte> out(100);
+        auto r = tcb::encode_for(make_span(values), make_span(out));
+        REQUIRE(r.consumed.empty());
+        REQUIRE(r.produced.empty());
+    }
+
+    SECTION("decoding stops at truncated or malformed blocks")
+    {
+        const auto values = random_values<std::uint64_t>(300, 1u << 20, 4);
+        std::vector<byte> encoded(
+            tcb::max_block_encoded_size<std::uint64_t>(values.size()));
+        auto enc = tcb::encode_delta(make_span(values), make_span(encoded));
+        auto bytes = enc.produced;
+
+        std::vector<std::uint64_t> out(values.size());
+        auto r = tcb::decode_delta(bytes.first(bytes.size() - 1),
+                                   make_span(out));
+        REQUIRE(r.produced.size() == 256);
+
+        r = tcb::decode_delta(bytes, make_span(out).first(255));
+        REQUIRE(r.produced.size() == 128);
+
+        bytes[1] = static_cast<byte>(65);
+        r = tcb::decode_delta(bytes, make_span(out));
+        REQUIRE(r.consumed.empty());
+        REQUIRE(r.produced.empty());
+    }
+}
+
+namespace {
+
+// A straightforward reference implementation, for comparison
+std::vector<std::uint64_t> reference_decode(const std::vector<byte>& bytes,
+                                            std::size_t& consumed)
+{
+    std::vector<std::uint64_t> values;
+    std::size_t pos = 0;
+    consumed = 0;
+    std::uint64_t v = 0;
+    unsigned shift = 0;
+    while (pos < bytes.size()) {
+        const auto b = static_cast<std::uint64_t>(bytes[pos++]);
+        if (shift == 63 && b > 1) {
+            break;
+        }
+        v |= (b & 0x7f) << shift;
+        if (b < 0x80) {
+            values.push_back(v);
+            consumed = pos;
+            v = 0;
+            shift = 0;
+        } else if ((shift += 7) > 63) {
+            break;
+        }
+    }
+    return values;
+}
+
+std::vector<std::uint64_t> random_varint_values(std::size_t size,
+                                                unsigned max_bits,
+                                                unsigned seed)
+{
+    std::mt19937_64 gen(seed);
+    std::uniform_int_distribution<unsigned> bits(0, max_bits);
+    std::vector<std::uint64_t> values(size);
+    for (auto& v : values) {
+        const unsigned b = bits(gen);
+        v = b == 0 ? 0 : gen() >> (64 - b);
+    }
+    return values;
+}
+
+void check_varint_round_trip(const std::vector<std::uint64_t>& values)
+{
+    std::vector<byte> encoded(tcb::max_varint_encoded_size(values.size()));
+    auto enc = tcb::encode_varints(make_span(values), make_span(encoded));
+    REQUIRE(enc.consumed.size() == values.size());
+    encoded.resize(enc.produced.size());
+
+    std::size_t ref_consumed = 0;
+    REQUIRE(reference_decode(encoded, ref_consumed) == values);
+    REQUIRE(ref_consumed == encoded.size());
+
+    std::vector<std::uint64_t> decoded(values.size());
+    auto dec = tcb::decode_varints(make_span(encoded), make_span(decoded));
+    REQUIRE(dec.consumed.size() == encoded.size());
+    REQUIRE(dec.produced.size() == values.size());
+    REQUIRE(decoded == values);
+
+    // Streaming through small buffers gives the same results
+    std::vector<byte> streamed;
+    std::vector<byte> buffer(13);
+    tcb::span<const std::uint64_t> rest = make_span(values);
+    while (!rest.empty()) {
+        auto r = tcb::encode_varints(rest, make_span(buffer));
+        REQUIRE(!r.consumed.empty());
+        streamed.insert(streamed.end(), r.produced.begin(), r.produced.end());
+        rest = rest.subspan(r.consumed.size());
+    }
+    REQUIRE(streamed == encoded);
+
+    std::vector<std::uint64_t> out_buffer(21);
+    std::vector<std::uint64_t> result;
+    std::size_t pos = 0;
+    std::size_t avail = 0;
+    while (result.size() < values.size()) {
+        avail = (std::min)(avail + 37, encoded.size());
+        auto r = tcb::decode_varints(
+            make_span(encoded).subspan(pos, avail - pos),
+            make_span(out_buffer));
+        result.insert(result.end(), r.produced.begin(), r.produced.end());
+        pos += r.consumed.size();
+    }
+    REQUIRE(pos == encoded.size());
+    REQUIRE(result == values);
+}
+
+} // namespace
+
+TEST_CASE("varints")
+{
+    SECTION("known encodings")
+    {
+        const std::uint64_t values[] = {0, 1, 127, 128, 300,
+                                        (std::numeric_limits<
+                                            std::uint64_t>::max)()};
+        std::vector<byte> out(tcb::max_varint_encoded_size(6));
+        auto r = tcb::encode_varints(make_span(values), make_span(out));
+        const unsigned char expected[] = {
+            0x00, 0x01, 0x7f, 0x80, 0x01, 0xac, 0x02, 0xff, 0xff,
+            0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01};
+        REQUIRE(r.produced.size() == sizeof(expected));
+        for (std::size_t i = 0; i < sizeof(expected); i++) {
+            REQUIRE(static_cast<unsigned>(r.produced[i]) == expected[i]);
+        }
+    }
+
+    SECTION("round trips")
+    {
+        for (std::size_t size : {0u, 1u, 15u, 16u, 17u, 100u, 5000u}) {
+            for (unsigned max_bits : {0u, 7u, 8u, 14u, 21u, 56u, 64u}) {
+                check_varint_round_trip(random_varint_values(
+                    size, max_bits, static_cast<unsigned>(size + max_bits)));
+            }
+        }
+    }
+
+    SECTION("malformed input")
+    {
+        // An eleven-byte varint, and a ten-byte one overflowing 64 bits
+        for (unsigned last : {0x80u, 0x02u}) {
+            std::vector<byte> bytes(20, static_cast<byte>(0x05));
+            for (std::size_t i = 3; i < 12; i++) {
+                bytes[i] = static_cast<byte>(0xff);
+            }
+            bytes[12] = static_cast<byte>(last);
+            std::vector<std::uint64_t> out(20);
+            auto r = tcb::decode_varints(make_span(bytes), make_span(out));
+            REQUIRE(r.produced.size() == 3);
+            REQUIRE(r.consumed.size() == 3);
+        }
+    }
+
+    SECTION("fuzzing against the reference decoder")
+    {
+        std::mt19937 gen(12345);
+        for (unsigned iter = 0; iter < 2000; iter++) {
+            // Vary the density of continuation bits
+            std::bernoulli_distribution more(iter % 10 / 10.0);
+            std::uniform_int_distribution<unsigned> low(0, 127);
+            std::vector<byte> bytes(gen() % 100);
+            for (auto& b : bytes) {
+                b = static_cast<byte>(low(gen) | (more(gen) ? 0x80 : 0));
+            }
+
+            std::size_t ref_consumed = 0;
+            const auto expected = reference_decode(bytes, ref_consumed);
+            std::vector<std::uint64_t> out(bytes.size() + 1);
+            const std::size_t out_size =
+                iter % 3 == 0 ? gen() % out.size() : out.size();
+            auto r = tcb::decode_varints(make_span(bytes),
+                                         make_span(out).first(out_size));
+            const std::size_t n = (std::min)(expected.size(), out_size);
+            REQUIRE(r.produced.size() == n);
+            REQUIRE(std::equal(r.produced.begin(), r.produced.end(),
+                               expected.begin()));
+            if (n == expected.size()) {
+                REQUIRE(r.consumed.size() == ref_consumed);
+            }
+        }
+    }
+}
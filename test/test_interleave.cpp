@@ -0,0 +1,201 @@
+
+#include <tcb/interleave.hpp>
+
+#include "catch.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+using tcb::make_span;
+
+namespace {
+
+struct point3 {
+    float x;
+    float y;
+    float z;
+};
+
+template <typename T>
+T value_at(std::size_t i)
+{
+    return static_cast<T>(i * 7 + 3);
+}
+
+// Checks the columns split from in, and in rejoined from them as out
+template <typename T>
+void check_columns(const std::vector<std::vector<T>>& cols,
+                   const std::vector<T>& in, std::vector<T>& out)
+{
+    const std::size_t n = cols.size();
+    const std::size_t rows = in.size() / n;
+    for (std::size_t r = 0; r < rows; r++) {
+        for (std::size_t k = 0; k < n; k++) {
+            REQUIRE(cols[k][r] == in[r * n + k]);
+        }
+    }
+    REQUIRE(out == in);
+}
+
+template <typename T>
+void check_round_trip_2()
+{
+    for (std::size_t rows : {0u, 1u, 15u, 16u, 33u, 100u}) {
+        std::vector<T> in(2 * rows);
+        for (std::size_t i = 0; i < in.size(); i++) {
+            in[i] = value_at<T>(i);
+        }
+        std::vector<std::vector<T>> cols(2, std::vector<T>(rows));
+        std::vector<T> out(in.size());
+        tcb::deinterleave(make_span(in), make_span(cols[0]),
+                          make_span(cols[1]));
+        tcb::interleave(make_span(cols[0]), make_span(cols[1]),
+                        make_span(out));
+        check_columns(cols, in, out);
+    }
+}
+
+template <typename T>
+void check_round_trip_3()
+{
+    for (std::size_t rows : {0u, 1u, 15u, 16u, 33u, 100u}) {
+        std::vector<T> in(3 * rows);
+        for (std::size_t i = 0; i < in.size(); i++) {
+            in[i] = value_at<T>(i);
+        }
+        std::vector<std::vector<T>> cols(3, std::vector<T>(rows));
+        std::vector<T> out(in.size());
+        tcb::deinterleave(make_span(in), make_span(cols[0]),
+                          make_span(cols[1]), make_span(cols[2]));
+        tcb::interleave(make_span(cols[0]), make_span(cols[1]),
+                        make_span(cols[2]), make_span(out));
+        check_columns(cols, in, out);
+    }
+}
+
+template <typename T>
+void check_round_trip_4()
+{
+    for (std::size_t rows : {0u, 1u, 15u, 16u, 33u, 100u}) {
+        std::vector<T> in(4 * rows);
+        for (std::size_t i = 0; i < in.size(); i++) {
+            in[i] = value_at<T>(i);
+        }
+        std::vector<std::vector<T>> cols(4, std::vector<T>(rows));
+        std::vector<T> out(in.size());
+        tcb::deinterleave(make_span(in), make_span(cols[0]),
+                          make_span(cols[1]), make_span(cols[2]),
+                          make_span(cols[3]));
+        tcb::interleave(make_span(cols[0]), make_span(cols[1]),
+                        make_span(cols[2]), make_span(cols[3]),
+                        make_span(out));
+        check_columns(cols, in, out);
+    }
+}
+
+template <typename T>
+void check_round_trip_8()
+{
+    for (std::size_t rows : {0u, 1u, 15u, 16u, 33u, 100u}) {
+        std::vector<T> in(8 * rows);
+        for (std::size_t i = 0; i < in.size(); i++) {
+            in[i] = value_at<T>(i);
+        }
+        std::vector<std::vector<T>> c(8, std::vector<T>(rows));
+        std::vector<T> out(in.size());
+        tcb::deinterleave(make_span(in), make_span(c[0]), make_span(c[1]),
+                          make_span(c[2]), make_span(c[3]), make_span(c[4]),
+                          make_span(c[5]), make_span(c[6]), make_span(c[7]));
+        tcb::interleave(make_span(c[0]), make_span(c[1]), make_span(c[2]),
+                        make_span(c[3]), make_span(c[4]), make_span(c[5]),
+                        make_span(c[6]), make_span(c[7]), make_span(out));
+        check_columns(c, in, out);
+    }
+}
+
+// Splits and rejoins N columns of T at sizes which exercise both the SIMD
+// kernels and the scalar tails
+template <typename T>
+void check_round_trips()
+{
+    check_round_trip_2<T>();
+    check_round_trip_3<T>();
+    check_round_trip_4<T>();
+    check_round_trip_8<T>();
+}
+
+} // namespace
+
+TEST_CASE("interleave and deinterleave")
+{
+    SECTION("arithmetic types of each size")
+    {
+        check_round_trips<std::uint8_t>();
+        check_round_trips<std::int16_t>();
+        check_round_trips<float>();
+        check_round_trips<double>();
+    }
+
+    SECTION("other column counts")
+    {
+        const int in[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+        int a[2], b[2], c[2], d[2], e[2];
+        tcb::deinterleave(make_span(in), make_span(a), make_span(b),
+                          make_span(c), make_span(d), make_span(e));
+        REQUIRE(a[1] == 6);
+        REQUIRE(e[0] == 5);
+
+        int one[10];
+        tcb::deinterleave(make_span(in), make_span(one));
+        REQUIRE(std::equal(one, one + 10, in));
+    }
+
+    SECTION("records")
+    {
+        std::vector<point3> points(50);
+        for (std::size_t i = 0; i < points.size(); i++) {
+            points[i] = {float(i), float(i) + 0.25f, float(i) + 0.5f};
+        }
+        std::vector<float> xs(50), ys(50), zs(50);
+        tcb::deinterleave(tcb::span<const point3>(points), make_span(xs),
+                          make_span(ys), make_span(zs));
+        for (std::size_t i = 0; i < points.size(); i++) {
+            REQUIRE(xs[i] == float(i));
+            REQUIRE(ys[i] == float(i) + 0.25f);
+            REQUIRE(zs[i] == float(i) + 0.5f);
+        }
+
+        std::vector<point3> back(50);
+        tcb::interleave(make_span(xs), make_span(ys), make_span(zs),
+                        make_span(back));
+        for (std::size_t i = 0; i < back.size(); i++) {
+            REQUIRE(back[i].x == points[i].x);
+            REQUIRE(back[i].z == points[i].z);
+        }
+    }
+
+    SECTION("static extents")
+    {
+        const std::array<double, 8> in = {{1, 2, 3, 4, 5, 6, 7, 8}};
+        std::array<double, 4> xs{}, ys{};
+        tcb::deinterleave(make_span(in), make_span(xs), make_span(ys));
+        REQUIRE(xs[3] == 7);
+        REQUIRE(ys[0] == 2);
+
+        std::array<double, 8> out{};
+        tcb::interleave(make_span(xs), make_span(ys), make_span(out));
+        REQUIRE(out == in);
+
+        // Large enough for the SIMD kernels
+        std::array<std::uint8_t, 300> bytes{};
+        for (std::size_t i = 0; i < bytes.size(); i++) {
+            bytes[i] = static_cast<std::uint8_t>(i);
+        }
+        std::array<std::uint8_t, 100> r{}, g{}, b{};
+        tcb::deinterleave(tcb::span<const std::uint8_t, 300>(bytes),
+                          make_span(r), make_span(g), make_span(b));
+        REQUIRE(r[99] == static_cast<std::uint8_t>(297));
+        REQUIRE(b[50] == static_cast<std::uint8_t>(152));
+    }
+}
@@ -0,0 +1,204 @@
+
+#include <tcb/merge.hpp>
+
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <utility>
+#include <vector>
+
+using tcb::make_span;
+using tcb::span;
+
+namespace {
+
+// Elements remember which input they came from, to check stability
+struct entry {
+    int key;
+    int source;
+    int pos;
+
+    friend bool operator==(const entry& a, const entry& b)
+    {
+        return a.key == b.key && a.source == b.source && a.pos == b.pos;
+    }
+};
+
+struct entry_less {
+    bool operator()(const entry& a, const entry& b) const
+    {
+        return a.key < b.key;
+    }
+};
+
+template <typename T>
+std::vector<std::vector<T>> random_runs(std::size_t k, std::size_t max_size,
+                                        int max_value, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<std::size_t> size_dist(0, max_size);
+    std::uniform_int_distribution<int> value_dist(0, max_value);
+    std::vector<std::vector<T>> runs(k);
+    for (auto& run : runs) {
+        run.resize(size_dist(gen));
+        for (auto& v : run) {
+            v = static_cast<T>(value_dist(gen));
+        }
+        std::sort(run.begin(), run.end());
+    }
+    return runs;
+}
+
+template <typename T>
+std::vector<span<const T>> spans_of(const std::vector<std::vector<T>>& runs)
+{
+    std::vector<span<const T>> spans;
+    for (const auto& run : runs) {
+        spans.emplace_back(run);
+    }
+    return spans;
+}
+
+template <typename T>
+std::vector<T> expected_merge(const std::vector<std::vector<T>>& runs)
+{
+    std::vector<T> all;
+    for (const auto& run : runs) {
+        all.insert(all.end(), run.begin(), run.end());
+    }
+    std::stable_sort(all.begin(), all.end());
+    return all;
+}
+
+template <typename T>
+void check_merge(std::size_t k, std::size_t max_size, int max_value)
+{
+    const auto runs = random_runs<T>(k, max_size, max_value,
+                                     static_cast<unsigned>(k * max_size));
+    const auto spans = spans_of(runs);
+    const auto expected = expected_merge(runs);
+
+    std::vector<T> out(expected.size() + 5);
+    auto res = tcb::merge_sorted(make_span(spans), make_span(out));
+    REQUIRE(res.data() == out.data());
+    REQUIRE(std::vector<T>(res.begin(), res.end()) == expected);
+}
+
+std::vector<std::vector<entry>> entry_runs(std::size_t k, std::size_t size)
+{
+    std::mt19937 gen(static_cast<unsigned>(k));
+    std::uniform_int_distribution<int> dist(0, 20);
+    std::vector<std::vector<entry>> runs(k);
+    for (std::size_t s = 0; s < k; s++) {
+        std::vector<int> keys(size);
+        for (auto& key : keys) {
+            key = dist(gen);
+        }
+        std::sort(keys.begin(), keys.end());
+        for (std::size_t i = 0; i < size; i++) {
+            runs[s].push_back(entry{keys[i], static_cast<int>(s),
+                                    static_cast<int>(i)});
+        }
+    }
+    return runs;
+}
+
+std::vector<entry> expected_entries(const std::vector<std::vector<entry>>& runs)
+{
+    std::vector<entry> all;
+    for (const auto& run : runs) {
+        all.insert(all.end(), run.begin(), run.end());
+    }
+    std::stable_sort(all.begin(), all.end(), entry_less{});
+    return all;
+}
+
+} // namespace
+
+TEST_CASE("merge_sorted()")
+{
+    for (std::size_t k : {0u, 1u, 2u, 3u, 5u, 16u, 17u, 40u}) {
+        for (std::size_t max_size : {0u, 3u, 10u, 1000u}) {
+            check_merge<std::int32_t>(k, max_size, 100);
+            check_merge<std::int32_t>(k, max_size, 1 << 30);
+            check_merge<std::uint32_t>(k, max_size, 1000);
+            check_merge<double>(k, max_size, 1000);
+        }
+    }
+
+    SECTION("stability")
+    {
+        for (std::size_t k : {2u, 3u, 7u}) {
+            const auto runs = entry_runs(k, 200);
+            const auto spans = spans_of(runs);
+            std::vector<entry> out(k * 200);
+            tcb::merge_sorted(make_span(spans), make_span(out), entry_less{});
+            REQUIRE(out == expected_entries(runs));
+        }
+    }
+
+    SECTION("custom comparator")
+    {
+        const std::vector<int> a{9, 5, 1};
+        const std::vector<int> b{8, 5, 5, 0};
+        const std::vector<int> c{7};
+        const span<const int> spans[] = {a, b, c};
+        std::vector<int> out(8);
+        tcb::merge_sorted(make_span(spans), make_span(out),
+                          std::greater<int>{});
+        REQUIRE(out == (std::vector<int>{9, 8, 7, 5, 5, 5, 1, 0}));
+    }
+}
+
+TEST_CASE("merge_sorted_parallel()")
+{
+    for (std::size_t k : {1u, 2u, 5u, 20u}) {
+        for (unsigned threads : {0u, 2u, 3u, 8u}) {
+            // Few distinct values, so that splits land among equal elements
+            const auto runs =
+                random_runs<std::int32_t>(k, 400000 / k, 50, threads + 1);
+            const auto spans = spans_of(runs);
+            const auto expected = expected_merge(runs);
+            std::vector<std::int32_t> out(expected.size());
+            tcb::merge_sorted_parallel(make_span(spans), make_span(out),
+                                       threads);
+            REQUIRE(out == expected);
+        }
+    }
+
+    SECTION("stability")
+    {
+        const auto runs = entry_runs(6, 30000);
+        const auto spans = spans_of(runs);
+        std::vector<entry> out(6 * 30000);
+        tcb::merge_sorted_parallel(make_span(spans), make_span(out), 4,
+                                   entry_less{});
+        REQUIRE(out == expected_entries(runs));
+    }
+}
+
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+TEST_CASE("merge_sorted() SSE4.1 kernel")
+{
+    if (!tcb::detail::cpu().sse41) {
+        return;
+    }
+    for (std::size_t n : {4u, 5u, 8u, 33u, 1000u}) {
+        auto runs = random_runs<std::int32_t>(2, n, 1000,
+                                              static_cast<unsigned>(n));
+        runs[0].resize(n, 2000);
+        runs[1].insert(runs[1].begin(), -5);
+        std::sort(runs[1].begin(), runs[1].end());
+        const auto expected = expected_merge(runs);
+        std::vector<std::int32_t> out(expected.size());
+        const auto& a = runs[0];
+        const auto& b = runs[1];
+        tcb::detail::merge2_sse41(a.data(), a.data() + a.size(), b.data(),
+                                  b.data() + b.size(), out.data());
+        REQUIRE(out == expected);
+    }
+}
+#endif
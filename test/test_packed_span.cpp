@@ -0,0 +1,111 @@
+
+#include <tcb/packed_span.hpp>
+
+#include "catch.hpp"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using tcb::make_span;
+using tcb::packed_span;
+
+namespace {
+
+template <unsigned Bits>
+void check_packed(std::size_t size)
+{
+    using packed = packed_span<Bits>;
+    std::mt19937 gen(Bits * 1000 + static_cast<unsigned>(size));
+    std::uniform_int_distribution<std::uint32_t> dist(0, packed::max_value);
+    std::vector<std::uint32_t> values(size);
+    for (auto& v : values) {
+        v = dist(gen);
+    }
+
+    // Fill the words with a pattern, to check that neighbours are preserved
+    std::vector<std::uint64_t> words(packed::words_needed(size) + 1,
+                                     0xa5a5a5a5a5a5a5a5u);
+    const std::uint64_t sentinel = words.back();
+    const packed p(make_span(words), size);
+    REQUIRE(p.size() == size);
+
+    for (std::size_t i = 0; i < size; i++) {
+        p[i] = values[i];
+    }
+    for (std::size_t i = 0; i < size; i++) {
+        REQUIRE(p.get(i) == values[i]);
+    }
+    REQUIRE(words.back() == sentinel);
+
+    std::vector<std::uint32_t> out(size + 3);
+    auto res = tcb::unpack(p, make_span(out));
+    REQUIRE(res.size() == size);
+    REQUIRE(std::vector<std::uint32_t>(res.begin(), res.end()) == values);
+
+    // pack() into fresh words agrees with set()
+    std::vector<std::uint64_t> packed_words(words.size(), sentinel);
+    const packed q(make_span(packed_words), size);
+    auto written = tcb::pack(make_span(values), q);
+    REQUIRE(written.size() == size);
+    for (std::size_t i = 0; i < size; i++) {
+        REQUIRE(q[i] == values[i]);
+    }
+    REQUIRE(packed_words == words);
+
+    // Packing a prefix leaves the values after it unchanged
+    if (size > 3) {
+        std::vector<std::uint32_t> zeros(size / 2);
+        tcb::pack(make_span(zeros), q);
+        for (std::size_t i = 0; i < size; i++) {
+            REQUIRE(q.get(i) == (i < size / 2 ? 0 : values[i]));
+        }
+    }
+}
+
+template <unsigned Bits>
+void check_sizes()
+{
+    for (std::size_t size : {0u, 1u, 7u, 8u, 9u, 64u, 100u, 1001u}) {
+        check_packed<Bits>(size);
+    }
+}
+
+} // namespace
+
+TEST_CASE("packed_span")
+{
+    check_sizes<1>();
+    check_sizes<3>();
+    check_sizes<7>();
+    check_sizes<8>();
+    check_sizes<12>();
+    check_sizes<17>();
+    check_sizes<20>();
+    check_sizes<25>();
+    check_sizes<26>();
+    check_sizes<31>();
+    check_sizes<32>();
+
+    SECTION("const words")
+    {
+        std::vector<std::uint64_t> words(2);
+        const packed_span<5> p(make_span(words), 20);
+        p.set(13, 21);
+        const packed_span<5, const std::uint64_t> c = p;
+        REQUIRE(c[13] == 21);
+        REQUIRE(c.get(12) == 0);
+        REQUIRE(c.words().data() == words.data());
+    }
+
+    SECTION("references")
+    {
+        std::vector<std::uint64_t> words(1);
+        const packed_span<4> p(make_span(words), 16);
+        p[3] = 9;
+        p[4] = p[3];
+        REQUIRE(p[4] == 9);
+        REQUIRE(words[0] == 0x99000u);
+        REQUIRE(p.first(4).size() == 4);
+    }
+}
@@ -0,0 +1,65 @@
+
+#include <tcb/prefetch.hpp>
+
+#include "catch.hpp"
+
+#include <numeric>
+#include <vector>
+
+using tcb::make_span;
+using tcb::span;
+
+namespace {
+
+struct record {
+    long key;
+    char payload[120];
+};
+
+} // namespace
+
+static_assert(tcb::default_prefetch_distance<int>() <=
+                  tcb::default_prefetch_distance<record>(),
+              "");
+
+TEST_CASE("prefetch()")
+{
+    std::vector<int> vec(1000);
+    tcb::prefetch(make_span(vec));
+    tcb::prefetch(make_span(vec).subspan(3, 17), tcb::prefetch_locality::none);
+    tcb::prefetch(span<int>{});
+}
+
+TEST_CASE("for_each_prefetch()")
+{
+    SECTION("small elements")
+    {
+        std::vector<int> vec(1000);
+        std::iota(vec.begin(), vec.end(), 0);
+
+        std::vector<int> seen;
+        tcb::for_each_prefetch(make_span(vec).subspan(1), 2,
+                               [&](int i) { seen.push_back(i); });
+        REQUIRE(seen.size() == 999);
+        REQUIRE(std::equal(seen.begin(), seen.end(), vec.begin() + 1));
+    }
+
+    SECTION("large mutable elements, default distance")
+    {
+        std::vector<record> vec(100);
+        long n = 0;
+        tcb::for_each_prefetch(make_span(vec), [&](record& r) { r.key = n++; });
+        REQUIRE(vec.front().key == 0);
+        REQUIRE(vec.back().key == 99);
+    }
+
+    SECTION("returns the function object")
+    {
+        struct counter {
+            int n = 0;
+            void operator()(int) { ++n; }
+        };
+        const int arr[] = {1, 2, 3};
+        REQUIRE(tcb::for_each_prefetch(make_span(arr), counter{}).n == 3);
+    }
+}
@@ -0,0 +1,169 @@
+
+#include <tcb/radix_sort.hpp>
+
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using tcb::make_span;
+
+namespace {
+
+template <typename T>
+std::vector<T> random_values(std::size_t size, unsigned seed)
+{
+    std::mt19937_64 gen(seed);
+    std::vector<T> vec(size);
+    for (auto& v : vec) {
+        // Use a small range for some inputs, so that passes can be skipped
+        const std::uint64_t bits = gen();
+        v = static_cast<T>(seed % 2 ? bits : bits % 1000);
+        if (std::is_signed<T>::value && (bits >> 63)) {
+            v = static_cast<T>(-v);
+        }
+    }
+    return vec;
+}
+
+template <typename T>
+void check_sort(std::vector<T> vec)
+{
+    std::vector<T> expected = vec;
+    std::sort(expected.begin(), expected.end());
+    std::vector<T> scratch(vec.size());
+    tcb::radix_sort(make_span(vec), make_span(scratch));
+    REQUIRE(vec == expected);
+}
+
+template <typename T>
+void check_sizes()
+{
+    for (std::size_t size : {0u, 1u, 2u, 63u, 64u, 65u, 1000u, 10000u}) {
+        check_sort(random_values<T>(size, static_cast<unsigned>(size)));
+        check_sort(random_values<T>(size, static_cast<unsigned>(size + 1)));
+    }
+}
+
+} // namespace
+
+TEST_CASE("radix_sort() on integers")
+{
+    check_sizes<std::uint8_t>();
+    check_sizes<std::int8_t>();
+    check_sizes<std::int16_t>();
+    check_sizes<std::uint32_t>();
+    check_sizes<std::int32_t>();
+    check_sizes<std::uint64_t>();
+    check_sizes<std::int64_t>();
+
+    SECTION("extreme values")
+    {
+        using lim = std::numeric_limits<std::int64_t>;
+        std::vector<std::int64_t> vec(100, 0);
+        for (std::size_t i = 0; i < vec.size(); i += 3) {
+            vec[i] = i % 2 ? (lim::min)() : (lim::max)();
+        }
+        vec[1] = -1;
+        check_sort(vec);
+    }
+}
+
+TEST_CASE("radix_sort() on floating-point values")
+{
+    check_sizes<float>();
+    check_sizes<double>();
+
+    SECTION("special values")
+    {
+        const double inf = std::numeric_limits<double>::infinity();
+        std::vector<double> vec;
+        for (int i = 0; i < 100; i++) {
+            vec.push_back(i % 2 ? -0.5 * i : 0.25 * i);
+        }
+        vec.insert(vec.end(), {inf, -inf, -0.0, 1e-310, -1e-310,
+                               (std::numeric_limits<double>::max)(),
+                               std::numeric_limits<double>::lowest()});
+        std::vector<double> scratch(vec.size());
+        tcb::radix_sort(make_span(vec), make_span(scratch));
+        REQUIRE(std::is_sorted(vec.begin(), vec.end()));
+        REQUIRE(vec.front() == -inf);
+        REQUIRE(vec.back() == inf);
+        // -0.0 sorts before +0.0
+        const auto zero = std::find(vec.begin(), vec.end(), 0.0);
+        REQUIRE(std::signbit(*zero));
+        REQUIRE(!std::signbit(*(zero + 1)));
+    }
+}
+
+TEST_CASE("radix_sort() with values")
+{
+    for (std::size_t size : {10u, 1000u}) {
+        std::vector<std::int32_t> keys = random_values<std::int32_t>(size, 4);
+        std::vector<std::string> values;
+        for (std::size_t i = 0; i < size; i++) {
+            values.push_back(std::to_string(keys[i]) + "/" +
+                             std::to_string(i));
+        }
+
+        std::vector<std::pair<std::int32_t, std::string>> expected;
+        for (std::size_t i = 0; i < size; i++) {
+            expected.emplace_back(keys[i], values[i]);
+        }
+        // Equal keys keep their original order
+        std::stable_sort(
+            expected.begin(), expected.end(),
+            [](const std::pair<std::int32_t, std::string>& a,
+               const std::pair<std::int32_t, std::string>& b) {
+                return a.first < b.first;
+            });
+
+        std::vector<std::int32_t> key_scratch(size);
+        std::vector<std::string> value_scratch(size);
+        tcb::radix_sort(make_span(keys), make_span(values),
+                        make_span(key_scratch), make_span(value_scratch));
+        for (std::size_t i = 0; i < size; i++) {
+            REQUIRE(keys[i] == expected[i].first);
+            REQUIRE(values[i] == expected[i].second);
+        }
+    }
+}
+
+TEST_CASE("radix_sort_parallel()")
+{
+    for (unsigned threads : {0u, 1u, 3u, 4u}) {
+        std::vector<std::uint64_t> vec =
+            random_values<std::uint64_t>(300000, threads + 1);
+        std::vector<std::uint64_t> expected = vec;
+        std::sort(expected.begin(), expected.end());
+        std::vector<std::uint64_t> scratch(vec.size());
+        tcb::radix_sort_parallel(make_span(vec), make_span(scratch), threads);
+        REQUIRE(vec == expected);
+
+        std::vector<std::int32_t> keys =
+            random_values<std::int32_t>(200000, threads);
+        std::vector<std::uint32_t> values(keys.size());
+        for (std::size_t i = 0; i < values.size(); i++) {
+            values[i] = static_cast<std::uint32_t>(i);
+        }
+        std::vector<std::int32_t> key_scratch(keys.size());
+        std::vector<std::uint32_t> value_scratch(keys.size());
+        std::vector<std::int32_t> original = keys;
+        tcb::radix_sort_parallel(make_span(keys), make_span(values),
+                                 make_span(key_scratch),
+                                 make_span(value_scratch), threads);
+        REQUIRE(std::is_sorted(keys.begin(), keys.end()));
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            REQUIRE(original[values[i]] == keys[i]);
+            // Stability: equal keys have increasing original positions
+            if (i > 0 && keys[i] == keys[i - 1]) {
+                REQUIRE(values[i] > values[i - 1]);
+            }
+        }
+    }
+}
@@ -0,0 +1,179 @@
+
+#include <tcb/set_ops.hpp>
+
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+using tcb::make_span;
+using tcb::span;
+
+namespace {
+
+template <typename T>
+std::vector<T> random_set(std::size_t size, int max, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> dist(-max, max);
+    std::vector<T> vec(size);
+    for (auto& v : vec) {
+        v = static_cast<T>(dist(gen));
+    }
+    std::sort(vec.begin(), vec.end());
+    vec.erase(std::unique(vec.begin(), vec.end()), vec.end());
+    return vec;
+}
+
+template <typename T>
+void check_set_ops(const std::vector<T>& a, const std::vector<T>& b)
+{
+    std::vector<T> expected;
+    std::vector<T> out(a.size() + b.size());
+
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                          std::back_inserter(expected));
+    auto res = tcb::set_intersection(make_span(a), make_span(b),
+                                     make_span(out));
+    REQUIRE(res.data() == out.data());
+    REQUIRE(std::vector<T>(res.begin(), res.end()) == expected);
+
+    // An output exactly large enough
+    std::vector<T> exact(expected.size());
+    res = tcb::set_intersection(make_span(a), make_span(b), make_span(exact));
+    REQUIRE(exact == expected);
+
+    expected.clear();
+    std::set_union(a.begin(), a.end(), b.begin(), b.end(),
+                   std::back_inserter(expected));
+    res = tcb::set_union(make_span(a), make_span(b), make_span(out));
+    REQUIRE(std::vector<T>(res.begin(), res.end()) == expected);
+
+    expected.clear();
+    std::set_difference(a.begin(), a.end(), b.begin(), b.end(),
+                        std::back_inserter(expected));
+    res = tcb::set_difference(make_span(a), make_span(b), make_span(out));
+    REQUIRE(std::vector<T>(res.begin(), res.end()) == expected);
+}
+
+template <typename T>
+void check_sizes(std::size_t size_a, std::size_t size_b, int max)
+{
+    const auto a = random_set<T>(size_a, max, static_cast<unsigned>(size_a));
+    const auto b =
+        random_set<T>(size_b, max, static_cast<unsigned>(size_b + 7));
+    check_set_ops(a, b);
+    check_set_ops(b, a);
+}
+
+} // namespace
+
+TEST_CASE("set operations")
+{
+    // Similar sizes, and skewed enough to gallop
+    const std::size_t sizes[][2] = {{0, 0},     {0, 10},   {1, 1},
+                                    {10, 12},   {100, 90}, {1000, 3000},
+                                    {5, 1000},  {1, 5000}, {40, 10000}};
+    for (const auto& s : sizes) {
+        check_sizes<std::uint32_t>(s[0], s[1], 2000);
+        check_sizes<std::uint32_t>(s[0], s[1], 100000);
+        check_sizes<std::int32_t>(s[0], s[1], 2000);
+        check_sizes<std::int64_t>(s[0], s[1], 2000);
+        check_sizes<double>(s[0], s[1], 2000);
+    }
+
+    SECTION("custom comparator")
+    {
+        const std::vector<std::string> a{"pear", "fig", "apple"};
+        const std::vector<std::string> b{"kiwi", "fig", "banana"};
+        std::vector<std::string> out(6);
+        const std::greater<std::string> comp;
+
+        auto res = tcb::set_intersection(make_span(a), make_span(b),
+                                         make_span(out), comp);
+        REQUIRE(std::vector<std::string>(res.begin(), res.end()) ==
+                std::vector<std::string>{"fig"});
+
+        res = tcb::set_union(make_span(a), make_span(b), make_span(out), comp);
+        REQUIRE(std::vector<std::string>(res.begin(), res.end()) ==
+                (std::vector<std::string>{"pear", "kiwi", "fig", "banana",
+                                          "apple"}));
+
+        res = tcb::set_difference(make_span(a), make_span(b), make_span(out),
+                                  comp);
+        REQUIRE(std::vector<std::string>(res.begin(), res.end()) ==
+                (std::vector<std::string>{"pear", "apple"}));
+    }
+}
+
+TEST_CASE("unique()")
+{
+    std::mt19937 gen(1);
+    std::uniform_int_distribution<int> dist(0, 50);
+    for (std::size_t size : {0u, 1u, 2u, 100u, 1000u}) {
+        std::vector<int> in(size);
+        for (auto& i : in) {
+            i = dist(gen);
+        }
+        std::sort(in.begin(), in.end());
+        std::vector<int> expected;
+        std::unique_copy(in.begin(), in.end(), std::back_inserter(expected));
+
+        std::vector<int> out(size);
+        auto res = tcb::unique(make_span(in), make_span(out));
+        REQUIRE(std::vector<int>(res.begin(), res.end()) == expected);
+
+        // Exactly large enough
+        std::vector<int> exact(expected.size());
+        res = tcb::unique(make_span(in), make_span(exact));
+        REQUIRE(exact == expected);
+
+        // In place
+        res = tcb::unique(make_span(in), make_span(in));
+        REQUIRE(res.data() == in.data());
+        REQUIRE(std::vector<int>(res.begin(), res.end()) == expected);
+    }
+
+    SECTION("non-trivial types, in place")
+    {
+        std::vector<std::string> in{"a", "a", "b", "c", "c", "c", "d"};
+        auto res = tcb::unique(make_span(in), make_span(in));
+        REQUIRE(std::vector<std::string>(res.begin(), res.end()) ==
+                (std::vector<std::string>{"a", "b", "c", "d"}));
+    }
+}
+
+#if defined(TCB_SPAN_HAVE_X86_SIMD)
+TEST_CASE("set_intersection() SSSE3 kernel")
+{
+    const auto& cpu = tcb::detail::cpu();
+    if (!cpu.ssse3 || !cpu.popcnt) {
+        return;
+    }
+    const auto a = random_set<std::uint32_t>(500, 1000, 1);
+    const auto b = random_set<std::uint32_t>(500, 1000, 2);
+    std::vector<std::uint32_t> expected;
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                          std::back_inserter(expected));
+
+    std::vector<std::uint32_t> out(500);
+    tcb::detail::set_output<std::uint32_t> res{out.data(), out.size(), 0};
+    const std::uint32_t* pa = a.data();
+    const std::uint32_t* pb = b.data();
+    tcb::detail::intersect_ssse3(pa, a.data() + a.size(), pb,
+                                 b.data() + b.size(), res);
+    REQUIRE(res.n > 0);
+    // The kernel stops when either input has less than a block left
+    REQUIRE((a.data() + a.size() - pa < 4 || b.data() + b.size() - pb < 4));
+    std::less<std::uint32_t> comp;
+    tcb::detail::intersect_scalar(pa, a.data() + a.size(), pb,
+                                  b.data() + b.size(), res, comp);
+    out.resize(res.n);
+    REQUIRE(out == expected);
+}
+#endif
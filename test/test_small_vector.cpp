@@ -0,0 +1,221 @@
+
+#include <tcb/small_vector.hpp>
+
+#include "catch.hpp"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+using tcb::small_vector;
+using tcb::span;
+
+static_assert(tcb::detail::is_container<small_vector<int, 4>>::value, "");
+static_assert(std::is_convertible<small_vector<int, 4>&, span<int>>::value, "");
+static_assert(
+    std::is_convertible<const small_vector<int, 4>&, span<const int>>::value,
+    "");
+static_assert(
+    !std::is_convertible<const small_vector<int, 4>&, span<int>>::value, "");
+
+namespace {
+
+// Counts live instances. Copying throws once copies_left reaches zero, and
+// with no move constructor, reallocation has to copy. Destroying an object
+// which isn't alive fails the self check.
+struct throwing_copy {
+    static int live;
+    static int copies_left;
+    const throwing_copy* self;
+    int value;
+
+    explicit throwing_copy(int v) : self(this), value(v) { ++live; }
+
+    throwing_copy(const throwing_copy& other) : self(this), value(other.value)
+    {
+        if (copies_left-- == 0) {
+            throw std::runtime_error("copy");
+        }
+        ++live;
+    }
+
+    ~throwing_copy()
+    {
+        CHECK(self == this);
+        self = nullptr;
+        --live;
+    }
+};
+
+int throwing_copy::live = 0;
+int throwing_copy::copies_left = 0;
+
+} // namespace
+
+TEST_CASE("small_vector construction")
+{
+    SECTION("default")
+    {
+        small_vector<int, 4> v;
+        REQUIRE(v.empty());
+        REQUIRE(v.capacity() == 4);
+        REQUIRE(v.is_inline());
+    }
+
+    SECTION("count and value")
+    {
+        small_vector<int, 4> v(3, 42);
+        REQUIRE(v.size() == 3);
+        REQUIRE(v.is_inline());
+        for (int i : v) {
+            REQUIRE(i == 42);
+        }
+    }
+
+    SECTION("initializer list, spilling to the heap")
+    {
+        small_vector<int, 2> v{1, 2, 3, 4, 5};
+        REQUIRE(v.size() == 5);
+        REQUIRE_FALSE(v.is_inline());
+        REQUIRE(v[4] == 5);
+    }
+
+    SECTION("iterator range")
+    {
+        const int arr[] = {1, 2, 3};
+        small_vector<int, 8> v(std::begin(arr), std::end(arr));
+        REQUIRE(v.size() == 3);
+        REQUIRE(v.back() == 3);
+    }
+}
+
+TEST_CASE("small_vector growth")
+{
+    small_vector<std::string, 2> v;
+    v.push_back("a");
+    v.push_back("b");
+    REQUIRE(v.is_inline());
+
+    v.push_back("c");
+    REQUIRE_FALSE(v.is_inline());
+    REQUIRE(v.capacity() >= 3);
+    REQUIRE(v[0] == "a");
+    REQUIRE(v[1] == "b");
+    REQUIRE(v[2] == "c");
+
+    // Self-referencing insertion must survive reallocation
+    while (v.size() < v.capacity()) {
+        v.push_back("x");
+    }
+    v.push_back(v.front());
+    REQUIRE(v.back() == "a");
+
+    v.resize(1);
+    v.shrink_to_fit();
+    REQUIRE(v.is_inline());
+    REQUIRE(v.size() == 1);
+    REQUIRE(v[0] == "a");
+}
+
+TEST_CASE("small_vector growth when copying throws")
+{
+    {
+        small_vector<throwing_copy, 2> v;
+        v.emplace_back(1);
+        v.emplace_back(2);
+
+        // The new element is built, then the second relocating copy throws
+        throwing_copy::copies_left = 1;
+        REQUIRE_THROWS_AS(v.emplace_back(3), std::runtime_error);
+        REQUIRE(throwing_copy::live == 2);
+        REQUIRE(v.size() == 2);
+        REQUIRE(v.is_inline());
+        REQUIRE(v[0].value == 1);
+        REQUIRE(v[1].value == 2);
+
+        throwing_copy::copies_left = 2;
+        v.emplace_back(3);
+        REQUIRE(v.size() == 3);
+        REQUIRE(v[2].value == 3);
+    }
+    REQUIRE(throwing_copy::live == 0);
+}
+
+TEST_CASE("small_vector insert and erase")
+{
+    small_vector<int, 4> v{1, 2, 4};
+
+    auto it = v.insert(v.begin() + 2, 3);
+    REQUIRE(*it == 3);
+    REQUIRE(v == (small_vector<int, 4>{1, 2, 3, 4}));
+
+    v.insert(v.begin(), 0);
+    REQUIRE(v == (small_vector<int, 4>{0, 1, 2, 3, 4}));
+
+    it = v.erase(v.begin() + 1, v.begin() + 3);
+    REQUIRE(*it == 3);
+    REQUIRE(v == (small_vector<int, 4>{0, 3, 4}));
+
+    v.erase(v.begin());
+    v.pop_back();
+    REQUIRE(v == (small_vector<int, 4>{3}));
+}
+
+TEST_CASE("small_vector copy and move")
+{
+    SECTION("inline")
+    {
+        small_vector<std::unique_ptr<int>, 4> v;
+        v.emplace_back(new int(1));
+        v.emplace_back(new int(2));
+
+        auto w = std::move(v);
+        REQUIRE(w.size() == 2);
+        REQUIRE(*w[1] == 2);
+        REQUIRE(v.empty());
+    }
+
+    SECTION("heap")
+    {
+        small_vector<int, 2> v{1, 2, 3};
+        const int* data = v.data();
+
+        auto w = std::move(v);
+        REQUIRE(w.data() == data);
+        REQUIRE(v.empty());
+        REQUIRE(v.is_inline());
+
+        small_vector<int, 2> x;
+        x = w;
+        REQUIRE(x == w);
+        REQUIRE(x.data() != w.data());
+    }
+
+    SECTION("swap")
+    {
+        small_vector<int, 2> a{1};
+        small_vector<int, 2> b{2, 3, 4};
+        swap(a, b);
+        REQUIRE(a == (small_vector<int, 2>{2, 3, 4}));
+        REQUIRE(b == (small_vector<int, 2>{1}));
+    }
+}
+
+TEST_CASE("small_vector span views")
+{
+    small_vector<int, 3> v{1, 2, 3};
+
+    span<int> s = v;
+    REQUIRE(s.data() == v.data());
+    REQUIRE(s.size() == 3);
+
+    auto cs = tcb::make_span(static_cast<const small_vector<int, 3>&>(v));
+    static_assert(std::is_same<decltype(cs), span<const int>>::value, "");
+    REQUIRE(cs.size() == 3);
+
+    auto fs = v.fixed_span();
+    static_assert(std::is_same<decltype(fs), span<int, 3>>::value, "");
+    REQUIRE(fs.data() == v.data());
+    fs[0] = 10;
+    REQUIRE(v[0] == 10);
+}
@@ -0,0 +1,195 @@
+
+#include <tcb/soa_span.hpp>
+
+#include "catch.hpp"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using tcb::make_span;
+
+namespace {
+
+struct points {
+    std::vector<float> x;
+    std::vector<int> id;
+    std::vector<std::string> name;
+
+    explicit points(std::size_t size) : x(size), id(size), name(size)
+    {
+        for (std::size_t i = 0; i < size; i++) {
+            x[i] = static_cast<float>((i * 37) % 11) - 5.0f;
+            id[i] = static_cast<int>(i);
+            name[i] = "p" + std::to_string(i);
+        }
+    }
+
+    tcb::soa_span<float, int, std::string> view()
+    {
+        return tcb::make_soa_span(make_span(x), make_span(id),
+                                  make_span(name));
+    }
+};
+
+} // namespace
+
+TEST_CASE("soa_span")
+{
+    SECTION("construction and element access")
+    {
+        points p(10);
+        auto s = p.view();
+        REQUIRE(s.size() == 10);
+        REQUIRE(!s.empty());
+        REQUIRE(decltype(s)::columns == 3);
+        REQUIRE(s.column<1>().data() == p.id.data());
+
+        std::get<0>(s[3]) = 42.0f;
+        REQUIRE(p.x[3] == 42.0f);
+        REQUIRE(std::get<2>(s[3]) == "p3");
+
+        tcb::soa_span<const float, const int, const std::string> c = s;
+        REQUIRE(std::get<1>(c[9]) == 9);
+
+        tcb::soa_span<int> empty;
+        REQUIRE(empty.empty());
+        REQUIRE(empty.begin() == empty.end());
+    }
+
+    SECTION("slicing applies to every column")
+    {
+        points p(10);
+        auto s = p.view();
+        REQUIRE(std::get<1>(s.first(4)[3]) == 3);
+        REQUIRE(s.first(4).size() == 4);
+        REQUIRE(std::get<2>(s.last(3)[0]) == "p7");
+        auto sub = s.subspan(2, 5);
+        REQUIRE(sub.size() == 5);
+        REQUIRE(std::get<1>(sub[0]) == 2);
+        REQUIRE(sub.column<0>().data() == p.x.data() + 2);
+        REQUIRE(s.subspan(6).size() == 4);
+    }
+
+    SECTION("iteration")
+    {
+        points p(20);
+        auto s = p.view();
+        int expected = 0;
+        for (std::tuple<float&, int&, std::string&> row : s) {
+            REQUIRE(std::get<1>(row) == expected++);
+        }
+        REQUIRE(s.end() - s.begin() == 20);
+        REQUIRE(std::get<1>(*(s.begin() + 5)) == 5);
+        REQUIRE(std::get<1>(s.begin()[7]) == 7);
+
+        const auto it = std::find_if(
+            s.begin(), s.end(),
+            [](std::tuple<float&, int&, std::string&> row) {
+                return std::get<2>(row) == "p12";
+            });
+        REQUIRE(it - s.begin() == 12);
+    }
+
+    SECTION("sorting by a column")
+    {
+        const points original(100);
+        points p(100);
+        auto s = p.view();
+        tcb::sort_by_column<0>(s);
+        REQUIRE(std::is_sorted(p.x.begin(), p.x.end()));
+        for (std::size_t i = 0; i < p.x.size(); i++) {
+            // The rows stay together...
+            REQUIRE(p.name[i] == "p" + std::to_string(p.id[i]));
+            REQUIRE(p.x[i] == original.x[static_cast<std::size_t>(p.id[i])]);
+            // ...and the sort is stable
+            if (i > 0 && p.x[i] == p.x[i - 1]) {
+                REQUIRE(p.id[i] > p.id[i - 1]);
+            }
+        }
+
+        // With a comparison, by a column of non-arithmetic type
+        tcb::sort_by_column<2>(s, std::greater<std::string>());
+        REQUIRE(std::is_sorted(p.name.rbegin(), p.name.rend()));
+        for (std::size_t i = 0; i < p.x.size(); i++) {
+            REQUIRE(p.name[i] == "p" + std::to_string(p.id[i]));
+        }
+
+        // Sorting a slice leaves the rest alone
+        points q(50);
+        tcb::sort_by_column<0>(q.view().subspan(10, 20));
+        REQUIRE(std::is_sorted(q.x.begin() + 10, q.x.begin() + 30));
+        REQUIRE(q.id[9] == 9);
+        REQUIRE(q.id[30] == 30);
+    }
+
+    SECTION("sorting random keys")
+    {
+        std::mt19937 gen(3);
+        std::vector<std::uint64_t> keys(5000);
+        std::vector<double> values(keys.size());
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            keys[i] = gen() % 1000;
+            values[i] = static_cast<double>(keys[i]) * 0.5;
+        }
+        tcb::sort_by_column<0>(
+            tcb::make_soa_span(make_span(keys), make_span(values)));
+        REQUIRE(std::is_sorted(keys.begin(), keys.end()));
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            REQUIRE(values[i] == static_cast<double>(keys[i]) * 0.5);
+        }
+    }
+
+    SECTION("compress_if")
+    {
+        const points original(30);
+        points p(30);
+        points out(30);
+        using row = std::tuple<float&, int&, std::string&>;
+        const auto selected =
+            tcb::compress_if(p.view(), out.view(),
+                             [](row r) { return std::get<1>(r) % 3 == 0; });
+        REQUIRE(selected.size() == 10);
+        for (std::size_t i = 0; i < selected.size(); i++) {
+            REQUIRE(std::get<1>(selected[i]) == static_cast<int>(3 * i));
+            REQUIRE(std::get<2>(selected[i]) == "p" + std::to_string(3 * i));
+        }
+
+        // In place
+        const auto kept = tcb::compress_if(
+            p.view(), p.view(), [](row r) { return std::get<0>(r) > 0; });
+        for (std::size_t i = 0; i < kept.size(); i++) {
+            REQUIRE(p.x[i] > 0);
+            REQUIRE(p.name[i] == "p" + std::to_string(p.id[i]));
+            if (i > 0) {
+                REQUIRE(p.id[i] > p.id[i - 1]);
+            }
+        }
+        REQUIRE(kept.size() ==
+                static_cast<std::size_t>(
+                    std::count_if(original.x.begin(), original.x.end(),
+                                  [](float x) { return x > 0; })));
+    }
+
+    SECTION("compress_if over several batches")
+    {
+        points p(1000);
+        points out(1000);
+        using row = std::tuple<float&, int&, std::string&>;
+        const auto keep = [](row r) { return std::get<1>(r) % 7 != 3; };
+        const auto selected = tcb::compress_if(p.view(), out.view(), keep);
+        const auto kept = tcb::compress_if(p.view(), p.view(), keep);
+        REQUIRE(selected.size() == 857);
+        REQUIRE(kept.size() == 857);
+        int id = 0;
+        for (std::size_t i = 0; i < kept.size(); i++, id++) {
+            id += id % 7 == 3 ? 1 : 0;
+            REQUIRE(p.id[i] == id);
+            REQUIRE(out.id[i] == id);
+            REQUIRE(p.name[i] == "p" + std::to_string(id));
+            REQUIRE(out.name[i] == p.name[i]);
+        }
+    }
+}
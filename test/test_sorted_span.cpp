@@ -0,0 +1,97 @@
+
+#include <tcb/sorted_span.hpp>
+
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+using tcb::make_span;
+using tcb::sorted_span;
+using tcb::span;
+
+namespace {
+
+template <typename T, typename Compare = std::less<T>>
+void check_searches(std::vector<T> vec, const std::vector<T>& keys,
+                    Compare comp = Compare())
+{
+    std::sort(vec.begin(), vec.end(), comp);
+    const sorted_span<const T, Compare> s(make_span(vec), comp);
+
+    for (const T& k : keys) {
+        REQUIRE(s.lower_bound(k) ==
+                std::lower_bound(vec.data(), vec.data() + vec.size(), k, comp));
+        REQUIRE(s.upper_bound(k) ==
+                std::upper_bound(vec.data(), vec.data() + vec.size(), k, comp));
+        const auto range = s.equal_range(k);
+        REQUIRE(range.first == s.lower_bound(k));
+        REQUIRE(range.second == s.upper_bound(k));
+        REQUIRE(s.contains(k) ==
+                std::binary_search(vec.begin(), vec.end(), k, comp));
+    }
+
+    std::vector<std::size_t> lower(keys.size());
+    std::vector<std::size_t> upper(keys.size() + 3);
+    s.lower_bound(make_span(keys), make_span(lower));
+    auto res = s.upper_bound(make_span(keys), make_span(upper));
+    REQUIRE(res.size() == keys.size());
+    for (std::size_t i = 0; i < keys.size(); i++) {
+        REQUIRE(s.begin() + lower[i] == s.lower_bound(keys[i]));
+        REQUIRE(s.begin() + upper[i] == s.upper_bound(keys[i]));
+    }
+}
+
+template <typename T>
+void check_random(std::size_t size, int max)
+{
+    std::mt19937 gen(static_cast<unsigned>(size));
+    std::uniform_int_distribution<int> dist(-max, max);
+    std::vector<T> vec(size);
+    for (auto& v : vec) {
+        v = static_cast<T>(dist(gen));
+    }
+    std::vector<T> keys(100);
+    for (auto& k : keys) {
+        k = static_cast<T>(dist(gen));
+    }
+    check_searches(vec, keys);
+}
+
+} // namespace
+
+TEST_CASE("sorted_span searches")
+{
+    for (std::size_t size : {0u, 1u, 2u, 15u, 16u, 17u, 100u, 5000u}) {
+        check_random<std::int32_t>(size, 1000);
+        check_random<std::int32_t>(size, 10);
+        check_random<std::uint32_t>(size, 1000);
+        check_random<float>(size, 1000);
+        check_random<double>(size, 50);
+        check_random<std::int64_t>(size, 1000);
+    }
+
+    SECTION("custom comparator")
+    {
+        check_searches<std::string, std::greater<std::string>>(
+            {"apple", "banana", "cherry", "damson", "elderberry"},
+            {"a", "banana", "zebra", "coconut"});
+    }
+}
+
+TEST_CASE("sorted_span observers")
+{
+    std::vector<int> vec{1, 2, 3};
+    const sorted_span<int> s(vec);
+    REQUIRE(s.size() == 3);
+    REQUIRE(s.data() == vec.data());
+    REQUIRE(s.as_span().data() == vec.data());
+    REQUIRE(s[1] == 2);
+
+    *s.lower_bound(2) = 20;
+    REQUIRE(vec[1] == 20);
+}
@@ -0,0 +1,138 @@
+
+#include <tcb/split.hpp>
+
+#include "catch.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+
+using tcb::make_span;
+
+namespace {
+
+std::vector<std::string> tokens(tcb::split_view<const char> view)
+{
+    std::vector<std::string> result;
+    for (tcb::span<const char> s : view) {
+        result.emplace_back(s.data(), s.size());
+    }
+    return result;
+}
+
+tcb::span<const char> text(const std::string& s)
+{
+    return tcb::span<const char>(s.data(), s.size());
+}
+
+// A straightforward reference implementation, for comparison
+std::vector<std::string> reference_split(const std::string& s, char delim)
+{
+    std::vector<std::string> result;
+    if (s.empty()) {
+        return result;
+    }
+    std::size_t start = 0;
+    for (;;) {
+        const std::size_t end = s.find(delim, start);
+        if (end == std::string::npos) {
+            result.push_back(s.substr(start));
+            return result;
+        }
+        result.push_back(s.substr(start, end - start));
+        start = end + 1;
+    }
+}
+
+} // namespace
+
+TEST_CASE("split")
+{
+    using strings = std::vector<std::string>;
+
+    SECTION("basic splitting")
+    {
+        REQUIRE(tokens(tcb::split(text("a,bc,,d"), ',')) ==
+                (strings{"a", "bc", "", "d"}));
+        REQUIRE(tokens(tcb::split(text(",a,"), ',')) ==
+                (strings{"", "a", ""}));
+        REQUIRE(tokens(tcb::split(text("abc"), ',')) == (strings{"abc"}));
+        REQUIRE(tokens(tcb::split(text(","), ',')) == (strings{"", ""}));
+        REQUIRE(tokens(tcb::split(text(""), ',')).empty());
+    }
+
+    SECTION("subspans refer to the original data")
+    {
+        const std::string s = "one two three";
+        auto view = tcb::split(text(s), ' ');
+        auto it = view.begin();
+        ++it;
+        REQUIRE((*it).data() == s.data() + 4);
+        REQUIRE((*it).size() == 3);
+        auto copy = it++;
+        REQUIRE((*copy).data() == s.data() + 4);
+        REQUIRE((*it).data() == s.data() + 8);
+        REQUIRE(++it == view.end());
+    }
+
+    SECTION("matches a reference implementation")
+    {
+        std::mt19937 gen(42);
+        for (unsigned iter = 0; iter < 500; iter++) {
+            // Vary the density of delimiters, and include runs long enough
+            // to cross several 64-byte blocks
+            const unsigned density = 1 + iter % 200;
+            std::string s(gen() % 1000, 'x');
+            for (char& c : s) {
+                if (gen() % density == 0) {
+                    c = ';';
+                }
+            }
+            REQUIRE(tokens(tcb::split(text(s), ';')) ==
+                    reference_split(s, ';'));
+        }
+    }
+
+    SECTION("other element types")
+    {
+        const int values[] = {1, 2, 0, 3, 0, 0, 4};
+        std::vector<std::size_t> sizes;
+        for (tcb::span<const int> s : tcb::split(make_span(values), 0)) {
+            sizes.push_back(s.size());
+        }
+        REQUIRE(sizes == (std::vector<std::size_t>{2, 1, 0, 1}));
+
+        std::vector<tcb::byte> bytes(200, static_cast<tcb::byte>(1));
+        bytes[70] = bytes[130] = tcb::byte{};
+        sizes.clear();
+        for (tcb::span<tcb::byte> s :
+             tcb::split(make_span(bytes), tcb::byte{})) {
+            sizes.push_back(s.size());
+        }
+        REQUIRE(sizes == (std::vector<std::size_t>{70, 59, 69}));
+    }
+}
+
+TEST_CASE("lines")
+{
+    using strings = std::vector<std::string>;
+
+    REQUIRE(tokens(tcb::lines(text("one\ntwo\r\n\nthree"))) ==
+            (strings{"one", "two", "", "three"}));
+    REQUIRE(tokens(tcb::lines(text("one\r\ntwo\r\n"))) ==
+            (strings{"one", "two"}));
+    REQUIRE(tokens(tcb::lines(text("\n"))) == (strings{""}));
+    REQUIRE(tokens(tcb::lines(text("\n\n"))) == (strings{"", ""}));
+    REQUIRE(tokens(tcb::lines(text("a\rb"))) == (strings{"a\rb"}));
+    REQUIRE(tokens(tcb::lines(text(""))).empty());
+
+    std::string long_text;
+    for (int i = 0; i < 100; i++) {
+        long_text += std::string(static_cast<std::size_t>(i), 'z') + "\r\n";
+    }
+    std::size_t count = 0;
+    for (tcb::span<const char> line : tcb::lines(text(long_text))) {
+        REQUIRE(line.size() == count++);
+    }
+    REQUIRE(count == 100);
+}
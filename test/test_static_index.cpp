@@ -0,0 +1,109 @@
+
+#include <tcb/static_index.hpp>
+
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using tcb::make_span;
+using tcb::static_index;
+
+namespace {
+
+template <typename T, typename Compare = std::less<T>>
+void check_searches(std::vector<T> vec, const std::vector<T>& keys,
+                    Compare comp = Compare())
+{
+    using index_type = static_index<T, Compare>;
+
+    std::sort(vec.begin(), vec.end(), comp);
+    std::vector<T> storage(index_type::storage_size(vec.size()));
+    const index_type index(make_span(vec), make_span(storage), comp);
+    REQUIRE(index.size() == vec.size());
+    REQUIRE(index.storage().size() == storage.size());
+
+    for (const T& k : keys) {
+        const auto lower = static_cast<std::size_t>(
+            std::lower_bound(vec.begin(), vec.end(), k, comp) - vec.begin());
+        const auto upper = static_cast<std::size_t>(
+            std::upper_bound(vec.begin(), vec.end(), k, comp) - vec.begin());
+        REQUIRE(index.lower_bound(k) == lower);
+        REQUIRE(index.upper_bound(k) == upper);
+        REQUIRE(index.equal_range(k).first == lower);
+        REQUIRE(index.equal_range(k).second == upper);
+        REQUIRE(index.contains(k) == (lower != upper));
+    }
+}
+
+template <typename T>
+void check_random(std::size_t size, int max)
+{
+    std::mt19937 gen(static_cast<unsigned>(size));
+    std::uniform_int_distribution<int> dist(-max, max);
+    std::vector<T> vec(size);
+    for (auto& v : vec) {
+        v = static_cast<T>(dist(gen));
+    }
+    std::vector<T> keys(200);
+    for (auto& k : keys) {
+        k = static_cast<T>(dist(gen));
+    }
+    keys.push_back(std::numeric_limits<T>::lowest());
+    keys.push_back((std::numeric_limits<T>::max)());
+    check_searches(vec, keys);
+}
+
+} // namespace
+
+TEST_CASE("static_index searches")
+{
+    // Sizes either side of each extra level for 4- and 8-byte keys
+    for (std::size_t size : {0u, 1u, 8u, 9u, 16u, 17u, 72u, 73u, 272u, 273u,
+                             4624u, 4625u, 20000u}) {
+        check_random<std::int32_t>(size, 100000);
+        check_random<std::int32_t>(size, 10);
+        check_random<std::uint32_t>(size, 1000);
+        check_random<float>(size, 1000);
+        check_random<double>(size, 50);
+        check_random<std::int64_t>(size, 100000);
+    }
+
+    SECTION("keys equal to the largest value")
+    {
+        const auto max = (std::numeric_limits<std::uint32_t>::max)();
+        std::vector<std::uint32_t> vec(100, 1);
+        vec.resize(200, max);
+        check_searches(vec, {0, 1, 2, max - 1, max});
+    }
+
+    SECTION("custom comparator")
+    {
+        std::vector<std::string> vec;
+        for (int i = 0; i < 100; i++) {
+            vec.push_back(std::to_string(i * 7));
+        }
+        check_searches<std::string, std::greater<std::string>>(
+            vec, {"0", "14", "15", "700", "999", ""});
+    }
+}
+
+TEST_CASE("static_index storage size")
+{
+    using index_type = static_index<std::int32_t>;
+    constexpr std::size_t node_size = index_type::node_size;
+    static_assert(node_size == tcb::cache_line_size / 4, "");
+    REQUIRE(index_type::storage_size(0) == 0);
+    REQUIRE(index_type::storage_size(node_size) == 0);
+    // A root node over node_size + 1 leaves
+    REQUIRE(index_type::storage_size(node_size + 1) == node_size);
+    REQUIRE(index_type::storage_size(node_size * (node_size + 1)) ==
+            node_size);
+    REQUIRE(index_type::storage_size(node_size * (node_size + 1) + 1) ==
+            3 * node_size);
+}
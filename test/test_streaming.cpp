@@ -0,0 +1,77 @@
+
+#include <tcb/streaming.hpp>
+
+#include "catch.hpp"
+
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+using tcb::make_span;
+using tcb::span;
+
+namespace {
+
+struct rgb {
+    unsigned char r, g, b;
+};
+
+} // namespace
+
+TEST_CASE("copy_streaming")
+{
+    std::vector<std::uint32_t> src(1000);
+    std::iota(src.begin(), src.end(), 1u);
+
+    // Threshold of zero forces the non-temporal path at every offset,
+    // exercising all combinations of head, body and tail
+    for (std::size_t offset = 0; offset < 20; offset++) {
+        for (std::size_t len : {0u, 1u, 15u, 16u, 17u, 100u, 900u}) {
+            std::vector<std::uint32_t> dst(1000, 0);
+            auto in = make_span(src).subspan(offset, len);
+            auto out =
+                tcb::copy_streaming(in, make_span(dst).subspan(offset), 0);
+
+            REQUIRE(out.data() == dst.data() + offset);
+            REQUIRE(out.size() == len);
+            REQUIRE(std::equal(in.begin(), in.end(), out.begin()));
+            REQUIRE(std::all_of(out.end(), dst.data() + dst.size(),
+                                [](std::uint32_t i) { return i == 0; }));
+        }
+    }
+
+    SECTION("below the threshold")
+    {
+        std::vector<std::uint32_t> dst(1000, 0);
+        auto out = tcb::copy_streaming(make_span(src).first(10),
+                                       make_span(dst));
+        REQUIRE(out.size() == 10);
+        REQUIRE(std::equal(out.begin(), out.end(), src.begin()));
+    }
+}
+
+TEST_CASE("fill_streaming")
+{
+    SECTION("power-of-two element size")
+    {
+        for (std::size_t offset = 0; offset < 10; offset++) {
+            std::vector<std::uint16_t> vec(600, 0);
+            auto s = make_span(vec).subspan(offset, 500);
+            tcb::fill_streaming(s, 0xBEEF, 0);
+
+            REQUIRE(std::all_of(s.begin(), s.end(),
+                                [](std::uint16_t i) { return i == 0xBEEF; }));
+            REQUIRE(std::all_of(s.end(), vec.data() + vec.size(),
+                                [](std::uint16_t i) { return i == 0; }));
+        }
+    }
+
+    SECTION("other element sizes")
+    {
+        std::vector<rgb> vec(300);
+        tcb::fill_streaming(make_span(vec), rgb{1, 2, 3}, 0);
+        REQUIRE(std::all_of(vec.begin(), vec.end(), [](const rgb& c) {
+            return c.r == 1 && c.g == 2 && c.b == 3;
+        }));
+    }
+}
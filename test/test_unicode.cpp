@@ -0,0 +1,262 @@
+
+#include <tcb/unicode.hpp>
+
+#include "catch.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+
+using tcb::make_span;
+
+namespace {
+
+tcb::span<const char> text(const std::string& s)
+{
+    return tcb::span<const char>(s.data(), s.size());
+}
+
+template <typename C>
+tcb::span<C> writable(std::basic_string<C>& s)
+{
+    return tcb::span<C>(&s[0], s.size());
+}
+
+// A reference validator, working from the decoded values rather than the
+// byte ranges
+bool reference_valid(const std::string& s)
+{
+    std::size_t i = 0;
+    while (i < s.size()) {
+        const auto b0 = static_cast<unsigned char>(s[i]);
+        std::size_t len;
+        std::uint32_t cp;
+        std::uint32_t least;
+        if (b0 < 0x80) {
+            len = 1, cp = b0, least = 0;
+        } else if ((b0 & 0xe0) == 0xc0) {
+            len = 2, cp = b0 & 0x1fu, least = 0x80;
+        } else if ((b0 & 0xf0) == 0xe0) {
+            len = 3, cp = b0 & 0x0fu, least = 0x800;
+        } else if ((b0 & 0xf8) == 0xf0) {
+            len = 4, cp = b0 & 0x07u, least = 0x10000;
+        } else {
+            return false;
+        }
+        if (s.size() - i < len) {
+            return false;
+        }
+        for (std::size_t k = 1; k < len; k++) {
+            const auto b = static_cast<unsigned char>(s[i + k]);
+            if ((b & 0xc0) != 0x80) {
+                return false;
+            }
+            cp = cp << 6 | (b & 0x3fu);
+        }
+        if (cp < least || cp > 0x10ffff || (cp >= 0xd800 && cp < 0xe000)) {
+            return false;
+        }
+        i += len;
+    }
+    return true;
+}
+
+std::u32string random_code_points(std::mt19937& gen, std::size_t size)
+{
+    std::u32string s(size, U'x');
+    for (char32_t& c : s) {
+        switch (gen() % 5) {
+        case 0: c = gen() % 0x80; break;
+        case 1: c = 0x80 + gen() % (0x800 - 0x80); break;
+        case 2: c = 0x800 + gen() % (0xd800 - 0x800); break;
+        case 3: c = 0xe000 + gen() % (0x10000 - 0xe000); break;
+        default: c = 0x10000 + gen() % (0x110000 - 0x10000); break;
+        }
+    }
+    return s;
+}
+
+std::string to_utf8(const std::u32string& s)
+{
+    std::string out(tcb::utf8_length_from_utf32(make_span(s)), '\0');
+    auto r = tcb::utf32_to_utf8(make_span(s), writable(out));
+    REQUIRE(r.consumed.size() == s.size());
+    REQUIRE(r.produced.size() == out.size());
+    return out;
+}
+
+} // namespace
+
+TEST_CASE("UTF-8 validation")
+{
+    SECTION("known cases")
+    {
+        const char* valid[] = {"", "plain ASCII", "h\xc3\xa9llo",
+                               "\xe2\x82\xac", "\xf0\x9f\x98\x80",
+                               "\xef\xbf\xbf", "\xf4\x8f\xbf\xbf",
+                               "\xed\x9f\xbf", "\xee\x80\x80"};
+        for (const char* s : valid) {
+            REQUIRE(tcb::validate_utf8(text(s)));
+        }
+        const char* invalid[] = {
+            "\x80",             // lone continuation
+            "\xc3",             // truncated
+            "\xc0\x80",         // overlong
+            "\xc1\xbf",         // overlong
+            "\xe0\x80\x80",     // overlong
+            "\xe0\x9f\xbf",     // overlong
+            "\xed\xa0\x80",     // surrogate
+            "\xed\xbf\xbf",     // surrogate
+            "\xf0\x80\x80\x80", // overlong
+            "\xf4\x90\x80\x80", // beyond U+10FFFF
+            "\xf5\x80\x80\x80", // beyond U+10FFFF
+            "\xff",
+            "\xe2\x82",         // truncated
+            "\xe2\x28\xa1",     // bad continuation
+            "\xf0\x9f\x98\x80\x80", // extra continuation
+        };
+        for (const char* s : invalid) {
+            REQUIRE(!tcb::validate_utf8(text(s)));
+        }
+    }
+
+    SECTION("errors are found at every position")
+    {
+        std::mt19937 gen(1);
+        const std::string base = to_utf8(random_code_points(gen, 60));
+        REQUIRE(tcb::validate_utf8(text(base)));
+        for (std::size_t i = 0; i < base.size(); i++) {
+            for (unsigned char bad : {0x80u, 0xc0u, 0xf8u}) {
+                std::string s = base;
+                s[i] = static_cast<char>(bad);
+                REQUIRE(tcb::validate_utf8(text(s)) == reference_valid(s));
+            }
+            // Truncation at every length
+            const std::string prefix = base.substr(0, i);
+            REQUIRE(tcb::validate_utf8(text(prefix)) ==
+                    reference_valid(prefix));
+        }
+    }
+
+    SECTION("matches a reference implementation")
+    {
+        std::mt19937 gen(2);
+        for (unsigned iter = 0; iter < 3000; iter++) {
+            std::string s = to_utf8(random_code_points(gen, gen() % 80));
+            // Mostly ASCII, so that blocks are skipped as well as checked
+            if (iter % 2 == 0) {
+                s = std::string(gen() % 100, 'a') + s;
+            }
+            const unsigned corruptions = gen() % 3;
+            for (unsigned k = 0; k < corruptions && !s.empty(); k++) {
+                s[gen() % s.size()] = static_cast<char>(gen());
+            }
+            REQUIRE(tcb::validate_utf8(text(s)) == reference_valid(s));
+        }
+    }
+}
+
+TEST_CASE("UTF transcoding")
+{
+    SECTION("round trips")
+    {
+        std::mt19937 gen(3);
+        for (std::size_t size : {0u, 1u, 15u, 16u, 17u, 100u, 1000u}) {
+            for (unsigned ascii = 0; ascii < 2; ascii++) {
+                std::u32string s32 = random_code_points(gen, size);
+                if (ascii == 1) {
+                    s32 = std::u32string(size, U'a') + s32 + U"bc";
+                }
+                const std::string s8 = to_utf8(s32);
+                REQUIRE(tcb::utf32_length_from_utf8(text(s8)) == s32.size());
+
+                std::u16string s16(tcb::utf16_length_from_utf8(text(s8)),
+                                   u'\0');
+                auto r16 = tcb::utf8_to_utf16(text(s8), writable(s16));
+                REQUIRE(r16.consumed.size() == s8.size());
+                REQUIRE(r16.produced.size() == s16.size());
+                REQUIRE(tcb::utf8_length_from_utf16(writable(s16)) ==
+                        s8.size());
+
+                std::string back(s8.size(), '\0');
+                auto r8 = tcb::utf16_to_utf8(make_span(s16), writable(back));
+                REQUIRE(r8.consumed.size() == s16.size());
+                REQUIRE(back == s8);
+
+                std::u32string s32_back(s32.size(), U'\0');
+                auto r32 = tcb::utf8_to_utf32(text(s8), writable(s32_back));
+                REQUIRE(r32.consumed.size() == s8.size());
+                REQUIRE(s32_back == s32);
+            }
+        }
+    }
+
+    SECTION("known encodings")
+    {
+        const std::string s8 = "a\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80";
+        std::u16string s16(5, u'\0');
+        auto r = tcb::utf8_to_utf16(text(s8), writable(s16));
+        REQUIRE(r.produced.size() == 5);
+        REQUIRE(s16 == u"a\u00e9\u20ac\U0001f600");
+    }
+
+    SECTION("conversion stops at invalid input")
+    {
+        const std::string s8 = "abc\xc3\xa9\xc0\x80xyz";
+        std::u16string s16(20, u'\0');
+        auto r = tcb::utf8_to_utf16(text(s8), writable(s16));
+        REQUIRE(r.consumed.size() == 5);
+        REQUIRE(r.produced.size() == 4);
+
+        std::string out(20, '\0');
+        const std::u16string lone_low = u"ab\xdc00z";
+        auto r8 = tcb::utf16_to_utf8(make_span(lone_low), writable(out));
+        REQUIRE(r8.consumed.size() == 2);
+
+        const std::u32string bad32 = {U'a', 0xd800, U'b'};
+        auto r32 = tcb::utf32_to_utf8(make_span(bad32),
+                                      writable(out));
+        REQUIRE(r32.consumed.size() == 1);
+    }
+
+    SECTION("streams can be converted in pieces")
+    {
+        std::mt19937 gen(4);
+        const std::u32string s32 = random_code_points(gen, 500);
+        const std::string s8 = to_utf8(s32);
+        std::u16string expected(tcb::utf16_length_from_utf8(text(s8)),
+                                u'\0');
+        tcb::utf8_to_utf16(text(s8), writable(expected));
+
+        // Input arriving 7 bytes at a time, and a small output buffer
+        std::u16string result;
+        std::vector<char16_t> buffer(5);
+        std::size_t pos = 0;
+        std::size_t avail = 0;
+        while (pos < s8.size()) {
+            avail = (std::min)(avail + 7, s8.size());
+            auto r = tcb::utf8_to_utf16(text(s8).subspan(pos, avail - pos),
+                                        make_span(buffer));
+            result.append(r.produced.begin(), r.produced.end());
+            pos += r.consumed.size();
+        }
+        REQUIRE(result == expected);
+
+        // A surrogate pair split between pieces of UTF-16
+        const std::u16string pair = u"x\U0001f600";
+        std::string out(8, '\0');
+        auto r = tcb::utf16_to_utf8(make_span(pair).first(2),
+                                    writable(out));
+        REQUIRE(r.consumed.size() == 1);
+        REQUIRE(r.produced.size() == 1);
+    }
+
+    SECTION("conversion stops when the output is full")
+    {
+        const std::string s8 = "ab\xf0\x9f\x98\x80";
+        std::u16string s16(3, u'\0');
+        auto r = tcb::utf8_to_utf16(text(s8), writable(s16));
+        REQUIRE(r.consumed.size() == 2);
+        REQUIRE(r.produced.size() == 2);
+    }
+}